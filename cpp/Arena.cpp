@@ -0,0 +1,231 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "Arena.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Arena.cpp - implements the arena allocator. Chunks are aligned on their size, so
+ * the chunk holding a block (and so its arena and size class) is found from the
+ * block's address. A block too big to share a chunk gets a chunk of its own, which
+ * starts the same way.
+ */
+#define ARENA_CHUNK_SIZE (16 * 1024)
+#define ARENA_ALIGN 16
+#define ARENA_MAX_SHARED (ARENA_CHUNK_SIZE / 4)
+
+//-- size classes: every multiple of ARENA_ALIGN up to 128 bytes, then four to each
+//-- doubling, up to ARENA_MAX_SHARED
+#define ARENA_SMALL_CLASSES 8
+#define ARENA_SMALL_LIMIT (ARENA_SMALL_CLASSES * ARENA_ALIGN)
+
+struct Arena::Chunk {
+    Arena *owner;
+    size_t size;	// bytes in the chunk, including this header
+    long live;		// blocks in use
+    int sizeClass;	// or -1 for a chunk holding one big block
+    size_t used;	// bytes carved from the chunk so far
+    void *free;		// released blocks, each holding the next
+    Chunk *prev, *next;	// chunks of the same class with room, when this one has room
+};
+
+//-- the bytes before the first block of a chunk (used in Arena members only)
+#define ARENA_HEADER_SIZE ((sizeof(Chunk) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+
+//-- the class of a block of size bytes (a multiple of ARENA_ALIGN)
+static int classOf(size_t size)
+{
+    if (size <= ARENA_SMALL_LIMIT)
+        return (int) (size / ARENA_ALIGN) - 1;
+    int shift = 63 - __builtin_clzll((unsigned long long) (size - 1));
+    size_t step = ((size_t) 1 << shift) / 4;
+    int quarter = (int) ((size - ((size_t) 1 << shift) + step - 1) / step);
+    return ARENA_SMALL_CLASSES + (shift - 7) * 4 + quarter - 1;
+}
+
+
+//-- the size of the blocks of a class
+static size_t classSize(int sizeClass)
+{
+    if (sizeClass < ARENA_SMALL_CLASSES)
+        return (size_t) (sizeClass + 1) * ARENA_ALIGN;
+    int shift = (sizeClass - ARENA_SMALL_CLASSES) / 4 + 7;
+    int quarter = (sizeClass - ARENA_SMALL_CLASSES) % 4 + 1;
+    return ((size_t) 1 << shift) + quarter * (((size_t) 1 << shift) / 4);
+}
+
+static_assert(ARENA_MAX_SHARED == 4 * 1024, "ARENA_CLASS_COUNT assumes blocks of up to 4K share chunks");
+
+
+Arena::Arena(): bytes(0), chunkCount(0)
+{
+    for (int i = 0; i < ARENA_CLASS_COUNT; i++)
+        open[i] = NULL;
+}
+
+
+Arena::~Arena()
+{
+    for (int i = 0; i < ARENA_CLASS_COUNT; i++) {
+        Chunk *chunk = open[i];
+        while (chunk) {
+            Chunk *next = chunk->next;
+            if (chunk->live == 0)
+                freeChunk(chunk);
+            chunk = next;
+        }
+    }
+}
+
+
+Arena::Chunk *Arena::newChunk(size_t size, int sizeClass)
+{
+    void *mem = NULL;
+    if (posix_memalign(&mem, ARENA_CHUNK_SIZE, size) != 0) {
+        printf("Out of memory!\n");
+        fflush(stdout);
+        exit(1);
+    }
+    Chunk *chunk = (Chunk *) mem;
+    chunk->owner = this;
+    chunk->size = size;
+    chunk->live = 0;
+    chunk->sizeClass = sizeClass;
+    chunk->used = ARENA_HEADER_SIZE;
+    chunk->free = NULL;
+    chunk->prev = chunk->next = NULL;
+    bytes += size;
+    chunkCount++;
+    return chunk;
+}
+
+
+void Arena::freeChunk(Chunk *chunk)
+{
+    bytes -= chunk->size;
+    chunkCount--;
+    free(chunk);
+}
+
+
+//-- link - add a chunk which has room to the front of its class's list, so the
+//-- chunks holding blocks which are still in use are filled again first
+void Arena::link(Chunk *chunk)
+{
+    chunk->prev = NULL;
+    chunk->next = open[chunk->sizeClass];
+    if (chunk->next)
+        chunk->next->prev = chunk;
+    open[chunk->sizeClass] = chunk;
+}
+
+
+void Arena::unlink(Chunk *chunk)
+{
+    if (chunk->prev)
+        chunk->prev->next = chunk->next;
+    else
+        open[chunk->sizeClass] = chunk->next;
+    if (chunk->next)
+        chunk->next->prev = chunk->prev;
+    chunk->prev = chunk->next = NULL;
+}
+
+
+void *Arena::allocate(size_t size)
+{
+    if (size == 0)
+        size = 1;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size > ARENA_MAX_SHARED) {
+        Chunk *chunk = newChunk(ARENA_HEADER_SIZE + size, -1);
+        chunk->live = 1;
+        return (char *) chunk + ARENA_HEADER_SIZE;
+    }
+    int sizeClass = classOf(size);
+    size_t blockSize = classSize(sizeClass);
+    Chunk *chunk = open[sizeClass];
+    if (chunk == NULL) {
+        chunk = newChunk(ARENA_CHUNK_SIZE, sizeClass);
+        link(chunk);
+    }
+    void *block;
+    if (chunk->free) {
+        block = chunk->free;
+        chunk->free = *(void **) block;
+    } else {
+        block = (char *) chunk + chunk->used;
+        chunk->used += blockSize;
+    }
+    chunk->live++;
+    if (chunk->free == NULL && chunk->used + blockSize > chunk->size)
+        unlink(chunk);
+    return block;
+}
+
+
+void *Arena::reallocate(void *old, size_t oldSize, size_t newSize)
+{
+    char *block = (char *) allocate(newSize);
+    size_t kept = oldSize < newSize ? oldSize : newSize;
+    if (old && kept > 0)
+        memcpy(block, old, kept);
+    if (newSize > kept)
+        memset(block + kept, 0, newSize - kept);
+    release(old);
+    return block;
+}
+
+
+void Arena::release(void *block)
+{
+    if (block == NULL)
+        return;
+    Chunk *chunk = (Chunk *) ((uintptr_t) block & ~(uintptr_t) (ARENA_CHUNK_SIZE - 1));
+    Arena *arena = chunk->owner;
+    std::lock_guard<std::mutex> lock(arena->mutex);
+    if (chunk->sizeClass < 0) {
+        arena->freeChunk(chunk);
+        return;
+    }
+    bool full = chunk->free == NULL && chunk->used + classSize(chunk->sizeClass) > chunk->size;
+    *(void **) block = chunk->free;
+    chunk->free = block;
+    chunk->live--;
+    if (full)
+        arena->link(chunk);
+    if (chunk->live > 0)
+        return;
+    //-- the last chunk with room for its class is started over, rather than freed
+    //-- and made again
+    if (arena->open[chunk->sizeClass] == chunk && chunk->next == NULL) {
+        chunk->used = ARENA_HEADER_SIZE;
+        chunk->free = NULL;
+        return;
+    }
+    arena->unlink(chunk);
+    arena->freeChunk(chunk);
+}
+
+
+long long Arena::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes;
+}
+
+
+long Arena::getChunkCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunkCount;
+}
@@ -8,6 +8,7 @@
 #include "AttributeList.h"
 #include "_Core.h"
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,68 +19,177 @@
  * iterating over the attributes (get the count, then access by index)
  */
 
+//-- compare names: up to any "$" in the first (everything after that is formatting
+//-- info), ignoring case.
+static bool sameName(const char *name, const char *other)
+{
+    const char *cp = name;
+    for (; *cp && *cp != '$'; cp++, other++) {
+	if (tolower((unsigned char) *cp) != tolower((unsigned char) *other))
+	    return false;
+    }
+    return *other == '\0';
+}
+
+
 static int findName(const char **names, const char *name, int count)
 {
-    //-- if name contains "$", everything after that is formatting info, so don't compare that part.
-    const char *cp = strchr(name, '$');
-    int len = (cp == 0) ? strlen(name) : cp - name;
-    char *name2 = new char[len+1];
-    strncpy(name2, name, len);
-    name2[len] = '\0';
-    int match = -1;
     for (int i = 0; i < count; i++) {
-	if (strcasecmp(name2, names[i]) == 0) {
-	    match = i;
-	    break;
+	if (sameName(name, names[i])) {
+	    return i;
 	}
     }
-    delete [] name2;
-    return match;
+    return -1;
 }
 
 
-AttributeList::AttributeList(int size)
+//-- hash of a name as sameName sees it, so a lookup needs no copy of the name
+static unsigned int hashName(const char *name)
 {
+    unsigned int hash = 2166136261u;
+    for (const char *cp = name; *cp && *cp != '$'; cp++)
+	hash = (hash ^ (unsigned char) tolower((unsigned char) *cp)) * 16777619u;
+    return hash;
+}
+
+
+//-- open-addressed table of the known names, at most half full
+#define ATTRIBUTE_TABLE_SIZE 256
+static_assert(ATTRIBUTE_TABLE_SIZE >= 2 * ATTRIBUTE_ID_COUNT, "attribute table too small");
+
+struct IdTable {
+    const char *names[ATTRIBUTE_TABLE_SIZE];
+    int ids[ATTRIBUTE_TABLE_SIZE];
+    IdTable() {
+	const char *knownNames[] = {
+#define OCCAM_ATTRIBUTE_ENTRY(sym, attrName) attrName,
+	    OCCAM_ATTRIBUTES(OCCAM_ATTRIBUTE_ENTRY)
+#undef OCCAM_ATTRIBUTE_ENTRY
+	};
+	memset(names, 0, sizeof(names));
+	for (int id = 0; id < ATTRIBUTE_ID_COUNT; id++) {
+	    unsigned int i = hashName(knownNames[id]) % ATTRIBUTE_TABLE_SIZE;
+	    while (names[i])
+		i = (i + 1) % ATTRIBUTE_TABLE_SIZE;
+	    names[i] = knownNames[id];
+	    ids[i] = id;
+	}
+    }
+};
+
+
+//-- the table is built by its initializer, so that lookups from several threads are safe
+int AttributeList::findId(const char *name)
+{
+    static const IdTable table;
+    unsigned int i = hashName(name) % ATTRIBUTE_TABLE_SIZE;
+    for (; table.names[i]; i = (i + 1) % ATTRIBUTE_TABLE_SIZE) {
+	if (sameName(name, table.names[i]))
+	    return table.ids[i];
+    }
+    return -1;
+}
+
+
+AttributeList::AttributeList(int size, Arena *arena)
+{
+    this->arena = arena;
     attrCount = 0;
-    maxAttrCount = size;
-    names = new const char*[maxAttrCount];
-    values = new double[maxAttrCount];
-    memset(names,0,maxAttrCount*sizeof(char));
+    maxAttrCount = size > 0 ? size : 1;
+    memset(present,0,sizeof(present));
+    slots = NULL;
+    slotCount = maxSlotCount = 0;
+    names = (const char **) arena->allocate(maxAttrCount*sizeof(char*));
+    values = (double *) arena->allocate(maxAttrCount*sizeof(double));
+    memset(names,0,maxAttrCount*sizeof(char*));
     memset(values,0,maxAttrCount*sizeof(double));
 }
 
 
 AttributeList::~AttributeList()
 {
-    if (names) delete [] names;
-    if (values) delete [] values;
+    Arena::release(slots);
+    Arena::release(names);
+    Arena::release(values);
 }
 
 
 long AttributeList::size()
 {
-    return sizeof(AttributeList) * maxAttrCount * (sizeof(char*) + sizeof(double));
+    return sizeof(AttributeList) + maxSlotCount * sizeof(double)
+	+ maxAttrCount * (sizeof(char*) + sizeof(double));
 }
 
 
 void AttributeList::reset()
 {
+    memset(present,0,sizeof(present));
+    slotCount = 0;
     attrCount = 0;
 }
 
 
+void AttributeList::copyFrom(AttributeList *other)
+{
+    memcpy(present, other->present, sizeof(present));
+    if (maxSlotCount < other->slotCount) {
+	Arena::release(slots);
+	maxSlotCount = other->slotCount;
+	slots = (double *) arena->allocate(maxSlotCount*sizeof(double));
+    }
+    slotCount = other->slotCount;
+    memcpy(slots, other->slots, slotCount*sizeof(double));
+    if (maxAttrCount < other->attrCount) {
+	Arena::release(names);
+	Arena::release(values);
+	maxAttrCount = other->attrCount;
+	names = (const char **) arena->allocate(maxAttrCount*sizeof(char*));
+	values = (double *) arena->allocate(maxAttrCount*sizeof(double));
+    }
+    attrCount = other->attrCount;
+    memcpy(names, other->names, attrCount*sizeof(char*));
+    memcpy(values, other->values, attrCount*sizeof(double));
+}
+
+
+//-- add a known attribute which isn't set yet, moving up the values of higher ids
+void AttributeList::insertSlot(int id, double value)
+{
+    const int FACTOR = 2;
+
+    if (slotCount >= maxSlotCount) {
+	int newCount = maxSlotCount > 0 ? FACTOR*maxSlotCount : 4;
+	if (newCount > ATTRIBUTE_ID_COUNT)
+	    newCount = ATTRIBUTE_ID_COUNT;
+	slots = (double *) arena->reallocate(slots, maxSlotCount*sizeof(double), newCount*sizeof(double));
+	maxSlotCount = newCount;
+    }
+    int slot = slotOf(id);
+    memmove(slots + slot + 1, slots + slot, (slotCount - slot)*sizeof(double));
+    slots[slot] = value;
+    slotCount++;
+    present[id / 64] |= 1ULL << (id % 64);
+}
+
+
 void AttributeList::setAttribute(const char *name, double value)
 {
     const int FACTOR = 2;
 
+    int id = findId(name);
+    if (id >= 0) {
+	AttributeName attr = { id, name };
+	setAttribute(attr, value);
+	return;
+    }
     // if this attribute is already in the list, change it;
     // otherwise, add a new one
     int index = findName(names, name, attrCount);
     if (index >= 0) values[index] = value;
     else {
 	while (attrCount >= maxAttrCount) {
-	    names = (const char **) growStorage(names, maxAttrCount*sizeof(char*), FACTOR);
-	    values = (double*) growStorage(values, maxAttrCount*sizeof(double), FACTOR);
+	    names = (const char **) arena->reallocate(names, maxAttrCount*sizeof(char*), FACTOR*maxAttrCount*sizeof(char*));
+	    values = (double*) arena->reallocate(values, maxAttrCount*sizeof(double), FACTOR*maxAttrCount*sizeof(double));
 	    maxAttrCount *=	FACTOR;
 	}
 	names[attrCount] = name;
@@ -90,12 +200,21 @@ void AttributeList::setAttribute(const char *name, double value)
 
 int AttributeList::getAttributeIndex(const char *name)
 {
-    return findName(names, name, attrCount);
+    int id = findId(name);
+    if (id >= 0)
+	return isPresent(id) ? id : -1;
+    int index = findName(names, name, attrCount);
+    return (index >= 0) ? ATTRIBUTE_ID_COUNT + index : -1;
 }
 
 
 double AttributeList::getAttribute(const char *name)
 {
+    int id = findId(name);
+    if (id >= 0) {
+	AttributeName attr = { id, name };
+	return getAttribute(attr);
+    }
     int index = findName(names, name, attrCount);
     return (index >= 0) ? values[index] : -1.0;
 }
@@ -103,22 +222,42 @@ double AttributeList::getAttribute(const char *name)
 
 int AttributeList::getAttributeCount()
 {
-    return attrCount;
+    return ATTRIBUTE_ID_COUNT + attrCount;
 }
 
 
 double AttributeList::getAttributeByIndex(int index)
 {
+    if (index < 0)
+	return -1.0;
+    if (index < ATTRIBUTE_ID_COUNT) {
+	AttributeName attr = { index, NULL };
+	return getAttribute(attr);
+    }
+    index -= ATTRIBUTE_ID_COUNT;
     return (index < attrCount) ? values[index] : -1.0;
 }
 
 
-void AttributeList::dump()
+const char *AttributeList::getAttributeName(int index)
 {
-    if (attrCount == 0) return;
-    printf("\t\tAttributes: %d/%d", attrCount, maxAttrCount);
-    //for (int i = 0; i < attrCount; i++) {
-    //printf("\t%s: %lf", names[i], values[i]);
-    //}
+    static const char *knownNames[] = {
+#define OCCAM_ATTRIBUTE_ENTRY(sym, attrName) attrName,
+	OCCAM_ATTRIBUTES(OCCAM_ATTRIBUTE_ENTRY)
+#undef OCCAM_ATTRIBUTE_ENTRY
+    };
+    if (index < 0)
+	return NULL;
+    if (index < ATTRIBUTE_ID_COUNT)
+	return isPresent(index) ? knownNames[index] : NULL;
+    index -= ATTRIBUTE_ID_COUNT;
+    return (index < attrCount) ? names[index] : NULL;
 }
 
+
+void AttributeList::dump()
+{
+    int count = attrCount + slotCount;
+    if (count == 0) return;
+    printf("\t\tAttributes: %d/%d", count, ATTRIBUTE_ID_COUNT + maxAttrCount);
+}
@@ -0,0 +1,466 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "AttributeList.h"
+#include "BeamSearch.h"
+#include "Model.h"
+#include "SBMManager.h"
+#include "VBMManager.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <unordered_map>
+
+//-- the sort statistics, for either kind of manager
+template<class M> static void informationStatistics(ManagerBase *manager, Model *model, FitContext *context) {
+    ((M *) manager)->computeInformationStatistics(model, context);
+}
+
+template<class M> static void dfStatistics(ManagerBase *manager, Model *model, FitContext *context) {
+    ((M *) manager)->computeDFStatistics(model);
+}
+
+//-- the state-based BP statistics don't fit the model, so they need no context
+static void computeBPStatistics(VBMManager *manager, Model *model, FitContext *context) {
+    manager->computeBPStatistics(model, context);
+}
+
+static void computeBPStatistics(SBMManager *manager, Model *model, FitContext *context) {
+    manager->computeBPStatistics(model);
+}
+
+template<class M> static void bpStatistics(ManagerBase *manager, Model *model, FitContext *context) {
+    computeBPStatistics((M *) manager, model, context);
+}
+
+template<class M> static void percentCorrect(ManagerBase *manager, Model *model, FitContext *context) {
+    ((M *) manager)->computePercentCorrect(model, context);
+}
+
+template<class M> static void allStatistics(ManagerBase *manager, Model *model, FitContext *context) {
+    ((M *) manager)->computeL2Statistics(model, context);
+    ((M *) manager)->computeDependentStatistics(model, context);
+}
+
+//-- defaultStatistic - the statistics needed to sort on an attribute. Anything not
+//-- known gets the L2 and dependent statistics, which cover most attributes.
+template<class M> static ModelStatistic defaultStatistic(const char *attr) {
+    if (strcmp(attr, "h") == 0 || strcmp(attr, "information") == 0 || strcmp(attr, "unexplained") == 0
+            || strcmp(attr, "alg_t") == 0)
+        return informationStatistics<M>;
+    if (strcmp(attr, "df") == 0 || strcmp(attr, "ddf") == 0)
+        return dfStatistics<M>;
+    if (strcmp(attr, "bp_t") == 0 || strcmp(attr, "bp_information") == 0 || strcmp(attr, "bp_alpha") == 0)
+        return bpStatistics<M>;
+    if (strcmp(attr, "pct_correct_data") == 0)
+        return percentCorrect<M>;
+    return allStatistics<M>;
+}
+
+static char *copyName(const char *name) {
+    char *copy = new char[strlen(name) + 1];
+    strcpy(copy, name);
+    return copy;
+}
+
+BeamSearch::BeamSearch(ManagerBase *manager, Model *start, Direction direction, const char *searchType, int width,
+        int levels, const char *sortAttr, Direction sortDirection) :
+        manager(manager), search(SearchFactory::getSearchMethod(manager, searchType, true)),
+        searchType(copyName(searchType)), direction(direction), width(width), levels(levels), sortAttr(copyName(sortAttr)), order(this->sortAttr, sortDirection),
+        sortDirection(sortDirection), statistic(NULL), evaluator(NULL), ownEvaluator(NULL), tieOrder(FIRST_FOUND),
+        compareProgenitors(false), boundManager(NULL) {
+    if (dynamic_cast<SBMManager*>(manager))
+        statistic = defaultStatistic<SBMManager>(sortAttr);
+    else
+        statistic = defaultStatistic<VBMManager>(sortAttr);
+    manager->setSearchDirection(direction);
+    kept.push_back(std::vector<Model*>(1, start));
+    generated.push_back(1);
+    candidates.push_back(1);
+    pruned.push_back(0);
+    keptSet.insert(start);
+}
+
+BeamSearch::~BeamSearch() {
+    delete search;
+    delete ownEvaluator;
+    delete[] searchType;
+    delete[] sortAttr;
+}
+
+void BeamSearch::setThreads(int threads) {
+    delete ownEvaluator;
+    ownEvaluator = threads > 1 ? new ParallelEvaluator(manager, threads) : NULL;
+    evaluator = ownEvaluator;
+}
+
+void BeamSearch::setPruning(bool prune) {
+    boundManager = prune && sortDirection == Direction::Descending ? dynamic_cast<VBMManager*>(manager) : NULL;
+}
+
+//-- the number of new models fitted and sorted at once
+static const size_t CANDIDATE_BATCH = 256;
+
+//-- Level - the state of the level being searched. As the sink for the search, it
+//-- takes each model as it is generated.
+struct BeamSearch::Level : public CandidateSink {
+    BeamSearch *beam;
+    int level;
+    Model *parent;
+    std::unordered_set<Model*> seen;        // the live models generated at this level
+    std::unordered_set<std::string> droppedNames; // those generated but since deleted
+    std::vector<Candidate> heap;    // the best models so far, with the worst at the front
+    std::vector<Model*> fresh, dropped;
+    long generatedCount, candidateCount, prunedCount, sequence;
+
+    void accept(Model *model) { beam->take(*this, model); }
+};
+
+void BeamSearch::take(Level &lev, Model *model) {
+    lev.generatedCount++;
+    if (keptSet.count(model) || !lev.seen.insert(model).second) {
+        if (compareProgenitors)
+            manager->compareProgenitors(model, lev.parent);
+        return;
+    }
+    //-- made again after being dropped by an earlier parent; it can't be kept now either
+    if (!lev.droppedNames.empty() && lev.droppedNames.count(model->getPrintName())) {
+        lev.seen.erase(model);
+        deleteModel(model);
+        return;
+    }
+    lev.candidateCount++;
+    model->setAttribute(ATTRIBUTE_LEVEL, (double) lev.level);
+    model->setProgenitor(lev.parent);
+    lev.fresh.push_back(model);
+    if (lev.fresh.size() >= CANDIDATE_BATCH)
+        evaluate(lev);
+}
+
+//-- evaluate - fit the new models taken since the last batch, and offer them to the heap
+void BeamSearch::evaluate(Level &lev) {
+    if (boundManager && width > 0 && (long) lev.heap.size() >= width) {
+        size_t before = lev.dropped.size();
+        prune(lev.fresh, lev.heap.front(), lev.dropped);
+        lev.prunedCount += (long) (lev.dropped.size() - before);
+    }
+    if (evaluator)
+        evaluator->evaluate(lev.fresh.data(), (long) lev.fresh.size(), statistic);
+    else
+        for (size_t i = 0; i < lev.fresh.size(); i++)
+            statistic(manager, lev.fresh[i], NULL);
+    for (size_t i = 0; i < lev.fresh.size(); i++) {
+        Candidate cand = { lev.fresh[i], lev.sequence++ };
+        offer(lev.heap, cand, lev.dropped);
+    }
+    lev.fresh.clear();
+}
+
+long BeamSearch::searchLevel() {
+    int level = getLevel() + 1;
+    if (search == NULL || level > levels)
+        return 0;
+    std::vector<Model*> parents = kept.back();
+    Level lev;
+    lev.beam = this;
+    lev.level = level;
+    lev.generatedCount = lev.candidateCount = lev.prunedCount = lev.sequence = 0;
+    for (size_t k = 0; k < parents.size(); k++) {
+        lev.parent = parents[k];
+        search->generate(lev.parent, lev);
+        evaluate(lev);
+        //-- the dropped models are kept until the parent is done, as the search
+        //-- may give the same model more than once
+        for (size_t i = 0; i < lev.dropped.size(); i++) {
+            lev.seen.erase(lev.dropped[i]);
+            lev.droppedNames.insert(lev.dropped[i]->getPrintName());
+            deleteModel(lev.dropped[i]);
+        }
+        lev.dropped.clear();
+    }
+    std::vector<Candidate> &heap = lev.heap;
+    std::sort(heap.begin(), heap.end(), [this](const Candidate &c1, const Candidate &c2) {
+        return isBetter(c1, c2);
+    });
+    std::vector<Model*> best;
+    for (size_t i = 0; i < heap.size(); i++) {
+        best.push_back(heap[i].model);
+        keptSet.insert(heap[i].model);
+    }
+    kept.push_back(best);
+    generated.push_back(lev.generatedCount);
+    candidates.push_back(lev.candidateCount);
+    pruned.push_back(lev.prunedCount);
+    return (long) best.size();
+}
+
+void BeamSearch::run() {
+    while (getLevel() < levels && searchLevel() > 0)
+        ;
+}
+
+//-- offer - add a model to the heap of the best models, if it is among them. The
+//-- models left out are added to the dropped list.
+void BeamSearch::offer(std::vector<Candidate> &heap, const Candidate &cand, std::vector<Model*> &dropped) {
+    //-- ordered so the worst model is at the front
+    auto heapOrder = [this](const Candidate &c1, const Candidate &c2) {
+        return isBetter(c1, c2);
+    };
+    //-- an equivalent state-based model may already be there; keep the better one
+    if (cand.model->isStateBased()) {
+        for (size_t i = 0; i < heap.size(); i++) {
+            if (!heap[i].model->isEquivalentTo(cand.model))
+                continue;
+            if (isBetter(heap[i], cand)) {
+                dropped.push_back(cand.model);
+                return;
+            }
+            dropped.push_back(heap[i].model);
+            heap[i] = heap.back();
+            heap.pop_back();
+            std::make_heap(heap.begin(), heap.end(), heapOrder);
+            break;
+        }
+    }
+    if ((long) heap.size() < width) {
+        heap.push_back(cand);
+        std::push_heap(heap.begin(), heap.end(), heapOrder);
+    } else if (!heap.empty() && isBetter(cand, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), heapOrder);
+        dropped.push_back(heap.back().model);
+        heap.back() = cand;
+        std::push_heap(heap.begin(), heap.end(), heapOrder);
+    } else {
+        dropped.push_back(cand.model);
+    }
+}
+
+//-- prune - move the models which can't be better than the worst kept model to
+//-- the dropped list. Models with the same value may still be kept, by tie order.
+void BeamSearch::prune(std::vector<Model*> &models, const Candidate &worst, std::vector<Model*> &dropped) {
+    double worstValue = worst.model->getAttribute(sortAttr);
+    size_t kept = 0;
+    for (size_t i = 0; i < models.size(); i++) {
+        double bound;
+        if (boundManager->computeSortBound(models[i], sortAttr, &bound) && bound < worstValue)
+            dropped.push_back(models[i]);
+        else
+            models[kept++] = models[i];
+    }
+    models.resize(kept);
+}
+
+bool BeamSearch::isBetter(const Candidate &c1, const Candidate &c2) const {
+    int cmp = order.compare(c1.model, c2.model);
+    if (cmp != 0)
+        return cmp < 0;
+    if (tieOrder == BY_NAME) {
+        cmp = strcmp(c1.model->getPrintName(), c2.model->getPrintName());
+        if (cmp != 0)
+            return cmp < 0;
+    }
+    return c1.sequence < c2.sequence;
+}
+
+//-- deleteModel - remove a model which wasn't kept from the cache. The reference
+//-- models stay, as they may be generated without being kept.
+void BeamSearch::deleteModel(Model *model) {
+    if (model == manager->getTopRefModel() || model == manager->getBottomRefModel()
+            || model == manager->getRefModel() || keptSet.count(model))
+        return;
+    manager->deleteModelFromCache(model);
+}
+
+Model **BeamSearch::getModels(int level) {
+    if (level < 0 || level >= (int) kept.size() || kept[level].empty())
+        return NULL;
+    return kept[level].data();
+}
+
+long BeamSearch::getModelCount(int level) {
+    if (level < 0 || level >= (int) kept.size())
+        return 0;
+    return (long) kept[level].size();
+}
+
+long BeamSearch::getGeneratedCount(int level) {
+    if (level < 0 || level >= (int) generated.size())
+        return 0;
+    return generated[level];
+}
+
+long BeamSearch::getCandidateCount(int level) {
+    if (level < 0 || level >= (int) candidates.size())
+        return 0;
+    return candidates[level];
+}
+
+long BeamSearch::getPrunedCount(int level) {
+    if (level < 0 || level >= (int) pruned.size())
+        return 0;
+    return pruned[level];
+}
+
+//-- A checkpoint file is text. The header says which search and data it is for; then
+//-- there is a line for each level with its counts, followed by a line for each kept
+//-- model, with its name, ID and progenitor's name, then pairs of attribute name and
+//-- value. Fields are separated by tabs, and values are written with full precision.
+#define CHECKPOINT_MAGIC "occam-checkpoint 1"
+
+const char *BeamSearch::managerKind() {
+    return dynamic_cast<SBMManager*>(manager) ? "sb" : "vb";
+}
+
+//-- checkpointHeader - the lines which must match for a checkpoint to be resumed
+std::string BeamSearch::checkpointHeader() {
+    char buf[64];
+    std::string header = CHECKPOINT_MAGIC "\n";
+    snprintf(buf, sizeof(buf), "data\t%016llx\n", manager->getDataHash(managerKind()));
+    header += buf;
+    snprintf(buf, sizeof(buf), "\t%d\t%d\t", (int) direction, width);
+    header += std::string("search\t") + searchType + buf + sortAttr;
+    snprintf(buf, sizeof(buf), "\t%d\t%d\t%d\n", (int) sortDirection, (int) tieOrder, compareProgenitors ? 1 : 0);
+    header += buf;
+    Model *ref = manager->getRefModel();
+    header += std::string("reference\t") + (ref ? ref->getPrintName() : "") + "\n";
+    header += std::string("start\t") + kept[0][0]->getPrintName() + "\n";
+    return header;
+}
+
+static void writeModel(FILE *fd, Model *model) {
+    Model *progenitor = model->getProgenitor();
+    fprintf(fd, "%s\t%d\t%s", model->getPrintName(), model->getID(), progenitor ? progenitor->getPrintName() : "");
+    AttributeList *attributes = model->getAttributeList();
+    for (int i = 0; i < attributes->getAttributeCount(); i++) {
+        const char *name = attributes->getAttributeName(i);
+        if (name)
+            fprintf(fd, "\t%s\t%.17g", name, attributes->getAttributeByIndex(i));
+    }
+    fputc('\n', fd);
+}
+
+//-- saveCheckpoint - write to a temporary file and rename it, so that a checkpoint
+//-- is never left partly written.
+bool BeamSearch::saveCheckpoint(const char *file, int nextID) {
+    std::string temp = std::string(file) + ".tmp";
+    FILE *fd = fopen(temp.c_str(), "w");
+    if (fd == NULL)
+        return false;
+    fputs(checkpointHeader().c_str(), fd);
+    fprintf(fd, "levels\t%d\tnext-id\t%d\n", levels, nextID);
+    for (int level = 1; level <= getLevel(); level++) {
+        fprintf(fd, "level\t%d\t%ld\t%ld\t%ld\t%ld\n", level, generated[level], candidates[level], pruned[level],
+                (long) kept[level].size());
+        for (size_t i = 0; i < kept[level].size(); i++)
+            writeModel(fd, kept[level][i]);
+    }
+    bool ok = !ferror(fd);
+    ok = (fclose(fd) == 0) && ok;
+    if (!ok || rename(temp.c_str(), file) != 0) {
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool readLine(FILE *fd, std::string &line) {
+    line.clear();
+    int c;
+    while ((c = fgetc(fd)) != EOF && c != '\n')
+        line += (char) c;
+    return c != EOF || !line.empty();
+}
+
+static void splitFields(const std::string &line, std::vector<std::string> &fields) {
+    fields.clear();
+    size_t start = 0, tab;
+    while ((tab = line.find('\t', start)) != std::string::npos) {
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+    fields.push_back(line.substr(start));
+}
+
+//-- attribute names aren't copied by AttributeList, so those which aren't known
+//-- attributes are kept here
+static const char *keepAttributeName(const std::string &name) {
+    static std::unordered_set<std::string> names;
+    return names.insert(name).first->c_str();
+}
+
+bool BeamSearch::loadCheckpoint(const char *file, int *nextID) {
+    if (getLevel() != 0)
+        return false;
+    FILE *fd = fopen(file, "r");
+    if (fd == NULL)
+        return false;
+    std::string header = checkpointHeader(), text, line;
+    for (size_t lines = std::count(header.begin(), header.end(), '\n'); lines > 0 && readLine(fd, line); lines--)
+        text += line + "\n";
+    std::vector<std::string> fields;
+    bool ok = text == header && readLine(fd, line);
+    int id = 0;
+    if (ok) {
+        splitFields(line, fields);
+        ok = fields.size() == 4 && fields[0] == "levels" && fields[2] == "next-id";
+        if (ok)
+            id = atoi(fields[3].c_str());
+    }
+    //-- make the models of each level, then change the search only if all went well
+    std::unordered_map<std::string, Model*> byName;
+    byName[kept[0][0]->getPrintName()] = kept[0][0];
+    std::vector<std::vector<Model*> > levelModels;
+    std::vector<long> counts[3];
+    while (ok && readLine(fd, line)) {
+        splitFields(line, fields);
+        if (fields.size() != 6 || fields[0] != "level" || atoi(fields[1].c_str()) != (int) levelModels.size() + 1) {
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < 3; i++)
+            counts[i].push_back(atol(fields[i + 2].c_str()));
+        long count = atol(fields[5].c_str());
+        std::vector<Model*> models;
+        for (long m = 0; ok && m < count; m++) {
+            Model *model = NULL;
+            if (readLine(fd, line)) {
+                splitFields(line, fields);
+                if (fields.size() >= 3 && fields.size() % 2 == 1 && byName.count(fields[2]))
+                    model = managerKind()[0] == 's' ? manager->makeSbModel(fields[0].c_str(), true)
+                            : manager->makeModel(fields[0].c_str(), true);
+            }
+            if (model == NULL) {
+                ok = false;
+                break;
+            }
+            model->setID(atoi(fields[1].c_str()));
+            model->setProgenitor(byName[fields[2]]);
+            for (size_t i = 3; i + 1 < fields.size(); i += 2)
+                model->setAttribute(keepAttributeName(fields[i]), strtod(fields[i + 1].c_str(), NULL));
+            models.push_back(model);
+        }
+        for (size_t i = 0; i < models.size(); i++)
+            byName[models[i]->getPrintName()] = models[i];
+        levelModels.push_back(models);
+    }
+    fclose(fd);
+    if (!ok || levelModels.empty()) {
+        printf("WARNING: the checkpoint %s isn't for this search; starting from the beginning\n", file);
+        return false;
+    }
+    for (size_t level = 0; level < levelModels.size(); level++) {
+        kept.push_back(levelModels[level]);
+        keptSet.insert(levelModels[level].begin(), levelModels[level].end());
+        generated.push_back(counts[0][level]);
+        candidates.push_back(counts[1][level]);
+        pruned.push_back(counts[2][level]);
+    }
+    *nextID = id;
+    return true;
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "Constants.h"
+#include "DiskCache.h"
+#include "Model.h"
+#include "Relation.h"
+#include "Table.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-- the statistics which are saved for models. The others are cheap to compute
+//-- from these, or depend on the reference model.
+static const char *modelAttributes[] = { ATTRIBUTE_DF, ATTRIBUTE_ALG_H, ATTRIBUTE_FIT_H, ATTRIBUTE_FIT_T,
+        ATTRIBUTE_FIT_P2, ATTRIBUTE_PCT_CORRECT_DATA, ATTRIBUTE_IPF_ITERATIONS, ATTRIBUTE_IPF_ERROR };
+static const int modelAttributeCount = sizeof(modelAttributes) / sizeof(modelAttributes[0]);
+
+//-- header of a projection file; the tuples follow it
+struct TableHeader {
+    char magic[8];
+    long long keySize;
+    long long tupleBytes;
+    long long tupleCount;
+};
+static const char tableMagic[8] = { 'O', 'C', 'C', 'P', 'R', 'O', 'J', '1' };
+
+static bool makeDirectory(const std::string &dir) {
+    return mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+DiskCache::DiskCache(const char *dir, unsigned long long dataHash) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", dataHash);
+    path = std::string(dir) + "/" + name;
+    modelFile = NULL;
+    ready = makeDirectory(dir) && makeDirectory(path);
+    if (ready) {
+        loadModels();
+        modelFile = fopen((path + "/models").c_str(), "a");
+    }
+}
+
+DiskCache::~DiskCache() {
+    if (modelFile)
+        fclose(modelFile);
+}
+
+unsigned long long DiskCache::hashBytes(unsigned long long hash, const void *bytes, long long count) {
+    const unsigned char *cp = (const unsigned char *) bytes;
+    for (long long i = 0; i < count; i++) {
+        hash ^= cp[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+//-- tablePath - the file for a relation's projection. Characters of the name which
+//-- might not be safe in a file name are written in hex.
+std::string DiskCache::tablePath(Relation *rel) {
+    std::string file = path + "/rel-";
+    char hex[4];
+    for (const char *cp = rel->getPrintName(); *cp; cp++) {
+        if ((*cp >= 'a' && *cp <= 'z') || (*cp >= 'A' && *cp <= 'Z') || (*cp >= '0' && *cp <= '9')) {
+            file += *cp;
+        } else {
+            snprintf(hex, sizeof(hex), "%%%02x", (unsigned char) *cp);
+            file += hex;
+        }
+    }
+    return file;
+}
+
+bool DiskCache::loadTable(Relation *rel, Table *table) {
+    if (!ready)
+        return false;
+    int fd = ::open(tablePath(rel).c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    bool loaded = false;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t) sizeof(TableHeader)) {
+        void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const TableHeader *header = (const TableHeader *) map;
+            if (memcmp(header->magic, tableMagic, sizeof(tableMagic)) == 0
+                    && header->keySize == table->getKeySize() && header->tupleBytes == table->getTupleBytes()
+                    && info.st_size == (off_t) (sizeof(TableHeader) + header->tupleBytes * header->tupleCount)) {
+                table->setTuples(header + 1, header->tupleCount);
+                loaded = true;
+            }
+            munmap(map, info.st_size);
+        }
+    }
+    close(fd);
+    return loaded;
+}
+
+//-- saveTable - write to a temporary file and rename it, so that a partly
+//-- written file is never read.
+void DiskCache::saveTable(Relation *rel, Table *table) {
+    if (!ready)
+        return;
+    std::string file = tablePath(rel);
+    std::string temp = file + ".tmp";
+    FILE *fd = fopen(temp.c_str(), "wb");
+    if (fd == NULL)
+        return;
+    TableHeader header;
+    memcpy(header.magic, tableMagic, sizeof(tableMagic));
+    header.keySize = table->getKeySize();
+    header.tupleBytes = table->getTupleBytes();
+    header.tupleCount = table->getTupleCount();
+    bool ok = fwrite(&header, sizeof(header), 1, fd) == 1;
+    if (ok && header.tupleCount > 0)
+        ok = fwrite(table->getTupleData(), header.tupleBytes, header.tupleCount, fd) == (size_t) header.tupleCount;
+    ok = (fclose(fd) == 0) && ok;
+    if (!ok || rename(temp.c_str(), file.c_str()) != 0)
+        unlink(temp.c_str());
+}
+
+//-- loadModels - read the model file. Each line is a model name followed by
+//-- attribute name and value pairs, separated by tabs. Later lines add to (or
+//-- replace) the values of earlier ones.
+void DiskCache::loadModels() {
+    FILE *fd = fopen((path + "/models").c_str(), "r");
+    if (fd == NULL)
+        return;
+    std::string line;
+    int c;
+    do {
+        c = fgetc(fd);
+        if (c != '\n' && c != EOF) {
+            line += (char) c;
+            continue;
+        }
+        char *buf = strdup(line.c_str());
+        char *save = NULL;
+        char *name = strtok_r(buf, "\t", &save);
+        if (name) {
+            AttributeMap &attributes = models[name];
+            char *attr, *value;
+            while ((attr = strtok_r(NULL, "\t", &save)) && (value = strtok_r(NULL, "\t", &save)))
+                attributes[attr] = strtod(value, NULL);
+        }
+        free(buf);
+        line.clear();
+    } while (c != EOF);
+    fclose(fd);
+}
+
+bool DiskCache::restoreModel(Model *model, const char *const *attributes, int count) {
+    if (!ready)
+        return false;
+    std::lock_guard<std::mutex> lock(modelMutex);
+    std::unordered_map<std::string, AttributeMap>::iterator found = models.find(model->getPrintName());
+    if (found == models.end())
+        return false;
+    for (int i = 0; i < count; i++) {
+        AttributeMap::iterator it = found->second.find(attributes[i]);
+        if (it != found->second.end() && model->getAttribute(attributes[i]) < 0)
+            model->setAttribute(attributes[i], it->second);
+    }
+    return true;
+}
+
+void DiskCache::saveModel(Model *model) {
+    if (modelFile == NULL)
+        return;
+    std::lock_guard<std::mutex> lock(modelMutex);
+    const char *name = model->getPrintName();
+    AttributeMap &saved = models[name];
+    bool changed = false;
+    for (int i = 0; i < modelAttributeCount; i++) {
+        double value = model->getAttribute(modelAttributes[i]);
+        if (value < 0)
+            continue;
+        AttributeMap::iterator it = saved.find(modelAttributes[i]);
+        if (it != saved.end() && it->second == value)
+            continue;
+        saved[modelAttributes[i]] = value;
+        changed = true;
+    }
+    if (!changed)
+        return;
+    fputs(name, modelFile);
+    for (AttributeMap::iterator it = saved.begin(); it != saved.end(); ++it)
+        fprintf(modelFile, "\t%s\t%.17g", it->first.c_str(), it->second);
+    fputc('\n', modelFile);
+    fflush(modelFile);
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "FitCache.h"
+#include "Model.h"
+#include "Table.h"
+
+#include <stdio.h>
+
+FitCache::FitCache(long long budget) :
+        budget(budget), bytes(0) {
+}
+
+//-- destroy fit cache.  This also deletes all the tables held in the cache.
+FitCache::~FitCache() {
+    for (EntryList::iterator it = lru.begin(); it != lru.end(); ++it) {
+        delete it->table;
+    }
+}
+
+long long FitCache::size() {
+    return bytes;
+}
+
+void FitCache::setBudget(long long newBudget) {
+    budget = newBudget;
+    evict(NULL);
+}
+
+//-- findTable - find the fit table for a model, and move it to the front of the LRU list.
+Table *FitCache::findTable(Model *model) {
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = index.find(model->getPrintName());
+    if (found == index.end())
+        return NULL;
+    EntryList::iterator it = found->second;
+    if (it != lru.begin())
+        lru.splice(lru.begin(), lru, it);
+    return it->table;
+}
+
+void FitCache::addTable(Model *model, Table *table, bool pinned, double ipfIterations, double ipfError) {
+    const char *name = model->getPrintName();
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = index.find(name);
+    if (found != index.end()) {
+        pinned = pinned || found->second->pinned;
+        remove(found->second);
+    }
+    Entry entry;
+    entry.name = name;
+    entry.table = table;
+    entry.bytes = table->size();
+    entry.pinned = pinned;
+    entry.holds = 0;
+    entry.ipfIterations = ipfIterations;
+    entry.ipfError = ipfError;
+    lru.push_front(entry);
+    index[entry.name] = lru.begin();
+    tableIndex[table] = lru.begin();
+    bytes += entry.bytes;
+    evict(&lru.front());
+}
+
+void FitCache::restoreAttributes(Model *model) {
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = index.find(model->getPrintName());
+    if (found == index.end())
+        return;
+    Entry &entry = *found->second;
+    if (entry.ipfIterations >= 0 && model->getAttribute(ATTRIBUTE_IPF_ITERATIONS) < 0) {
+        model->setAttribute(ATTRIBUTE_IPF_ITERATIONS, entry.ipfIterations);
+        model->setAttribute(ATTRIBUTE_IPF_ERROR, entry.ipfError);
+    }
+}
+
+bool FitCache::deleteTable(Model *model) {
+    std::unordered_map<std::string, EntryList::iterator>::iterator found = index.find(model->getPrintName());
+    if (found == index.end())
+        return false;
+    remove(found->second);
+    return true;
+}
+
+void FitCache::deleteUnpinned() {
+    EntryList::iterator it = lru.begin();
+    while (it != lru.end()) {
+        EntryList::iterator next = it;
+        ++next;
+        if (!it->pinned && it->holds == 0)
+            remove(it);
+        it = next;
+    }
+}
+
+void FitCache::holdTable(Table *table) {
+    std::unordered_map<Table*, EntryList::iterator>::iterator found = tableIndex.find(table);
+    if (found != tableIndex.end())
+        found->second->holds++;
+}
+
+void FitCache::releaseTable(Table *table) {
+    std::unordered_map<Table*, EntryList::iterator>::iterator found = tableIndex.find(table);
+    if (found != tableIndex.end() && found->second->holds > 0)
+        found->second->holds--;
+}
+
+//-- evict - delete least recently used, unpinned tables until the cache is within
+//-- budget. The entry being added is never evicted, even if it alone exceeds the budget.
+void FitCache::evict(Entry *keep) {
+    EntryList::iterator it = lru.end();
+    while (bytes > budget && it != lru.begin()) {
+        --it;
+        if (it->pinned || it->holds > 0 || &*it == keep)
+            continue;
+        EntryList::iterator victim = it++;
+        remove(victim);
+    }
+}
+
+void FitCache::remove(EntryList::iterator it) {
+    bytes -= it->bytes;
+    delete it->table;
+    index.erase(it->name);
+    tableIndex.erase(it->table);
+    lru.erase(it);
+}
+
+//-- dump - print out all entries in LRU order
+void FitCache::dump() {
+    printf("\nDumping FitCache: %lld of %lld bytes\n", bytes, budget);
+    for (EntryList::iterator it = lru.begin(); it != lru.end(); ++it) {
+        printf("\t%s%s%s: %lld tuples, %lld bytes\n", it->name.c_str(), it->pinned ? " (pinned)" : "",
+                it->holds > 0 ? " (held)" : "", it->table->getTupleCount(), it->bytes);
+    }
+}
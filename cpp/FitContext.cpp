@@ -0,0 +1,38 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "FitContext.h"
+#include "ManagerBase.h"
+#include "Table.h"
+
+FitContext::FitContext(Table *data) :
+        data(data), fitTable1(NULL), fitTable2(NULL), projTable(NULL), currentFit(NULL), bpProcessor(NULL) {
+}
+
+FitContext::~FitContext() {
+    if (fitTable1) delete fitTable1;
+    if (fitTable2) delete fitTable2;
+    if (projTable) delete projTable;
+    if (bpProcessor) delete bpProcessor;
+}
+
+void FitContext::makeTables(int keysize, long long size) {
+    if (!fitTable1)
+        fitTable1 = new Table(keysize, size);
+    if (!fitTable2)
+        fitTable2 = new Table(keysize, size);
+    if (!projTable)
+        projTable = new Table(keysize, size);
+}
+
+Table *FitContext::disownFit() {
+    Table *fit = fitTable1;
+    if (currentFit == fitTable1)
+        currentFit = NULL;
+    fitTable1 = NULL;
+    return fit;
+}
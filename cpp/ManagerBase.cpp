@@ -10,6 +10,8 @@
 #include <gmp.h>
 #include <fenv.h>
 #include <math.h>
+#include "DiskCache.h"
+#include "FitCache.h"
 #include "Input.h"
 #include "Key.h"
 #include "ManagerBase.h"
@@ -145,23 +147,20 @@ ManagerBase::ManagerBase(VariableList *vars, Table *input) :
     topRef = bottomRef = refModel = NULL;
     relCache = new RelCache;
     modelCache = new ModelCache;
+    fitCache = new FitCache;
+    diskCache = NULL;
     sampleSize = 0;
     testSampleSize = 0;
     options = new Options();
     inputH = -1;
-    stateSpaceSize = 0;
     dataLines = 0;
-    fitTable1 = NULL;
-    fitTable2 = NULL;
-    projTable = NULL;
+    fitContext = new FitContext();
+    activeFits = 0;
     inputData = testData = NULL;
     DVOrder = NULL;
     searchDirection = Direction::Ascending;
     useInverseNotation = 0;
     valuesAreFunctions = false;
-    intersectArray = NULL;
-    intersectCount = 0;
-    intersectMax = 1;
     functionConstant = 0;
     negativeConstant = 0;
     signal(SIGSEGV, segfault_handler);
@@ -176,12 +175,11 @@ void ManagerBase::setAlphaThreshold(double thresh)
 
 ManagerBase::~ManagerBase() {
     if (testData) delete testData;
-    if (fitTable1) delete fitTable1;
-    if (fitTable2) delete fitTable2;
-    if (projTable) delete projTable;
-    if (intersectArray) delete[] intersectArray;
+    delete fitContext;
     if (DVOrder) delete[] DVOrder;
     delete options;
+    if (diskCache) delete diskCache;
+    delete fitCache;
     delete modelCache;
     delete relCache;
     if (varList) delete varList;
@@ -245,75 +243,75 @@ int ManagerBase::addConstraint(int varcount, int *varindices, int *stateindices,
 //-- look in relCache and, if not found, make a new relation and store in relCache
 // *** warning: this function sorts varindices in place ***
 Relation *ManagerBase::getRelation(int *input_vars, int varcount, bool make_project, int *input_states) {
-    int* varindices = new int[varcount];
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    //-- sort a copy of the variables (and states), and look for the relation before
+    //-- allocating anything, since it is usually already in the cache.
+    int varindices[varcount > 0 ? varcount : 1];
+    int statebuf[varcount > 0 ? varcount : 1];
+    int *stateindices = NULL;
     memcpy(varindices, input_vars, varcount * sizeof(int));
-    int* stateindices = NULL;
     if (input_states != NULL) {
-        stateindices = new int[varcount];
+        stateindices = statebuf;
         memcpy(stateindices, input_states, varcount * sizeof(int));
     }
-    long stateconstsz = 0;
     Relation::sort(varindices, varcount, stateindices);
+    Relation *rel = relCache->findRelation(VarSet(varList->getVarCount(), varindices, varcount), stateindices);
+    if (rel == NULL) {
+        rel = makeRelation(varindices, varcount, stateindices);
+        //-- the mask is made here, under the lock, so that fits can use it at once
+        rel->getMask();
+    }
+    if (make_project) {
+        makeProjection(rel);
+    }
+    return rel;
+}
+
+//-- makeRelation - make a new relation from sorted variables (and states), and
+//-- store it in the relCache.
+Relation *ManagerBase::makeRelation(int *varindices, int varcount, int *stateindices) {
     int keysize = getKeySize();
     Relation *rel;
     if (stateindices != NULL) {
         int *stateindices1 = new int[varcount];
-        KeySegment* mask = new KeySegment[keysize];
         KeySegment* start1 = new KeySegment[keysize];
         memset(stateindices1, 0, varcount * sizeof(int));
-        memset(mask, 0, keysize * sizeof(KeySegment));
         memset(start1, 0, keysize * sizeof(KeySegment));
-        Key::buildMask(mask, keysize, varList, varindices, varcount);
         Key::buildMask(start1, keysize, varList, varindices, varcount);
-        stateconstsz = calcStateConstSize(varcount, varindices, stateindices);
+        long stateconstsz = calcStateConstSize(varcount, varindices, stateindices);
         rel = new Relation(varList, varList->getVarCount(), keysize, stateconstsz);
         for (int i = 0; i < varcount; i++) {
             rel->addVariable(varindices[i], stateindices[i]);
         }
-        if (!relCache->addRelation(rel)) {
-            Relation *cached_rel = relCache->findRelation(rel->getPrintName());
-            delete rel;
-            rel = cached_rel;
-        } else {
-            //make starting constraint
-            for (int i = 0; i < varcount; i++) {
-                if (stateindices[i] == DONT_CARE) {
-                    stateindices1[i] = 0x00;
-                } else {
-                    stateindices1[i] = stateindices[i];
-                }
+        relCache->addRelation(rel);
+        //make starting constraint
+        for (int i = 0; i < varcount; i++) {
+            if (stateindices[i] == DONT_CARE) {
+                stateindices1[i] = 0x00;
+            } else {
+                stateindices1[i] = stateindices[i];
             }
-            //build the first constraint and then loop
-            Key::buildKey(start1, keysize, varList, varindices, stateindices1, varcount);
-            rel->getStateConstraints()->addConstraint(start1);
-            addConstraint(varcount, varindices, stateindices, stateindices1, start1, rel);
         }
+        //build the first constraint and then loop
+        Key::buildKey(start1, keysize, varList, varindices, stateindices1, varcount);
+        rel->getStateConstraints()->addConstraint(start1);
+        addConstraint(varcount, varindices, stateindices, stateindices1, start1, rel);
         delete[] start1;
-        delete[] mask;
         delete[] stateindices1;
-        delete[] stateindices;
     } else {
         rel = new Relation(varList, varList->getVarCount());
         for (int i = 0; i < varcount; i++) {
             rel->addVariable(varindices[i]);
         }
-        if (!relCache->addRelation(rel)) {
-            Relation *cached_rel = relCache->findRelation(rel->getPrintName());
-            delete rel;
-            rel = cached_rel;
-        }
-    }
-    if (make_project) {
-        makeProjection(rel);
+        relCache->addRelation(rel);
     }
-    delete[] varindices;
     return rel;
 }
 
 // "skip" is the index of the variable in the varList
 Relation *ManagerBase::getChildRelation(Relation *rel, int skip, bool makeProject, int *stateindices) {
     int order = rel->getVariableCount();
-    int *varindices = new int[order];
+    int varindices[order];
     int slot = 0;
     Relation *newRel = NULL;
     for (int i = 0; i < order; i++) {
@@ -323,15 +321,17 @@ Relation *ManagerBase::getChildRelation(Relation *rel, int skip, bool makeProjec
     }
     //-- build and cache the relation
     newRel = getRelation(varindices, order - 1, makeProject, stateindices);
-    delete varindices;
     return newRel;
 }
 
 // This function is a special case of the other makeProjection(), further below.
 // It projects the input data into the table for a relation.
 bool ManagerBase::makeProjection(Relation *rel) {
-    if (rel->getTable())
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    if (rel->getTable()) {
+        relCache->useTable(rel);
         return true; // table already computed
+    }
 
     //-- create the projection data for a given relation. Go through
     //-- the inputData, and for each tuple, sum it into the table for the relation.
@@ -342,7 +342,12 @@ bool ManagerBase::makeProjection(Relation *rel) {
     //logProjection(rel->getPrintName());
     Table *table = new Table(keysize, start_size);
     rel->setTable(table);
-    makeProjection(inputData, table, rel);
+    if (diskCache == NULL || !diskCache->loadTable(rel, table)) {
+        makeProjection(inputData, table, rel);
+        if (diskCache)
+            diskCache->saveTable(rel, table);
+    }
+    relCache->addTable(rel);
     return true;
 }
 
@@ -538,50 +543,47 @@ int ManagerBase::getDvOrder(int index) {
     return NULL;
 }
 
-static double *sort_freq;
-static Variable *sort_dv_var;
-int sortDV(const void *d1, const void *d2) {
-    int a = *(int*) d1;
-    int b = *(int*) d2;
-    // Would prefer to use DBL_EPSILON here, but the frequencies we get for DV values (from the bottom reference)
-    // are not precise enough for some reason.
-    if (fabs(sort_freq[a] - sort_freq[b]) < 1e-10) {
-        return strcmp(sort_dv_var->valmap[a], sort_dv_var->valmap[b]);
-    }
-    if (sort_freq[a] > sort_freq[b]) {
-        return -1;
-    }
-    if (sort_freq[a] < sort_freq[b]) {
-        return 1;
+//-- orders the values of the DV by decreasing frequency, then by name
+struct DVOrderCompare {
+    const double *freq;
+    const Variable *dv;
+    bool operator()(int a, int b) const {
+        // Would prefer to use DBL_EPSILON here, but the frequencies we get for DV values (from the bottom reference)
+        // are not precise enough for some reason.
+        if (fabs(freq[a] - freq[b]) < 1e-10) {
+            return strcmp(dv->valmap[a], dv->valmap[b]) < 0;
+        }
+        return freq[a] > freq[b];
     }
-    // Put this again, just in case.
-    return strcmp(sort_dv_var->valmap[a], sort_dv_var->valmap[b]);
-}
+};
 
 void ManagerBase::createDvOrder() {
     if (!varList->isDirected())
         return;
     if (DVOrder != NULL)
         return;
-    sort_dv_var = varList->getVariable(varList->getDV());
-    int dv_card = sort_dv_var->cardinality;
+    Variable *dv = varList->getVariable(varList->getDV());
+    int dv_card = dv->cardinality;
     DVOrder = new int[dv_card];
     // Build an array of frequencies, taken from the dependent relation (from the bottom reference)
     long long k;
     Table *depTable;
     for (k = 0; k < bottomRef->getRelationCount(); ++k) {
         if (!bottomRef->getRelation(k)->isIndependentOnly()) {
+            makeProjection(bottomRef->getRelation(k));
             depTable = bottomRef->getRelation(k)->getTable();
             break;
         }
     }
-    sort_freq = new double[dv_card];
+    double *freq = new double[dv_card];
     for (k = 0; k < depTable->getTupleCount(); ++k) {
-        sort_freq[Key::getKeyValue(depTable->getKey(k), keysize, varList, varList->getDV())] = depTable->getValue(k);
+        freq[Key::getKeyValue(depTable->getKey(k), keysize, varList, varList->getDV())] = depTable->getValue(k);
     }
     for (int i = 0; i < dv_card; ++i)
         DVOrder[i] = i;
-    qsort(DVOrder, dv_card, sizeof(int), sortDV);
+    DVOrderCompare byFrequency = { freq, dv };
+    std::stable_sort(DVOrder, DVOrder + dv_card, byFrequency);
+    delete[] freq;
 }
 
 // Creates a product of the cardinalities of any variables missing from the model
@@ -687,35 +689,80 @@ bool ManagerBase::makeProjections(Model *model) {
 }
 
 void ManagerBase::deleteTablesFromCache() {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
     relCache->deleteTables();
+    setCurrentFit(NULL);
+    fitCache->deleteUnpinned();
 }
 
 bool ManagerBase::deleteModelFromCache(Model *model) {
+    if (model == NULL)
+        return false;
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    if (fitCache->findTable(model) == fitContext->currentFit)
+        setCurrentFit(NULL);
+    fitCache->deleteTable(model);
     return modelCache->deleteModel(model);
 }
 
+void ManagerBase::setFitCacheBudget(long long bytes) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    fitCache->setBudget(bytes);
+}
+
+//-- setCurrentFit - make a cached table the default context's current fit. It is
+//-- held in the cache until it stops being current, so getFitTable() stays valid
+//-- while other models are fit in other contexts.
+void ManagerBase::setCurrentFit(Table *fit) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    if (fitContext->currentFit)
+        fitCache->releaseTable(fitContext->currentFit);
+    fitContext->currentFit = fit;
+    if (fit)
+        fitCache->holdTable(fit);
+}
+
+void ManagerBase::setProjectionCacheBudget(long long bytes) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    relCache->setTableBudget(bytes);
+    relCache->trimTables();
+}
+
+void ManagerBase::pinProjections(Model *model) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    int count = model->getRelationCount();
+    for (int i = 0; i < count; i++) {
+        Relation *rel = model->getRelation(i);
+        makeProjection(rel);
+        relCache->pinTable(rel);
+    }
+}
+
+//-- trimProjections - keep the projections, and the remembered intersections,
+//-- within budget. A fit in another context may be using any of the tables, so no
+//-- table is deleted while one is running. (Intersections are only relations from
+//-- the cache, so forgetting them is always safe.)
+void ManagerBase::trimProjections() {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    long long budget = relCache->getTableBudget();
+    if (budget > 0 && relCache->getTableBytes() + (long long) (intersectMemo.size() * INTERSECT_MEMO_ENTRY_BYTES) > budget)
+        intersectMemo.clear();
+    if (activeFits == 0)
+        relCache->trimTables();
+}
+
 //-- intersect two variable lists, producing a third. returns true if intersection
 //-- is not empty, and returns the list and count of common variables
 static bool intersect(Relation *rel1, Relation *rel2, int* &var, int &count) {
-    int *var1, *var2;
-    int count1, count2;
-    count1 = rel1->getVariableCount();
-    var1 = rel1->getVariables();
-    count2 = rel2->getVariableCount();
-    var2 = rel2->getVariables();
-
     var = NULL;
     count = 0;
-    for (int i = 0; i < count1; i++) {
-        for (int j = 0; j < count2; j++) {
-            if (var1[i] == var2[j]) {
-                if (var == NULL)
-                    var = new int[count1]; //this is sure to be large enough
-                var[count++] = var1[i];
-            }
-        }
-    }
-    return var != NULL;
+    if (!rel1->getVarSet().intersects(rel2->getVarSet()))
+        return false;
+    VarSet common(rel1->getVarSet());
+    common &= rel2->getVarSet();
+    var = new int[rel1->getVariableCount()]; //this is sure to be large enough
+    count = common.copyVariables(var);
+    return true;
 }
 
 
@@ -781,11 +828,21 @@ void ManagerBase::makeSbExpansion(Relation *rel, Table *table) {
     //table->normalize();
 }
 
-bool ManagerBase::hasLoops(Model *model) {
+bool ManagerBase::hasLoops(Model *model, Model *parent) {
     bool loops;
     double dloops = model->getAttribute(ATTRIBUTE_LOOPS);
     if (dloops < 0) { // -1 = not set, 1 = true, 0 = false
-        loops = ocHasLoops(model);
+        //-- the relations' variable sets are made on first use
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        Relation *added = NULL;
+        if (parent == NULL)
+            parent = model->getProgenitor();
+        if (parent != NULL && parent != model)
+            added = addedRelation(parent, model);
+        if (added)
+            loops = ocHasLoopsWithRelation(parent, added);
+        else
+            loops = ocHasLoops(model);
         model->setAttribute(ATTRIBUTE_LOOPS, loops ? 1 : 0);
     } else {
         loops = (dloops > 0);
@@ -793,6 +850,45 @@ bool ManagerBase::hasLoops(Model *model) {
     return loops;
 }
 
+bool ManagerBase::hasLoopsWith(Model *model, const VarSet &newVars) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    return ocHasLoopsWithVars(model, newVars, !hasLoops(model));
+}
+
+//-- addedRelation - if the model is a loopless parent with one relation added
+//-- (and any relations contained in that one dropped), return the added relation.
+//-- Otherwise return null. Relations come from the cache, so pointers can be compared.
+Relation *ManagerBase::addedRelation(Model *parent, Model *model) {
+    if (parent->isStateBased() || model->isStateBased() || parent->getAttribute(ATTRIBUTE_LOOPS) != 0)
+        return NULL;
+    int parentCount = parent->getRelationCount();
+    int count = model->getRelationCount();
+    Relation *added = NULL;
+    int i, j;
+    for (j = 0; j < count; j++) {
+        Relation *rel = model->getRelation(j);
+        for (i = 0; i < parentCount; i++)
+            if (parent->getRelation(i) == rel)
+                break;
+        if (i < parentCount)
+            continue;
+        if (added)
+            return NULL;
+        added = rel;
+    }
+    if (added == NULL)
+        return NULL;
+    for (i = 0; i < parentCount; i++) {
+        Relation *rel = parent->getRelation(i);
+        for (j = 0; j < count; j++)
+            if (model->getRelation(j) == rel)
+                break;
+        if (j >= count && !added->contains(rel))
+            return NULL;
+    }
+    return added;
+}
+
 // For information purposes, tells us the direction of the search.
 // 0 = up, 1 = down
 void ManagerBase::setSearchDirection(Direction dir) {
@@ -800,6 +896,7 @@ void ManagerBase::setSearchDirection(Direction dir) {
 }
 
 double ManagerBase::computeDF(Relation *rel) { // degrees of freedom
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
     double df = rel->getAttribute(ATTRIBUTE_DF);
     if (df < 0.0) { //-- not set yet
         df = ::ocDegreesOfFreedom(rel);
@@ -808,11 +905,22 @@ double ManagerBase::computeDF(Relation *rel) { // degrees of freedom
     return df;
 }
 
+//-- the statistics restored from the disk cache by each routine which computes them
+static const char *dfAttributes[] = { ATTRIBUTE_DF };
+static const char *dfAndHAttributes[] = { ATTRIBUTE_DF, ATTRIBUTE_ALG_H };
+static const char *fitAttributes[] = { ATTRIBUTE_FIT_H, ATTRIBUTE_FIT_T, ATTRIBUTE_FIT_P2,
+        ATTRIBUTE_IPF_ITERATIONS, ATTRIBUTE_IPF_ERROR };
+
 double ManagerBase::computeDfSb(Model *model) {
     double df = model->getAttribute(ATTRIBUTE_DF);
+    if (df < 0.0 && diskCache
+            && diskCache->restoreModel(model, dfAttributes, sizeof(dfAttributes) / sizeof(dfAttributes[0])))
+        df = model->getAttribute(ATTRIBUTE_DF);
     if (df < 0.0) { //-- not set yet
         df = ::ocDegreesOfFreedomStateBased(model);
         model->setAttribute(ATTRIBUTE_DF, df);
+        if (diskCache)
+            diskCache->saveModel(model);
     }
     return df;
 }
@@ -823,7 +931,8 @@ double ManagerBase::computeDF(Model *model) {
         if (model->isStateBased()) {
             df = computeDfSb(model);
         } else {
-            calculateDfAndEntropy(model);
+            if (!calculateDfIncremental(model))
+                calculateDfAndEntropy(model);
             df = model->getAttribute(ATTRIBUTE_DF);
         }
     }
@@ -832,6 +941,7 @@ double ManagerBase::computeDF(Model *model) {
 
 double ManagerBase::computeH(Relation *rel) // uncertainty
         {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
     double h = rel->getAttribute(ATTRIBUTE_H);
     if (h < 0) { //-- not set yet
         Table *table = rel->getTable();
@@ -845,7 +955,7 @@ double ManagerBase::computeH(Relation *rel) // uncertainty
     return h;
 }
 
-double ManagerBase::computeH(Model *model, HMethod method, int SB) {
+double ManagerBase::computeH(Model *model, HMethod method, int SB, FitContext *context) {
     double h;
     bool loops;
 
@@ -861,9 +971,8 @@ double ManagerBase::computeH(Model *model, HMethod method, int SB) {
     if (loops) {
         h = model->getAttribute(ATTRIBUTE_FIT_H);
         if (h < 0) {
-            makeFitTable(model);
-            h = ocEntropy(fitTable1);
-            model->setAttribute(ATTRIBUTE_FIT_H, h);
+            computeFitStatistics(model, context);
+            h = model->getAttribute(ATTRIBUTE_FIT_H);
             model->setAttribute(ATTRIBUTE_H, h);
         }
     } else {
@@ -872,12 +981,31 @@ double ManagerBase::computeH(Model *model, HMethod method, int SB) {
             calculateDfAndEntropy(model);
             h = model->getAttribute(ATTRIBUTE_ALG_H);
         }
-        model->setAttribute(ATTRIBUTE_H, h);
+        //-- a model whose H is set, such as a reference model, is only read, so
+        //-- that fits on other threads can use it
+        if (model->getAttribute(ATTRIBUTE_H) != h)
+            model->setAttribute(ATTRIBUTE_H, h);
     }
     return h;
 }
 
-double ManagerBase::computeTransmission(Model *model, HMethod method, int SB) {
+void ManagerBase::computeFitStatistics(Model *model, FitContext *context) {
+    if (model->getAttribute(ATTRIBUTE_FIT_P2) >= 0)
+        return;
+    if (diskCache && diskCache->restoreModel(model, fitAttributes, sizeof(fitAttributes) / sizeof(fitAttributes[0]))
+            && model->getAttribute(ATTRIBUTE_FIT_P2) >= 0)
+        return;
+    makeFitTable(model, context);
+    ocFitStats stats;
+    ocFitStatistics(inputData, getFitTable(context), (long) round(sampleSize), stats);
+    model->setAttribute(ATTRIBUTE_FIT_H, stats.h);
+    model->setAttribute(ATTRIBUTE_FIT_T, stats.t);
+    model->setAttribute(ATTRIBUTE_FIT_P2, stats.p2);
+    if (diskCache)
+        diskCache->saveModel(model);
+}
+
+double ManagerBase::computeTransmission(Model *model, HMethod method, int SB, FitContext *context) {
     //-- compute analytically. Krippendorf claims that you
     //-- can't do this for models with loops, but experimental
     //-- comparison indicates that loops don't matter in computing this.
@@ -888,9 +1016,9 @@ double ManagerBase::computeTransmission(Model *model, HMethod method, int SB) {
         double h = 0;
 
         if (SB) {
-            h = computeH(model, IPF, SB);
+            h = computeH(model, IPF, SB, context);
         } else {
-            h = computeH(model);
+            h = computeH(model, AUTO, 0, context);
         }
         t = h - inputH;
         model->setAttribute(ATTRIBUTE_ALG_T, t);
@@ -903,125 +1031,262 @@ struct DFAndHProc: public ocIntersectProcessor {
         double df;
         double h;
         ManagerBase *manager;
-        DFAndHProc(ManagerBase *mgr) {
+        bool withH; // if false, only DF is summed, and no projections are needed
+        DFAndHProc(ManagerBase *mgr, bool withH = true) {
             df = 0;
             h = 0;
             manager = mgr;
+            this->withH = withH;
         }
         void process(bool sign, Relation *rel, int count) {
             if (rel) {
                 df += (sign ? 1 : -1) * manager->computeDF(rel) * count;
-                h += (sign ? 1 : -1) * manager->computeH(rel) * count;
+                if (withH)
+                    h += (sign ? 1 : -1) * manager->computeH(rel) * count;
             }
         }
 };
 
 void ManagerBase::calculateDfAndEntropy(Model *model) {
     if ((model->getAttribute(ATTRIBUTE_DF) < 0) || (model->getAttribute(ATTRIBUTE_ALG_H) < 0)) {
+        if (diskCache
+                && diskCache->restoreModel(model, dfAndHAttributes, sizeof(dfAndHAttributes) / sizeof(dfAndHAttributes[0]))
+                && model->getAttribute(ATTRIBUTE_DF) >= 0 && model->getAttribute(ATTRIBUTE_ALG_H) >= 0)
+            return;
+        trimProjections();
         DFAndHProc processor(this);
-        if (intersectArray != NULL) {
-            delete[] intersectArray;
-            intersectCount = 0;
-            intersectMax = model->getRelationCount();
-            intersectArray = NULL;
-        }
         doIntersectionProcessing(model, &processor);
         model->setAttribute(ATTRIBUTE_DF, processor.df);
         model->setAttribute(ATTRIBUTE_ALG_H, processor.h);
+        if (diskCache)
+            diskCache->saveModel(model);
     }
 }
 
-void ManagerBase::doIntersectionProcessing(Model *model, ocIntersectProcessor *proc) {
-    //-- allocate intersect storage; this grows later if needed
-    if (intersectArray == NULL) {
-        intersectMax = model->getRelationCount();
-        intersectArray = new VarIntersect[intersectMax];
+//-- limit on the number of relations added and removed, for the incremental method
+#define INCREMENTAL_MAX_CHANGES 4
+
+bool ManagerBase::calculateDfIncremental(Model *model) {
+    Model *base = model->getProgenitor();
+    if (base == NULL || base == model || model->isStateBased() || base->isStateBased())
+        return false;
+    double df = base->getAttribute(ATTRIBUTE_DF);
+    if (df < 0)
+        return false;
+
+    //-- find the relations which differ. Relations come from the cache, so
+    //-- pointers can be compared.
+    std::vector<Relation*> current, added, removed;
+    int baseCount = base->getRelationCount();
+    int count = model->getRelationCount();
+    int i, j;
+    for (i = 0; i < baseCount; i++) {
+        Relation *rel = base->getRelation(i);
+        for (j = 0; j < count; j++)
+            if (model->getRelation(j) == rel)
+                break;
+        if (j < count)
+            current.push_back(rel);
+        else
+            removed.push_back(rel);
+    }
+    for (j = 0; j < count; j++) {
+        Relation *rel = model->getRelation(j);
+        for (i = 0; i < baseCount; i++)
+            if (base->getRelation(i) == rel)
+                break;
+        if (i >= baseCount)
+            added.push_back(rel);
     }
+    if (removed.size() + added.size() > INCREMENTAL_MAX_CHANGES)
+        return false;
+
+    //-- The inclusion-exclusion sum F over a list of relations L satisfies
+    //-- F(L + A) = F(L) + F(A) - F({R ^ A : R in L}). Removals undo this, working
+    //-- back from the progenitor's list; then the new relations are added.
+    //-- DF is a sum of whole numbers, so this is exact. (H isn't done this way, as
+    //-- rounding would build up along the chain of progenitors.)
+    double dDF, dH;
+    std::vector<Relation*> remaining(current);
+    for (i = removed.size() - 1; i >= 0; i--) {
+        std::vector<Relation*> others(remaining);
+        for (j = 0; j < i; j++)
+            others.push_back(removed[j]);
+        addedDfAndEntropy(others, removed[i], dDF, dH, false);
+        df -= dDF;
+    }
+    for (i = 0; i < added.size(); i++) {
+        addedDfAndEntropy(remaining, added[i], dDF, dH, false);
+        df += dDF;
+        remaining.push_back(added[i]);
+    }
+    model->setAttribute(ATTRIBUTE_DF, df);
+    return true;
+}
+
+double ManagerBase::computeHLowerBound(Model *model) {
+    calculateDfAndEntropy(model);
+    double h = model->getAttribute(ATTRIBUTE_ALG_H);
+    VarSet loopVars;
+    {
+        //-- the relations' variable sets are made on first use
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        ocLoopVariables(model, loopVars);
+    }
+    int vars[varList->getVarCount()];
+    int count = loopVars.copyVariables(vars);
+    if (count == 0)
+        return h;
+    //-- the inclusion-exclusion sum is exact for the loopless model, and adding the
+    //-- relation over the loops changes it by the terms which involve that relation
+    Relation *loops = getRelation(vars, count, true);
+    std::vector<Relation*> rels;
+    for (int i = 0; i < model->getRelationCount(); i++)
+        rels.push_back(model->getRelation(i));
+    double dDF, dH;
+    addedDfAndEntropy(rels, loops, dDF, dH);
+    return h + dH;
+}
+
+void ManagerBase::addedDfAndEntropy(std::vector<Relation*> &rels, Relation *rel, double &df, double &h, bool withH) {
+    //-- collect the overlaps of the new relation with the list. An overlap which is
+    //-- contained in another doesn't change the sum, so only the largest are kept.
+    std::vector<Relation*> overlaps;
+    for (size_t i = 0; i < rels.size(); i++) {
+        Relation *common = getIntersection(rels[i], rel);
+        if (common == NULL)
+            continue;
+        bool covered = false;
+        for (size_t k = 0; k < overlaps.size(); k++) {
+            if (overlaps[k]->contains(common)) {
+                covered = true;
+                break;
+            }
+        }
+        if (covered)
+            continue;
+        size_t kept = 0;
+        for (size_t k = 0; k < overlaps.size(); k++) {
+            if (!common->contains(overlaps[k]))
+                overlaps[kept++] = overlaps[k];
+        }
+        overlaps.resize(kept);
+        overlaps.push_back(common);
+    }
+    DFAndHProc processor(this, withH);
+    processor.process(true, rel, 1);
+    IntersectTermList terms;
+    makeIntersectTerms(overlaps.data(), overlaps.size(), terms);
+    for (size_t i = 0; i < terms.size(); i++) {
+        processor.process(!terms[i].sign, terms[i].rel, terms[i].count);
+    }
+    df = processor.df;
+    h = processor.h;
+}
+
+void ManagerBase::doIntersectionProcessing(Model *model, ocIntersectProcessor *proc) {
+    //-- the processor may use the projections, so they aren't trimmed meanwhile
+    activeFits++;
+    const IntersectTermList &terms = getIntersectTerms(model);
+    for (size_t i = 0; i < terms.size(); i++) {
+        //-- the relations need their projections (which may have been deleted
+        //-- since the terms were cached, or trimmed from the relation cache)
+        makeProjection(terms[i].rel);
+        proc->process(terms[i].sign, terms[i].rel, terms[i].count);
+    }
+    activeFits--;
+}
+
+const IntersectTermList &ManagerBase::getIntersectTerms(Model *model) {
+    IntersectTermList *terms = model->getIntersectTerms();
+    if (terms != NULL)
+        return *terms;
+    terms = new IntersectTermList;
     int count = model->getRelationCount();
-    VariableList *varList = model->getRelation(0)->getVariableList();
-    Relation *rel;
-    int i, j, k;
-    //-- go through the relations in the model and create VarIntersect entries
+    Relation **rels = new Relation*[count];
+    model->getRelations(rels, count);
+    makeIntersectTerms(rels, count, *terms);
+    delete[] rels;
+    model->setIntersectTerms(terms);
+    return *terms;
+}
+
+void ManagerBase::makeIntersectTerms(Relation **rels, int count, IntersectTermList &terms) {
+    int i, j;
+    //-- go through the relations and create VarIntersect entries
+    std::vector<VarIntersect> level0(count);
     for (i = 0; i < count; i++) {
-        rel = model->getRelation(i);
-        while (intersectCount >= intersectMax) {
-            intersectArray = (VarIntersect*) growStorage(intersectArray, sizeof(VarIntersect)*intersectMax, 2);
-            intersectMax *= 2;
-        }
-        VarIntersect *intersect = intersectArray + (intersectCount++);
-        intersect->rel = rel;
+        VarIntersect *intersect = &level0[i];
+        intersect->rel = rels[i];
         intersect->startIndex = i;
         intersect->sign = true;
         intersect->count = 1;
-        proc->process(intersect->sign, intersect->rel, intersect->count);
+        terms.push_back(IntersectTerm(intersect->rel, intersect->sign, intersect->count));
     }
-    int level0end = intersectCount;
     bool sign = true;
-    bool match;
 
     //-- given the previous level of intersection terms, construct the next level from
     //-- all intersections among the previous level. When an intersection is found, we
     //-- need to check the new intersections. If there is a match, we update its
-    //-- include count; if there is no match, we create a new one. This process
-    //-- terminates when no new terms have been added.
-    VarIntersect *ip, *jp, *newp;
-    VarIntersect *currentArray, *nextArray;
-    int currentCount, nextCount;
-    int nextMax;
-    int *newvars, newcount;
-    currentArray = intersectArray;
-    currentCount = intersectCount;
-    while (currentCount > 0) {
+    //-- include count; if there is no match, we create a new one. Matches are found
+    //-- through a hash on (relation, start index). This process terminates when no
+    //-- new terms have been added.
+    std::vector<VarIntersect> currentArray(level0), nextArray;
+    std::unordered_map<std::pair<Relation*, int>, size_t, RelationPairHash<int> > nextIndex;
+    while (currentArray.size() > 0) {
         sign = !sign;
-        nextArray = new VarIntersect[intersectMax];
-        nextCount = 0;
-        nextMax = intersectMax;
-        for (i = 0; i < currentCount; i++) {
-            for (j = currentArray[i].startIndex + 1; j < level0end; j++) {
-                ip = currentArray + i;
-                jp = intersectArray + j;
-                if (intersect(ip->rel, jp->rel, newvars, newcount)) {
-                    rel = getRelation(newvars, newcount, true);
-                    proc->process(sign, rel, ip->count);
-                    // only add the relation to the intersect array if it has any potential for overlap.
-                    // (when j==(level0end-1), that relation can be part of no further overlaps)
-                    if (j < (level0end - 1)) {
-                        match = false;
-                        for (k = 0; k < nextCount; k++) {
-                            if ((nextArray[k].rel == rel) && (nextArray[k].startIndex == j)) {
-                                match = true;
-                                nextArray[k].count += ip->count;
-                                break;
-                            }
-                        }
-                        if (!match) {
-                            while (nextCount >= nextMax) {
-                                nextArray = (VarIntersect*) growStorage(nextArray, sizeof(VarIntersect)*nextMax, 2);
-                                nextMax *= 2;
-                            }
-                            newp = nextArray + (nextCount++);
-                            newp->rel = rel;
-                            newp->startIndex = j;
-                            newp->sign = sign;
-                            newp->count = ip->count;
-                        }
+        nextArray.clear();
+        nextIndex.clear();
+        for (i = 0; i < currentArray.size(); i++) {
+            VarIntersect *ip = &currentArray[i];
+            for (j = ip->startIndex + 1; j < count; j++) {
+                Relation *rel = getIntersection(ip->rel, level0[j].rel);
+                if (rel == NULL)
+                    continue;
+                terms.push_back(IntersectTerm(rel, sign, ip->count));
+                // only add the relation to the next level if it has any potential for overlap.
+                // (when j==(count-1), that relation can be part of no further overlaps)
+                if (j < (count - 1)) {
+                    std::pair<Relation*, int> key(rel, j);
+                    std::unordered_map<std::pair<Relation*, int>, size_t, RelationPairHash<int> >::iterator found =
+                            nextIndex.find(key);
+                    if (found != nextIndex.end()) {
+                        nextArray[found->second].count += ip->count;
+                    } else {
+                        nextIndex[key] = nextArray.size();
+                        VarIntersect newp;
+                        newp.rel = rel;
+                        newp.startIndex = j;
+                        newp.sign = sign;
+                        newp.count = ip->count;
+                        nextArray.push_back(newp);
                     }
-                    delete[] newvars;
                 }
             }
         }
-        if (currentArray != intersectArray) {
-            delete[] currentArray;
-        }
-        currentArray = nextArray;
-        nextArray = NULL;
-        currentCount = nextCount;
-    }
-    if (currentArray != intersectArray) {
-        delete[] currentArray;
+        currentArray.swap(nextArray);
     }
 }
 
+Relation *ManagerBase::getIntersection(Relation *rel1, Relation *rel2) {
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    std::pair<Relation*, Relation*> key(rel1, rel2);
+    std::unordered_map<std::pair<Relation*, Relation*>, Relation*, RelationPairHash<Relation*> >::iterator found =
+            intersectMemo.find(key);
+    if (found != intersectMemo.end())
+        return found->second;
+    int *newvars, newcount;
+    Relation *rel = NULL;
+    if (intersect(rel1, rel2, newvars, newcount)) {
+        rel = getRelation(newvars, newcount, true);
+        delete[] newvars;
+    }
+    if (intersectMemo.size() >= INTERSECT_MEMO_MAX)
+        intersectMemo.clear();
+    intersectMemo[key] = rel;
+    return rel;
+}
+
 // !!! This function computes dependent stats whether or not this is a directed system. !!!
 // Perhaps this should be fixed. [jsf]
 void ManagerBase::computeStatistics(Relation *rel) {
@@ -1096,10 +1361,11 @@ void ManagerBase::computeRelWidth(Model *model) {
     model->setAttribute(ATTRIBUTE_MAX_REL_WIDTH, (double) maxwidth);
 }
 
-double ManagerBase::computeLR(Model *model) {
+double ManagerBase::computeLR(Model *model, FitContext *context) {
     double lr = model->getAttribute(ATTRIBUTE_LR);
     if (lr < 0) {
-        lr = fabs(2.0 * M_LN2 * sampleSize * (computeTransmission(model) - computeTransmission(refModel)));
+        lr = fabs(2.0 * M_LN2 * sampleSize * (computeTransmission(model, AUTO, 0, context)
+                - computeTransmission(refModel, AUTO, 0, context)));
         model->setAttribute(ATTRIBUTE_LR, lr);
     }
     return lr;
@@ -1307,7 +1573,7 @@ Model *ManagerBase::makeModel(const char *name, bool makeProject) {
     //-- put it in the cache; return the cached one if present
     if (!modelCache->addModel(model)) {
         //-- already exists in cache; return that one
-        Model *cachedModel = modelCache->findModel(model->getPrintName());
+        Model *cachedModel = modelCache->findModel(model);
         delete model;
         model = cachedModel;
     }
@@ -1367,7 +1633,7 @@ Model *ManagerBase::makeSbModel(const char *name, bool makeProject) {
             delete model, relName, vars;
             return NULL; // error in name
         }
-        model->addRelation(rel, true, getModelCache());
+        model->addRelation(rel, true);
         atStart = false;
     }
     model->completeSbModel();
@@ -1375,7 +1641,7 @@ Model *ManagerBase::makeSbModel(const char *name, bool makeProject) {
     //-- put it in the cache; return the cached one if present
     if (!modelCache->addModel(model)) {
         //-- already exists in cache; return that one
-        Model *cachedModel = modelCache->findModel(model->getPrintName());
+        Model *cachedModel = modelCache->findModel(model);
         delete model;
         model = cachedModel;
     }
@@ -1410,15 +1676,17 @@ void ManagerBase::dumpRelations() {
     relCache->dump();
 }
 
-void ManagerBase::fitTestAlgebraic(Model* model, Table* algTable, double missingCard, const FitIntersectMap& fitIs) {
+void ManagerBase::fitTestAlgebraic(Model* model, Table* algTable, double missingCard, const FitIntersectMap& fitIs,
+        Table* data) {
+    if (data == NULL) { data = inputData; }
     long long inSize = testData->getTupleCount();
 
     // for every tuple in test:
     for (long long ti = 0; ti < inSize; ti++) {
         KeySegment* tupleKey = testData->getKey(ti);
         
-        // if this tuple wasn't in inputData:
-        if (inputData->indexOf(tupleKey) == -1) {
+        // if this tuple wasn't in the fitted data:
+        if (data->indexOf(tupleKey) == -1) {
             double outValue = 1;
             
             // for each item in intersectArray
@@ -1443,67 +1711,76 @@ void ManagerBase::fitTestAlgebraic(Model* model, Table* algTable, double missing
     }
 }
 
-bool ManagerBase::makeFitTableAlgebraic(Model* model) {
+bool ManagerBase::makeFitTableAlgebraic(Model* model, FitContext* context) {
+    if (context == NULL) { context = fitContext; }
+    Table *data = context->data ? context->data : inputData;
     FitIntersectMap fitIs = computeIntersectLevels(model);
 
-    for (auto it=fitIs.begin(); it != fitIs.end(); ++it) {
-        makeProjection(it->first);
-    }
-
     double missingCard = getMissingCardinalityFactor(model);
     
-    long long inSize = inputData->getTupleCount();
+    long long inSize = data->getTupleCount();
     Table *algTable = new Table(keysize, inSize);
 
-    // for every tuple in training data:
+    // The fit is computed in the log domain. For each term of the intersection
+    // expansion, the log of the matching marginal times the term's exponent is
+    // summed into every training tuple, using the relation's index from input
+    // tuples to projection tuples (which is kept with the projection, so it is
+    // shared by all the models of a search level). Each term is one pass over
+    // flat arrays. A marginal of zero gives NAN, which makes the fitted value zero.
+    // Data other than the input data gets an index of its own.
+    double *logFit = new double[inSize];
     for (long long ti = 0; ti < inSize; ti++) {
-        KeySegment* tupleKey = inputData->getKey(ti);
-       
-        double outValue = 1;    
-        // for each item in fitIntersectArray:
-        for (auto it=fitIs.begin(); it != fitIs.end(); ++it) {
-            
-            double v = it->first->getMatchingTupleValue(tupleKey);
-            
-            if (v <= DBL_EPSILON) {
-                outValue = 0;
-                break;
-            }
-            double vp = pow(v, it->second); 
-            outValue *= vp;
-        } 
-    
-        algTable->sumTuple(tupleKey, outValue / missingCard);
-    } 
+        logFit[ti] = 0.0;
+    }
+    long long *ownIndex = data == inputData ? NULL : new long long[inSize];
+    for (auto it=fitIs.begin(); it != fitIs.end(); ++it) {
+        Relation *rel = it->first;
+        const long long *index;
+        const double *logValues;
+        {
+            std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+            makeProjection(rel);
+            index = rel->getInputIndex(inputData);
+            logValues = rel->getLogValues();
+        }
+        if (ownIndex) {
+            rel->indexInput(data, ownIndex);
+            index = ownIndex;
+        }
+        double exponent = (double) it->second;
+        for (long long ti = 0; ti < inSize; ti++) {
+            logFit[ti] += exponent * logValues[index[ti]];
+        }
+    }
+    if (ownIndex) delete[] ownIndex;
+
+    // for every tuple in training data (these are sorted and unique):
+    for (long long ti = 0; ti < inSize; ti++) {
+        double outValue = std::isnan(logFit[ti]) ? 0.0 : exp(logFit[ti]);
+        algTable->addTuple(data->getKey(ti), outValue / missingCard);
+    }
+    delete[] logFit;
 
-    if (testData) { fitTestAlgebraic(model, algTable, missingCard, fitIs); }
+    if (testData) { fitTestAlgebraic(model, algTable, missingCard, fitIs, data); }
 
     algTable->sort();
-    if (fitTable1) delete fitTable1;
-    fitTable1 = algTable;
+    if (context->fitTable1) delete context->fitTable1;
+    context->fitTable1 = algTable;
  
     return true;
 }
 
-bool ManagerBase::makeFitTableIPF(Model* model) {
+bool ManagerBase::makeFitTableIPF(Model* model, FitContext* context) {
+    if (context == NULL) { context = fitContext; }
     // For looped & SB models, proceed to solve with IPF.
-    stateSpaceSize = (unsigned long long) ocDegreesOfFreedom(varList) + 1;
-    if (!fitTable1) {
-        //-- for large state spaces, start with less space and let it grow.
-        if (stateSpaceSize > 1000000)
-            stateSpaceSize = 1000000;
-        fitTable1 = new Table(keysize, stateSpaceSize);
-    }
-    if (!fitTable2) {
-        if (stateSpaceSize > 1000000)
-            stateSpaceSize = 1000000;
-        fitTable2 = new Table(keysize, stateSpaceSize);
-    }
-    if (!projTable) {
-        if (stateSpaceSize > 1000000)
-            stateSpaceSize = 1000000;
-        projTable = new Table(keysize, stateSpaceSize);
-    }
+    unsigned long long stateSpaceSize = (unsigned long long) ocDegreesOfFreedom(varList) + 1;
+    //-- for large state spaces, start with less space and let it grow.
+    if (stateSpaceSize > 1000000)
+        stateSpaceSize = 1000000;
+    context->makeTables(keysize, stateSpaceSize);
+    Table *fitTable1 = context->fitTable1;
+    Table *fitTable2 = context->fitTable2;
+    Table *projTable = context->projTable;
     fitTable1->reset(keysize);
     fitTable2->reset(keysize);
     projTable->reset(keysize);
@@ -1511,15 +1788,18 @@ bool ManagerBase::makeFitTableIPF(Model* model) {
     int k;
     double error = 0;
 
-    makeProjections(model);
     int relCount = model->getRelationCount();
     Relation *relList[relCount];
     Table *tableList[relCount];
     KeySegment *maskList[relCount];
-    for (int r = 0; r < relCount; r++) {
-        relList[r] = model->getRelation(r);
-        tableList[r] = model->getRelation(r)->getTable();
-        maskList[r] = model->getRelation(r)->getMask();
+    {
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        makeProjections(model);
+        for (int r = 0; r < relCount; r++) {
+            relList[r] = model->getRelation(r);
+            tableList[r] = model->getRelation(r)->getTable();
+            maskList[r] = model->getRelation(r)->getMask();
+        }
     }
 
     // compute the number of nonzero tuples in the expansion of each relation, and start
@@ -1608,113 +1888,109 @@ bool ManagerBase::makeFitTableIPF(Model* model) {
             break;
     }
     fitTable1->sort();
+    context->fitTable1 = fitTable1;
+    context->fitTable2 = fitTable2;
     model->setAttribute(ATTRIBUTE_IPF_ITERATIONS, (double) iter);
     model->setAttribute(ATTRIBUTE_IPF_ERROR, error);
     delete[] key;
     return true;
 }
 
-bool ManagerBase::makeFitTable(Model *model) {
-    
+bool ManagerBase::makeFitTable(Model *model, FitContext *context) {
     if (model == nullptr) { return false; }
-    
-    // Check for models that can be fit algorithmically. 
-    // If so, solve that way.
-
-    else if (!hasLoops(model) 
-          && !model->isStateBased() 
-          && !getVariableList()->isDirected()) 
-        { return makeFitTableAlgebraic(model); }
-    else 
-        { return makeFitTableIPF(model); }
+    bool shared = context == NULL || context == fitContext;
+    if (context == NULL) { context = fitContext; }
+
+    // Reuse the fit from the cache if this model was fit recently. The default
+    // context uses the cached table itself; other contexts take a copy, since
+    // the cache may drop the table while another thread is fitting.
+    {
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        Table *cached = fitCache->findTable(model);
+        if (cached) {
+            fitCache->restoreAttributes(model);
+            if (shared) {
+                setCurrentFit(cached);
+            } else {
+                if (context->fitTable1 == NULL)
+                    context->fitTable1 = new Table(keysize, cached->getTupleCount() > 0 ? cached->getTupleCount() : 1);
+                context->fitTable1->copy(cached);
+                context->currentFit = context->fitTable1;
+            }
+            return true;
+        }
+    }
+    if (!computeFitTable(model, context)) { return false; }
+
+    // Keep a compact copy of the result; fitTable1 stays behind as IPF work space.
+    Table *fitTable1 = context->fitTable1;
+    Table *fit = new Table(keysize, fitTable1->getTupleCount() > 0 ? fitTable1->getTupleCount() : 1);
+    fit->copy(fitTable1);
+    bool pinned = (model == topRef) || (model == bottomRef) || (model == refModel);
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    fitCache->addTable(model, fit, pinned, model->getAttribute(ATTRIBUTE_IPF_ITERATIONS),
+            model->getAttribute(ATTRIBUTE_IPF_ERROR));
+    if (shared)
+        setCurrentFit(fit);
+    else
+        context->currentFit = fitTable1;
+    return true;
 }
 
-FitIntersectMap ManagerBase::computeIntersectLevels(Model* model) {
+bool ManagerBase::computeFitTable(Model *model, FitContext *context) {
 
-    // Allocate new workspace array
-    int fitIntersectCount = 0;
-    long fitIntersectMax = model->getRelationCount();
-    VarIntersect *fitIntersectArray = new VarIntersect[fitIntersectMax];
-
-
-    // Initialize the VarIntersects in the work array. 
-    for (int i = 0; i < fitIntersectMax; i++) {
-        Relation* rel = model->getRelation(i);
-        VarIntersect *intersect = fitIntersectArray + (fitIntersectCount++);
-        intersect->rel = rel;
-        intersect->startIndex = i;
-        intersect->sign = true;
-    }
+    if (model == nullptr) { return false; }
 
-    // Do all of the work of figuring out the intersects.
-    // Then we'll do a pass over the work array to
-    // represent the intersects in a more compressed way.
-    // Much of the work in the below section can probably be elided.
-    int levelstart = 0;
-    int levelend = fitIntersectCount;
-    int level0end = fitIntersectCount;
-    bool sign = true;
-    int *newvars, newcount;
+    // Projections are made as the fit needs them, so keep them within budget.
+    trimProjections();
 
-    while (levelend > levelstart) {
-        sign = !sign;
-        for (int i = levelstart; i < levelend; i++) {
-            for (int j = fitIntersectArray[i].startIndex + 1; j < level0end; j++) {
-                VarIntersect* ip = fitIntersectArray + i;
-                VarIntersect* jp = fitIntersectArray + j;
-
-                if (intersect(ip->rel, jp->rel, newvars, newcount)) {
-
-                    Relation* rel = getRelation(newvars, newcount, true);
-                    //-- add this intersection term to the DF, and append to list
-                    while (fitIntersectCount >= fitIntersectMax) {
-                        fitIntersectArray =
-                                (VarIntersect*) growStorage(fitIntersectArray, sizeof(VarIntersect)*fitIntersectMax, 2);
-                        fitIntersectMax *= 2;
-                    }
-                    VarIntersect* newp = fitIntersectArray + (fitIntersectCount++);
-                    newp->rel = rel;
-                    newp->startIndex = j;
-                    newp->sign = sign;
-                    delete[] newvars;
-                }
-            }
-        }
-        levelstart = levelend;
-        levelend = fitIntersectCount;
-    }
+    // Check for models that can be fit algorithmically.
+    // If so, solve that way.
+    bool done;
+    activeFits++;
+    if (!hasLoops(model)
+          && !model->isStateBased()
+          && !getVariableList()->isDirected())
+        { done = makeFitTableAlgebraic(model, context); }
+    else
+        { done = makeFitTableIPF(model, context); }
+    activeFits--;
+    return done;
+}
 
-    // Allocate the map of intersect levels,
-    //  which is what is actually of interest
+FitIntersectMap ManagerBase::computeIntersectLevels(Model* model) {
+    // The exponent of each relation in the fit is the net count of its
+    // terms in the model's intersection expansion.
+    const IntersectTermList &terms = getIntersectTerms(model);
     FitIntersectMap out;
-    // Iterate over the work array and add everything to the map.
-    for(long long ri = 0; ri < fitIntersectCount; ++ri) {
-        VarIntersect fi = fitIntersectArray[ri];
-    
+    for (size_t i = 0; i < terms.size(); i++) {
         // NOTE: C++ std::map has the following behavior for operator[]:
         // when the key does not yet exist, a new element is inserted using the default constructor -- 0, in the case of `long long`.
-        out[fi.rel] += fi.sign ? 1 : -1;
+        out[terms[i].rel] += terms[i].sign ? terms[i].count : -terms[i].count;
     }
-
-    delete[] fitIntersectArray;
     return out;
 }
 
 
 Table* ManagerBase::disownTable() {
-    Table* ret = fitTable1;
-    fitTable1 = nullptr;
-    return ret;
+    return fitContext->disownFit();
 }
 
+//-- getIndepTable - the fit of the bottom reference, which the fit cache pins. The
+//-- current fit is held while it is made, and stays current.
 Table* ManagerBase::getIndepTable() {
-    Table* oldFitTable1 = disownTable();
-
+    Table* oldFit = fitContext->currentFit;
+    {
+        std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+        fitCache->holdTable(oldFit);
+    }
     makeFitTable(bottomRef);
-    Table* table = fitTable1;
-
-    fitTable1 = oldFitTable1;
-    return table;}
+    Table* table = fitContext->currentFit;
+    std::lock_guard<std::recursive_mutex> lock(cacheMutex);
+    setCurrentFit(oldFit);
+    fitCache->releaseTable(oldFit);
+    return table;
+}
 
 
 
@@ -1728,35 +2004,26 @@ Table* ManagerBase::getIndepTable() {
 
 Table* ManagerBase::projectedFit(Relation* projectTo, Model* fitModel) {
 
-    // save the work tables; also zero out the fitTable1.
-    Table* oldFitTable = fitTable1;
-    Table* oldData = inputData;
-    fitTable1 = nullptr;
-
-//    printf("<br>");
-//    printf("OLD FIT TABLE:");
-//    oldFitTable->dump(true);
-
-//    printf("OLD DATA TABLE:");
-//    oldData->dump(true);
+    // The fit is computed against projected data, in a context of its own,
+    // so it bypasses the fit cache.
 
     // project inputData into new table based on projectTo
-    int keysize = oldData->getKeySize();
-    inputData = new Table(keysize, oldData->getTupleCount());
-    makeProjection(oldData, inputData, projectTo);
+    int keysize = inputData->getKeySize();
+    Table* projected = new Table(keysize, inputData->getTupleCount());
+    makeProjection(inputData, projected, projectTo);
 
 //    printf("PROJECTED DATA TABLE:");
-//    inputData->dump(true);
+//    projected->dump(true);
 
 //    printf("FIT MODEL:");
 //    fitModel->dump(true);
 
-    makeFitTable(fitModel);
+    FitContext context(projected);
+    computeFitTable(fitModel, &context);
 
-    // get out the result and reset the work tables
-    Table* result = fitTable1;
-    fitTable1 = oldFitTable;
-    inputData = oldData;
+    // get out the result
+    Table* result = context.disownFit();
+    delete projected;
 
 
     return result;
@@ -6,6 +6,7 @@
  */
 
 #include <math.h>
+#include "DiskCache.h"
 #include "Input.h"
 #include "Key.h"
 #include "ManagerBase.h"
@@ -114,9 +115,51 @@ bool ManagerBase::initFromCommandLine(int argc, char **argv) {
         setOptionFloat(currentOptDef, 266);
     }
 
+    if (getOptionFloat("fit-cache-mb", NULL, &value)) {
+        setFitCacheBudget((long long) (value * 1024 * 1024));
+    }
+    if (getOptionFloat("projection-cache-mb", NULL, &value)) {
+        setProjectionCacheBudget((long long) (value * 1024 * 1024));
+    }
+
     inputData = input;
     testData = test;
     inputH = ocEntropy(inputData);
     keysize = vars->getKeySize();
     return true;
 }
+
+void ManagerBase::openDiskCache(const char *kind) {
+    const char *dir;
+    if (diskCache || !getOptionString("cache-dir", NULL, &dir))
+        return;
+    diskCache = new DiskCache(dir, getDataHash(kind));
+    if (!diskCache->isOpen()) {
+        printf("WARNING: couldn't use the cache directory %s\n", dir);
+        delete diskCache;
+        diskCache = NULL;
+    }
+}
+
+unsigned long long ManagerBase::getDataHash(const char *kind) {
+    unsigned long long hash = DiskCache::hashBytes(DISKCACHE_HASH_SEED, kind, strlen(kind));
+    for (int i = 0; i < varList->getVarCount(); i++) {
+        Variable *var = varList->getVariable(i);
+        hash = DiskCache::hashBytes(hash, var->name, strlen(var->name) + 1);
+        hash = DiskCache::hashBytes(hash, var->abbrev, strlen(var->abbrev) + 1);
+        hash = DiskCache::hashBytes(hash, &var->cardinality, sizeof(var->cardinality));
+        hash = DiskCache::hashBytes(hash, &var->dv, sizeof(var->dv));
+    }
+    Table *tables[2] = { inputData, testData };
+    for (int t = 0; t < 2; t++) {
+        long long count = tables[t] ? tables[t]->getTupleCount() : -1;
+        hash = DiskCache::hashBytes(hash, &count, sizeof(count));
+        if (count > 0)
+            hash = DiskCache::hashBytes(hash, tables[t]->getTupleData(), count * tables[t]->getTupleBytes());
+    }
+    double ipf[2] = { -1, -1 };
+    getOptionFloat("ipf-maxit", NULL, &ipf[0]);
+    getOptionFloat("ipf-maxdev", NULL, &ipf[1]);
+    hash = DiskCache::hashBytes(hash, ipf, sizeof(ipf));
+    return hash;
+}
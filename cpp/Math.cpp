@@ -10,6 +10,7 @@
 #include "Math.h"
 #include "Model.h"
 #include "Relation.h"
+#include "SparseRank.h"
 #include "_Core.h"
 
 #include <stdio.h>
@@ -88,6 +89,66 @@ double ocPearsonChiSquared(Table *p, Table *q, long sampleSize) {
     return p2;
 }
 
+void ocFitStatistics(Table *p, Table *q, long sampleSize, ocFitStats &stats, KeySegment *mask, Table *pProj,
+        Table *qProj) {
+    // The sums are accumulated in the same order as the separate functions,
+    // so the results are identical to theirs.
+    double h = 0.0, t = 0.0, p2 = 0.0;
+    int keysize = q->getKeySize();
+    KeySegment *key = mask ? new KeySegment[keysize] : NULL;
+    long long pcount = p->getTupleCount();
+    long long qcount = q->getTupleCount();
+    long long pi = 0, qi = 0;
+    int k;
+    if (mask) {
+        pProj->reset(keysize);
+        qProj->reset(keysize);
+    }
+    while (pi < pcount || qi < qcount) {
+        int compare;
+        if (pi >= pcount)
+            compare = 1;
+        else if (qi >= qcount)
+            compare = -1;
+        else
+            compare = Key::compareKeys(p->getKey(pi), q->getKey(qi), keysize);
+        double pv = compare <= 0 ? p->getValue(pi) : 0.0;
+        double qv = compare >= 0 ? q->getValue(qi) : 0.0;
+        if (compare >= 0) {
+            if (qv > PROB_MIN)
+                h -= qv * log(qv);
+            if (mask) {
+                q->copyKey(qi, key);
+                for (k = 0; k < keysize; k++)
+                    key[k] |= mask[k];
+                qProj->sumTuple(key, qv);
+            }
+            qi++;
+        }
+        if (compare <= 0) {
+            //-- only the tuples of the input data contribute to T and Pearson
+            if (qv > PROB_MIN && pv > PROB_MIN)
+                t += pv * log(pv / qv);
+            if (pv < PROB_MIN)
+                p2 += qv;
+            else if (qv > PROB_MIN)
+                p2 += (pv - qv) * (pv - qv) / qv;
+            if (mask) {
+                p->copyKey(pi, key);
+                for (k = 0; k < keysize; k++)
+                    key[k] |= mask[k];
+                pProj->sumTuple(key, pv);
+            }
+            pi++;
+        }
+    }
+    if (key)
+        delete[] key;
+    stats.h = h / log(2.0);
+    stats.t = t / log(2.0);
+    stats.p2 = p2 * sampleSize;
+    stats.g2 = 2.0 * M_LN2 * sampleSize * stats.t;
+}
 
 double ocDegreesOfFreedom(Relation *rel) {
     double df = 1.0;
@@ -138,60 +199,6 @@ bool ocHasOverlaps(Model *model) {
     return false;
 }
 
-//-- these definitions are used in loop checking
-struct VarList {
-        int varCount;
-        int *vars;
-        VarList() :
-                varCount(0), vars(0) {
-        }
-        ~VarList() {
-            if (vars)
-                delete[] vars;
-        }
-        void setVars(int *newVars) {
-            if (vars)
-                delete[] vars;
-            vars = newVars;
-        }
-};
-
-//-- copy a VarList
-static void VLCopy(VarList &from, VarList &to) {
-    if (to.varCount < from.varCount) {
-        to.setVars(new int[from.varCount]);
-    }
-    to.varCount = from.varCount;
-    if (to.varCount > 0)
-        memcpy(to.vars, from.vars, to.varCount * sizeof(int));
-}
-
-//-- remove variables from v1 which are present in v2
-static void VLComplement(VarList &v1, VarList &v2) {
-    if (v1.varCount == 0 || v1.varCount == 0)
-        return;
-    int *newvars = new int[v1.varCount];
-    int count = 0, i, j;
-    for (i = 0; i < v1.varCount; i++) {
-        for (j = 0; j < v2.varCount; j++) {
-            if (v2.vars[j] == v1.vars[i])
-                break;
-        }
-        if (j >= v2.varCount) { // not found; add it to result
-            newvars[count++] = v1.vars[i];
-        }
-    }
-    v1.setVars(newvars);
-    v1.varCount = count;
-}
-
-//-- check for containment (v1 contains v2)
-static bool VLContains(VarList &v1, VarList &v2) {
-    if (v1.varCount < v2.varCount)
-        return false; // quick check for impossibility
-    return ocContainsVariables(v1.varCount, v1.vars, v2.varCount, v2.vars);
-}
-
 // returns true if first boolean array is a superset of (or equal to) second
 bool isSuperset(bool *first, bool *second, int length) {
     for (int i = 0; i < length; i++)
@@ -340,6 +347,65 @@ bool ocSbHasLoops(Model *model) {
     return false;
 }
 
+//-- ocSetsHaveLoops - test a list of variable sets for loops (cyclicity), by
+//-- maximum cardinality search (Tarjan & Yannakakis). Sets are taken in an order
+//-- which always picks the set with the most variables already seen; the sets
+//-- are loopless exactly when, in this order, the seen variables of each set are
+//-- all contained in one earlier set. It is enough to check the earlier set which
+//-- introduced the most recently seen of those variables (the one taken last).
+static bool ocSetsHaveLoops(VarSet *rels, int relcount) {
+    if (relcount <= 2)
+        return false;
+    int maxVars = rels[0].getWordCount() * VARSET_WORD_BITS;
+    int *seenCount = new int[relcount];     // seen variables in each set; -1 once taken
+    int *takenAt = new int[relcount];       // the step at which each set was taken
+    int *introducedBy = new int[maxVars];   // the set which introduced each variable
+    int *vars = new int[maxVars];
+    VarSet seen(maxVars);
+    bool loops = false;
+    memset(seenCount, 0, relcount * sizeof(int));
+    for (int step = 0; step < relcount && !loops; step++) {
+        int best = -1;
+        for (int i = 0; i < relcount; i++) {
+            if (seenCount[i] >= 0 && (best < 0 || seenCount[i] > seenCount[best]))
+                best = i;
+        }
+        VarSet &rel = rels[best];
+        if (seenCount[best] > 0) {
+            VarSet shared(rel);
+            shared &= seen;
+            int count = shared.copyVariables(vars);
+            int last = introducedBy[vars[0]];
+            for (int k = 1; k < count; k++) {
+                if (takenAt[introducedBy[vars[k]]] > takenAt[last])
+                    last = introducedBy[vars[k]];
+            }
+            if (!rels[last].contains(shared))
+                loops = true;
+        }
+        seenCount[best] = -1;
+        takenAt[best] = step;
+        VarSet fresh(rel);
+        fresh.subtract(seen);
+        int count = fresh.copyVariables(vars);
+        for (int k = 0; k < count; k++)
+            introducedBy[vars[k]] = best;
+        seen |= fresh;
+        for (int i = 0; i < relcount; i++) {
+            if (seenCount[i] >= 0 && rels[i].intersects(fresh)) {
+                VarSet common(rels[i]);
+                common &= fresh;
+                seenCount[i] += common.count();
+            }
+        }
+    }
+    delete[] seenCount;
+    delete[] takenAt;
+    delete[] introducedBy;
+    delete[] vars;
+    return loops;
+}
+
 bool ocHasLoops(Model *model) {
     if (model == NULL) {
         fprintf(stdout, "ocHasLoops(): Error. Model is NULL.\n");
@@ -348,54 +414,138 @@ bool ocHasLoops(Model *model) {
     }
     if (model->isStateBased())
         return ocSbHasLoops(model);
-    int i, j, relcount;
-    relcount = model->getRelationCount();
-    VarList *rels = new VarList[relcount];
-    //-- copy variable lists from relations
-    for (i = 0; i < relcount; i++) {
-        Relation *relation = model->getRelation(i);
-        rels[i].varCount = relation->getVariableCount();
-        rels[i].setVars(new int[rels[i].varCount]);
-        relation->copyVariables(rels[i].vars, rels[i].varCount);
+    int relcount = model->getRelationCount();
+    VarSet *rels = new VarSet[relcount];
+    for (int i = 0; i < relcount; i++) {
+        rels[i] = model->getRelation(i)->getVarSet();
     }
+    bool loops = ocSetsHaveLoops(rels, relcount);
+    delete[] rels;
+    return loops;
+}
 
-    for (;;) {
-        bool change = false;
-        //-- repeat until no further change:
-        //-- first eliminate variables occuring in only one relation.
-        //-- then eliminate relations which are subsets of others
-        for (i = 0; i < relcount; i++) {
-            VarList newList;
-            VLCopy(rels[i], newList);
-            for (j = 0; j < relcount; j++) {
-                if (j != i)
-                    VLComplement(newList, rels[j]);
-            }
-            if (newList.varCount > 0) {
-                VLComplement(rels[i], newList);
-                change = true;
-            }
+//-- ocLoopVariables - GYO reduction on the relations' variable sets: variables
+//-- found in only one set are removed, then sets contained in another, until
+//-- nothing changes. The variables of the sets left over are those in loops.
+void ocLoopVariables(Model *model, VarSet &vars) {
+    int relcount = model->getRelationCount();
+    vars = relcount > 0 ? VarSet(model->getRelation(0)->getVarSet().getWordCount() * VARSET_WORD_BITS) : VarSet();
+    VarSet *rels = new VarSet[relcount];
+    int count = 0;
+    for (int i = 0; i < relcount; i++)
+        rels[count++] = model->getRelation(i)->getVarSet();
+    bool changed = true;
+    while (changed && count > 0) {
+        changed = false;
+        //-- the variables seen once, and those seen again; the difference is
+        //-- the variables found in only one set
+        VarSet once(vars), twice(vars);
+        for (int i = 0; i < count; i++) {
+            VarSet again(rels[i]);
+            again &= once;
+            twice |= again;
+            once |= rels[i];
         }
-        for (i = 0; i < relcount; i++) {
-            for (j = 0; j < relcount; j++) {
-                if (i != j && rels[i].varCount > 0 && rels[j].varCount > 0 && VLContains(rels[i], rels[j])) {
-                    change = true;
-                    rels[j].varCount = 0;
+        once.subtract(twice);
+        if (!once.isEmpty()) {
+            for (int i = 0; i < count; i++)
+                rels[i].subtract(once);
+            changed = true;
+        }
+        for (int i = 0; i < count; i++) {
+            for (int k = 0; k < count; k++) {
+                if (k != i && rels[k].contains(rels[i])) {
+                    rels[i] = rels[--count];
+                    i--;
+                    changed = true;
+                    break;
                 }
             }
         }
-        if (!change)
-            break;
     }
+    for (int i = 0; i < count; i++)
+        vars |= rels[i];
+    delete[] rels;
+}
 
-    //-- do cleanup, and also see if there are any relations left.
-    int remaining = 0;
+bool ocHasLoopsWithRelation(Model *model, Relation *added) {
+    return ocHasLoopsWithVars(model, added->getVarSet());
+}
+
+bool ocHasLoopsWithVars(Model *model, const VarSet &newVars, bool loopless) {
+    int relcount = model->getRelationCount();
+    int i, j;
+
+    //-- a model with loops can lose them to a relation containing some of its
+    //-- relations, so the whole model is tested, less the relations it contains.
+    if (!loopless) {
+        VarSet *rels = new VarSet[relcount + 1];
+        int count = 0;
+        for (i = 0; i < relcount; i++) {
+            const VarSet &rel = model->getRelation(i)->getVarSet();
+            if (!newVars.contains(rel))
+                rels[count++] = rel;
+        }
+        rels[count++] = newVars;
+        bool loops = ocSetsHaveLoops(rels, count);
+        delete[] rels;
+        return loops;
+    }
+
+    //-- group the relations into connected components. Components which don't
+    //-- touch the new relation stay loopless, so only the others need checking.
+    int *component = new int[relcount];
+    for (i = 0; i < relcount; i++)
+        component[i] = i;
     for (i = 0; i < relcount; i++) {
-        if (rels[i].varCount > 0)
-            remaining++;
+        const VarSet &rel = model->getRelation(i)->getVarSet();
+        for (j = 0; j < i; j++) {
+            if (component[j] != component[i] && rel.intersects(model->getRelation(j)->getVarSet())) {
+                int from = component[i], to = component[j];
+                for (int k = 0; k <= i; k++)
+                    if (component[k] == from)
+                        component[k] = to;
+            }
+        }
+    }
+
+    //-- if the new relation meets each component within a single relation, it
+    //-- just joins the components together and can't close a loop.
+    bool loops = false;
+    bool simple = true;
+    VarSet *rels = new VarSet[relcount + 1];
+    int count = 0;
+    for (int c = 0; c < relcount; c++) {
+        VarSet shared(newVars.getWordCount() * VARSET_WORD_BITS);
+        int first = count;
+        for (i = 0; i < relcount; i++) {
+            if (component[i] != c)
+                continue;
+            const VarSet &rel = model->getRelation(i)->getVarSet();
+            rels[count++] = rel;
+            if (rel.intersects(newVars)) {
+                VarSet common(rel);
+                common &= newVars;
+                shared |= common;
+            }
+        }
+        if (shared.isEmpty()) {
+            count = first;
+            continue;
+        }
+        bool within = false;
+        for (i = first; i < count && !within; i++)
+            within = rels[i].contains(shared);
+        if (!within)
+            simple = false;
+    }
+    if (!simple) {
+        rels[count++] = newVars;
+        loops = ocSetsHaveLoops(rels, count);
     }
     delete[] rels;
-    return remaining > 1;
+    delete[] component;
+    return loops;
 }
 
 double ocLR(double sample, double df, double h) {
@@ -997,94 +1147,8 @@ unsigned chistat(unsigned ntab, double* obs, double* fit, double* g2_ptr, double
 // Gaussian elimination method to calculate rank
 // source: http://www.wikipedia.org/wiki/Gauss_elimination_method
 double ocDegreesOfFreedomStateBased(Model *model) {
-    int nrows = 0, ncols = 0;
-    int i = 0, j = 0;
-    double **matrix = NULL;
-    int **struct_matrix = model->getStructMatrix(&ncols, &nrows);
-    if (struct_matrix == NULL) {
-        fprintf(stdout, "ocDegreesOfFreedomStateBased(): Error. Model %s: struct matrix not found.\n", model->getPrintName());
-        fflush(stdout);
-        exit(1);
-    }
-    // create a copy of the matrix to manipulate
-    matrix = new double *[nrows];
-    for (i = 0; i < nrows; i++) {
-        matrix[i] = new double[ncols];
-    }
-    for (i = 0; i < nrows; i++) {
-        if (i < nrows - 1) {
-            for (j = 0; j < ncols; j++) {
-                matrix[i + 1][j] = (double)struct_matrix[i][j];
-            }
-        } else {
-            for (j = 0; j < ncols; j++) {
-                matrix[0][j] = (double)struct_matrix[i][j];
-            }
-        }
-    }
-    model->deleteStructMatrix();
-    int irow, jrow, icol, jcol;
-    bool have_pivot = false;
-    int rowmax = 0;
-    icol = 0;
-    int i1, j1;
-    double *temp_ptr;
-    for (irow = 0; irow < nrows; irow++) {    // Find pivot in column j, starting in row i:
-        have_pivot = false;
-        do {
-            rowmax = irow;
-            if (icol >= ncols) break;
-            for (jrow = irow + 1; jrow < nrows; jrow++) {
-                if (fabs(matrix[jrow][icol]) > fabs(matrix[rowmax][icol])) {
-                    rowmax = jrow;
-                }
-            }
-            if (fabs(matrix[rowmax][icol]) > DBL_EPSILON) {
-                have_pivot = true;
-                if (rowmax != irow) {   //switch rows irow and rowmax
-                    temp_ptr = matrix[irow];
-                    matrix[irow] = matrix[rowmax];
-                    matrix[rowmax] = temp_ptr;
-                }
-            } else {
-                matrix[rowmax][icol] = 0.0;
-                icol = icol + 1;
-            }
-        } while ((!have_pivot) && (icol < ncols));
-        if (icol >= ncols) {
-            break;
-        }
-        double factor;
-        if (fabs(matrix[irow][icol]) > DBL_EPSILON) {
-            for (jrow = irow+1; jrow < nrows; jrow++) {
-                factor = matrix[jrow][icol] / matrix[irow][icol];
-                for (jcol = icol+1; jcol < ncols; jcol++) {
-                    matrix[jrow][jcol] -= matrix[irow][jcol] * factor;
-                }
-                matrix[jrow][icol] = 0.0;
-            }
-        }
-        icol++;
-    }
-    double rank = 0;
-    double limit = pow(FLT_RADIX, DBL_MANT_DIG);
-    for (i = 0; i < nrows; i++) {
-        for (j = i; j < ncols; j++) {
-            if (fabs(matrix[i][j]) > DBL_EPSILON) {
-                if (rank >= limit) {
-                    fprintf(stdout, "ocDegreesOfFreedomStateBased(): Error. DF exceeds current limits of State-based OCCAM.\n");
-                    fflush(stdout);
-                    exit(1);
-                } else {
-                    rank++;
-                    break;
-                }
-            }
-        }
-    }
-    for (i = 0; i < nrows; i++) {
-        delete[] matrix[i];
-    }
-    delete[] matrix;
-    return rank - 1;
+    //-- the rank of the structure matrix, less one for the default constraint.
+    //-- The rank is kept with the model, to be extended when relations are
+    //-- compared against it (see Model::addStateConstraints).
+    return model->getStateRank()->getRank() - 1;
 }
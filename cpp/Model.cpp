@@ -12,6 +12,7 @@
 #include "Model.h"
 #include "ModelCache.h"
 #include "Relation.h"
+#include "SparseRank.h"
 #include "StateConstraint.h"
 #include "_Core.h"
 
@@ -28,51 +29,42 @@
  * data (e.g., computed via IPF).
  */
 
+//-- the arena for models; it is never destroyed, as models may outlive statics
+Arena *Model::getArena() {
+    static Arena *arena = new Arena();
+    return arena;
+}
+
 // initialize the model, and allocate storage for the relation pointers.
 Model::Model(int size) {
     maxRelationCount = size;
     relationCount = 0;
-    stateSpaceSize = 0;
-    totalConstraints = 0;
-    relations = new Relation*[size];
+    relations = (Relation **) getArena()->allocate(size * sizeof(Relation*));
     fitTable = NULL;
-    attributeList = new AttributeList(6);
+    attributeList = new (getArena()) AttributeList(6, getArena());
     printName = NULL;
     inverseName = NULL;
     hashNext = NULL;
+    signature = 0;
     progenitor = NULL;
     ID = 0;
-    structMatrix = NULL;
+    intersectTerms = NULL;
+    stateRank = NULL;
 }
 
 Model::~Model() {
-    if (structMatrix) {
-        this->deleteStructMatrix();
-    }
-    if (printName) {
-        delete printName;
-        printName = NULL;
-    }
-    if (inverseName) {
-        delete inverseName;
-        inverseName = NULL;
-    }
-    if (relations)
-        delete[] relations;     // only pointers; actual relations deleted by the relCache
+    Arena::release(printName);
+    Arena::release(inverseName);
+    Arena::release(relations);  // only pointers; actual relations deleted by the relCache
     if (fitTable) {
         delete fitTable;
         fitTable = NULL;
     }
     if (attributeList)
         delete attributeList;
-}
-
-void Model::deleteStructMatrix() {
-    for (int i = 0; i < totalConstraints; i++) {
-        delete[] structMatrix[i];
-    }
-    delete[] structMatrix;
-    structMatrix = NULL;
+    if (intersectTerms)
+        delete intersectTerms;
+    deleteStateRank();
 }
 
 long Model::size() {
@@ -115,175 +107,108 @@ double Model::getAttribute(const char *name) {
     return attributeList->getAttribute(name);
 }
 
-//state space array
-int * Model::getIndicesFromKey(KeySegment *key, VariableList *vars, int statespace, int **stateSpaceArr,
-        int *counter) {
-    int varcount = vars->getVarCount();
-    int *value_l = new int[varcount];
-    //maximum number of states that can constrained by a relation
-    int *indices = new int[statespace];
-    for (int i = 0; i < varcount; i++) {
-        Variable *var = vars->getVariable(i);
-        KeySegment mask = var->mask;
-        int segment = var->segment;
-        int value = 0;
-        KeySegment mask1;
-        if ((mask1 = (mask & key[segment])) == mask)
-            value_l[i] = DONT_CARE;
-        else {
-            value = (key[segment] & mask) >> var->shift;
-            value_l[i] = value;
-        }
-    }
-    *counter = 0;
-    int not_a_match = -1;
-    for (int i = 0; i < statespace; i++) {
-        for (int j = 0; j < varcount; j++) {
-            if (value_l[j] == DONT_CARE)
-                continue;
-            if (value_l[j] != stateSpaceArr[i][j]) {
-                not_a_match = 1;
-                break;
-            } else {
-                not_a_match = 0;
-            }
-        }
-        if (not_a_match == 0) {
-            indices[(*counter)] = i;
-            (*counter)++;
-
-        }
-        not_a_match = -1;
+//-- State-based structure matrix. States are numbered in mixed radix over the
+//-- variables, with the last variable varying fastest; a state's value for each
+//-- variable is decoded from its number on the fly, rather than kept in an array.
 
-    }
-    delete[] value_l;
-    return indices;
+//-- stateSpaceSize - the number of states of the variables
+static long long stateSpaceSize(VariableList *vars) {
+    long long size = 1;
+    for (int i = 0; i < vars->getVarCount(); i++)
+        size *= vars->getVariable(i)->cardinality;
+    return size;
 }
 
-// State-Based Structure matrix generation
-void Model::makeStructMatrix(int statespace, VariableList *vars, int **stateSpaceArr) {
-    if (structMatrix != NULL) return;
-    int relCount = getRelationCount();
-    long constraintCount = 0;
-    long i = 0;
-    for (i = 0; i < relCount; i++) {
-        Relation *rel = getRelation(i);
-        StateConstraint *sc = rel->getStateConstraints();
-        if (sc != NULL)
-            constraintCount += sc->getConstraintCount();
-    }
-    totalConstraints = constraintCount + 1;
-    stateSpaceSize = statespace;
-    structMatrix = new int *[constraintCount + 1];
-    for (i = 0; i <= constraintCount; i++) {
-        structMatrix[i] = new int[statespace];
-    }
-    for (i = 0; i < statespace; i++) {
-        for (int j = 0; j < constraintCount; j++) {
-            structMatrix[j][i] = 0;
-        }
-        structMatrix[constraintCount][i] = 1; //the default constraint
-    }
-    constraintCount = 0;
-    int totalConstraintCount = 0;
-    for (i = 0; i < relCount; i++) {
-        Relation *rel = getRelation(i);
-        StateConstraint *sc = rel->getStateConstraints();
-        if (sc == NULL) {
-            printf("error happened in file : Model.cpp after getStateConstraints for rel: %s\n", rel->getPrintName());
-            exit(1);
-        }
-        constraintCount = sc->getConstraintCount();
-        if (constraintCount <= 0) {
-            printf("error happened in file : Model.cpp after getConstraintCount\n");
-            exit(1);
-        }
-        for (long j = 0; j < constraintCount; j++) {
-            KeySegment* key = sc->getConstraint(j);
-            if (key == NULL) {
-                printf("error happened in file : Model.cpp after getConstraint\n");
-                exit(1);
-            }
-            int counter;
-            int *indices = getIndicesFromKey(key, vars, statespace, stateSpaceArr, &counter);
-            for (int k = 0; k < counter; k++) {
-                structMatrix[totalConstraintCount + j][indices[k]] = 1;
-            }
-            delete[] indices;
+//-- statePattern - the states which match a constraint key, as a pattern (see
+//-- SparseRank::addPatternRow). Variables which are don't care in the key are the
+//-- digits, least significant first; the others are fixed, and give the base. A
+//-- null key has every variable don't care. Returns the number of digits; strides
+//-- and sizes need room for one per variable.
+static int statePattern(KeySegment *key, VariableList *vars, long long *base, long long *strides, int *sizes) {
+    int digitCount = 0;
+    long long stride = 1;
+    *base = 0;
+    for (int i = vars->getVarCount() - 1; i >= 0; i--) {
+        Variable *var = vars->getVariable(i);
+        KeySegment value = key ? key[var->segment] & var->mask : var->mask;
+        if (value == var->mask) {
+            strides[digitCount] = stride;
+            sizes[digitCount++] = var->cardinality;
+        } else {
+            *base += (long long) (value >> var->shift) * stride;
         }
-        totalConstraintCount += constraintCount;
+        stride *= var->cardinality;
     }
+    return digitCount;
 }
 
+//-- completeSbModel - build the structure matrix rank of a state-based model
 void Model::completeSbModel() {
+    getStateRank();
+}
+
+SparseRank *Model::getStateRank() {
+    if (stateRank != NULL)
+        return stateRank;
     if (getRelationCount() == 0) {
-        fprintf(stdout, "Error. completeSbModel(): Model contains no relations.\n");
+        fprintf(stdout, "Error. getStateRank(): Model contains no relations.\n");
         fflush(stdout);
         exit(1);
     }
-    if (structMatrix != NULL) return;
     VariableList *varList = getRelation(0)->getVariableList();
-    int stateSpace = (int) ocDegreesOfFreedom(varList) + 1; // ought to be using something longer than int
-    int **stateSpaceArray = Model::makeStateSpaceArray(varList, stateSpace);
-    this->makeStructMatrix(stateSpace, varList, stateSpaceArray);
-    for (int i=0; i < stateSpace; i++) {
-        delete[] stateSpaceArray[i];
-    }
-    delete[] stateSpaceArray;
+    long long stateSpace = stateSpaceSize(varList);
+    stateRank = new SparseRank(stateSpace);
+    for (int i = 0; i < getRelationCount(); i++)
+        addStateRows(stateRank, getRelation(i), varList);
+    //-- the default constraint goes last; its row is full, and the constraint
+    //-- rows stay sparser if they aren't reduced against it. It is a pattern with
+    //-- every variable free, rather than a list of all the states.
+    int varCount = varList->getVarCount();
+    long long base, strides[varCount];
+    int sizes[varCount];
+    int digitCount = statePattern(NULL, varList, &base, strides, sizes);
+    stateRank->addPatternRow(base, digitCount, strides, sizes);
+    return stateRank;
 }
 
-int** Model::makeStateSpaceArray(VariableList *varList, int statespace) {
-    int **stateSpaceArray = new int *[statespace];
-    int varCount = varList->getVarCount();
-    for (int i = 0; i < statespace; i++) {
-        stateSpaceArray[i] = new int[varCount];
+void Model::deleteStateRank() {
+    if (stateRank) {
+        delete stateRank;
+        stateRank = NULL;
     }
+}
 
-    for (int i = 0; i < statespace; i++) {
-        for (int j = 0; j < varCount; j++) {
-            stateSpaceArray[i][j] = 0;
-        }
-    }
-    for (int k = 0; k < varCount; k++) {
-        stateSpaceArray[0][k] = 0;
+//-- addStateRows - add a row for each constraint of a relation, with a 1 for each
+//-- state which matches the constraint (as a pattern).
+void Model::addStateRows(SparseRank *rank, Relation *relation, VariableList *vars) {
+    StateConstraint *sc = relation->getStateConstraints();
+    if (sc == NULL) {
+        printf("error happened in file : Model.cpp after getStateConstraints for rel: %s\n", relation->getPrintName());
+        exit(1);
     }
-    int l = varCount - 1;
-    int i = 0;
-    int loop1 = 0;
-    while (i < statespace - 1) {    // first copy from previous state
-        for (int j = 0; j < varCount; j++) {
-            stateSpaceArray[i + 1][j] = stateSpaceArray[i][j];
-        }
-        rap: if (i + 1 == statespace)
-            break;
-        Variable *var = varList->getVariable(l);
-        int card = var->cardinality;
-        if (stateSpaceArray[i][l] == (card - 1)) {
-            stateSpaceArray[i + 1][l] = 0;
-            l--;
-            if (l < 0)
-                break;
-            goto rap;
-        } else {
-            stateSpaceArray[i + 1][l]++;
-            l = varCount - 1;
-        }
-        i++;
+    long constraintCount = sc->getConstraintCount();
+    int varCount = vars->getVarCount();
+    long long base, strides[varCount];
+    int sizes[varCount];
+    for (long j = 0; j < constraintCount; j++) {
+        int digitCount = statePattern(sc->getConstraint(j), vars, &base, strides, sizes);
+        rank->addPatternRow(base, digitCount, strides, sizes);
     }
-    return stateSpaceArray;
 }
 
-
-void Model::addRelation(Relation *newRelation, bool normalize, ModelCache *cache) {
+void Model::addRelation(Relation *newRelation, bool normalize) {
     if (newRelation == NULL)
         return;
     const int FACTOR = 2;
     int i, j;
+    bool rankExtended = false;
     //-- if normalize, compare new relation to existing relations
     if (normalize && getRelationCount() > 0) {
         if (this->isStateBased() || newRelation->isStateBased()) {
-            if (this->containsRelation(newRelation, cache))
+            //-- this also extends the structure matrix rank with the new constraints
+            if (!addStateConstraints(newRelation, true))
                 return;
+            rankExtended = true;
         } else {
             for (i = 0; i < relationCount; i++) {
                 if (relations[i]->contains(newRelation)) {
@@ -291,6 +216,7 @@ void Model::addRelation(Relation *newRelation, bool normalize, ModelCache *cache
                     // may be referenced elsewhere.
                     return;
                 } else if (newRelation->contains(relations[i])) {       // remove this relation from model
+                    signature ^= relations[i]->getID();
                     for (j = i; j < relationCount - 1; j++) {
                         relations[j] = relations[j + 1];
                     }
@@ -301,7 +227,8 @@ void Model::addRelation(Relation *newRelation, bool normalize, ModelCache *cache
         }
     }
     while (relationCount >= maxRelationCount) {     //-- grow storage if needed
-        relations = (Relation**) growStorage(relations, maxRelationCount*sizeof(Relation*), FACTOR);
+        relations = (Relation**) getArena()->reallocate(relations, maxRelationCount*sizeof(Relation*),
+                FACTOR*maxRelationCount*sizeof(Relation*));
         maxRelationCount *= FACTOR;
     }
     for (i = 0; i < relationCount; i++) {       // now find the spot for this newRelation and add it in
@@ -313,29 +240,28 @@ void Model::addRelation(Relation *newRelation, bool normalize, ModelCache *cache
     }
     relations[i] = newRelation;
     relationCount++;
-    if (printName) {
-        delete printName;
-        printName = NULL;
-    }
-    if (inverseName) {
-        delete inverseName;
-        inverseName = NULL;
-    }
-    if (structMatrix) {
-        for (int i = 0; i < totalConstraints; i++) {
-            delete[] structMatrix[i];
-        }
-        delete[] structMatrix;
-        structMatrix = NULL;
-    }
+    signature ^= newRelation->getID();
+    Arena::release(printName);
+    printName = NULL;
+    Arena::release(inverseName);
+    inverseName = NULL;
+    if (!rankExtended)
+        deleteStateRank();
     if (fitTable) {
         delete fitTable;
         fitTable = NULL;
     }
     if (attributeList) {
         delete attributeList;
-        attributeList = new AttributeList(6);
+        attributeList = new (getArena()) AttributeList(6, getArena());
     }
+    setIntersectTerms(NULL);
+}
+
+void Model::setIntersectTerms(IntersectTermList *terms) {
+    if (intersectTerms)
+        delete intersectTerms;
+    intersectTerms = terms;
 }
 
 int Model::getRelations(Relation **rels, int maxRelations) {
@@ -349,55 +275,9 @@ Relation *Model::getRelation(int index) {
 }
 
 // Returns true if this model contains the specified relation; false otherwise.
-bool Model::containsRelation(Relation *relation, ModelCache *cache) {
+bool Model::containsRelation(Relation *relation) {
     if (this->isStateBased() || relation->isStateBased()) {
-        for (int i = 0; i < relationCount; i++) {
-            if (relations[i] == relation)
-                return true;
-        }
-        Model *new_model = new Model(this->getRelationCount() + 1);
-        new_model->copyRelations(*this);
-        new_model->addRelation(relation,false);
-        Model *temp_old = NULL;
-        Model *temp_new = NULL;
-        double new_df;
-        if (cache) {
-            temp_new = cache->findModel(new_model->getPrintName());
-        }
-        if (temp_new) {
-            new_df = temp_new->getAttribute(ATTRIBUTE_DF);
-            if (new_df < 0.0) {
-                temp_new->completeSbModel();
-                new_df = ::ocDegreesOfFreedomStateBased(temp_new);
-                temp_new->setAttribute(ATTRIBUTE_DF, new_df);
-            }
-        } else {
-            new_model->completeSbModel();
-            new_df = ::ocDegreesOfFreedomStateBased(new_model);
-        }
-        double df = this->getAttribute(ATTRIBUTE_DF);
-        if (df < 0.0) { //-- not set yet
-            if (cache) {
-                temp_old = cache->findModel(this->getPrintName());
-            }
-            if (temp_old) {
-                df = temp_old->getAttribute(ATTRIBUTE_DF);
-                if (df < 0.0) {
-                    temp_old->completeSbModel();
-                    df = ::ocDegreesOfFreedomStateBased(temp_old);
-                    temp_old->setAttribute(ATTRIBUTE_DF, df);
-                }
-            } else {
-                this->completeSbModel();
-                df = ::ocDegreesOfFreedomStateBased(this);
-                this->setAttribute(ATTRIBUTE_DF, df);
-            }
-        }
-        delete new_model;
-        if (fabs(df - new_df) < DBL_EPSILON) {
-            return true;
-        }
-        return false;
+        return !addStateConstraints(relation, false);
     } else {
         for (int i = 0; i < relationCount; i++) {
             if (relations[i]->contains(relation))
@@ -407,6 +287,26 @@ bool Model::containsRelation(Relation *relation, ModelCache *cache) {
     }
 }
 
+//-- addStateConstraints - add the constraints of a relation to the structure matrix
+//-- rank of a state-based model. Returns true if the rank grew, i.e., the relation
+//-- is not already contained in the model. Unless keep is set, the rank is put back.
+bool Model::addStateConstraints(Relation *relation, bool keep) {
+    for (int i = 0; i < relationCount; i++) {
+        if (relations[i] == relation)
+            return false;
+    }
+    SparseRank *rank = getStateRank();
+    long oldRank = rank->getRank();
+    rank->mark();
+    addStateRows(rank, relation, relation->getVariableList());
+    bool grew = rank->getRank() > oldRank;
+    if (!grew || !keep)
+        rank->rollback();
+    if (!keep && getAttribute(ATTRIBUTE_DF) < 0.0)
+        setAttribute(ATTRIBUTE_DF, rank->getRank() - 1);
+    return grew;
+}
+
 bool Model::containsModel(Model *other) {
     for (int i = 0; i < other->getRelationCount(); i++) {
         if (!this->containsRelation(other->getRelation(i))) {
@@ -481,7 +381,7 @@ const char * Model::getPrintName(int useInverse) {
             len += 3 + 1;
         else if (useIVI == 1)
             len += notUsingIVI;
-        char *tempName = new char[len + 1];
+        char *tempName = (char *) getArena()->allocate(len + 1);
         char *cp = tempName;
         *cp = '\0';
 
@@ -518,27 +418,35 @@ const char * Model::getPrintName(int useInverse) {
         return inverseName;
 }
 
+//-- printStructMatrix - print the structure matrix of a state-based model: a row
+//-- for each constraint, then the default constraint, with a column for each state.
 void Model::printStructMatrix() {
-    int statespace;
-    int Total_const;
-    int **str_matrix = getStructMatrix(&statespace, &Total_const);
-    if (str_matrix != NULL) {
-        for (int i = 0; i < Total_const; i++) {
-            for (int j = 0; j < statespace; j++) {
-                printf("%d,", str_matrix[i][j]);
+    if (getRelationCount() == 0)
+        return;
+    VariableList *varList = getRelation(0)->getVariableList();
+    long long stateSpace = stateSpaceSize(varList);
+    int varCount = varList->getVarCount();
+    long long base, strides[varCount];
+    int sizes[varCount];
+    for (int i = 0; i < getRelationCount(); i++) {
+        StateConstraint *sc = getRelation(i)->getStateConstraints();
+        if (sc == NULL)
+            continue;
+        for (long j = 0; j < sc->getConstraintCount(); j++) {
+            int digitCount = statePattern(sc->getConstraint(j), varList, &base, strides, sizes);
+            for (long long state = 0; state < stateSpace; state++) {
+                //-- a state matches if it is the base, once its free digits are cleared
+                long long fixed = state;
+                for (int d = 0; d < digitCount; d++)
+                    fixed -= (state / strides[d]) % sizes[d] * strides[d];
+                printf("%d,", fixed == base ? 1 : 0);
             }
             printf("\n");
         }
     }
-}
-
-int **Model::getStructMatrix(int *statespace, int *totalConst) {
-    if (structMatrix == NULL) {
-        this->completeSbModel();
-    }
-    *statespace = stateSpaceSize;
-    *totalConst = totalConstraints;
-    return structMatrix;
+    for (long long state = 0; state < stateSpace; state++)
+        printf("1,");
+    printf("\n");
 }
 
 void Model::dump(bool detail) {
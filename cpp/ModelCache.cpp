@@ -13,23 +13,22 @@
 #include <memory.h>
 #include <string.h>
 
-static int hashcode(const char *name, int hashsize) {
-    unsigned int key = 0;
-    for (const char *cp = name; *cp; cp++)
-        key = (key << 1) + *cp;
-    return key % hashsize;
+//-- signatures are XORs of random IDs, so the low bits can be used directly
+static long hashcode(unsigned long long signature, long capacity) {
+    return (long) (signature & (capacity - 1));
 }
 
 ModelCache::ModelCache() {
-    hash = new Model*[MODELCACHE_HASHSIZE];
-    memset(hash, 0, MODELCACHE_HASHSIZE * sizeof(Model*));
+    capacity = MODELCACHE_INITIAL_SIZE;
+    count = 0;
+    hash = new Model*[capacity];
+    memset(hash, 0, capacity * sizeof(Model*));
 }
 
 //-- destroy Model cache.  This also deletes all the Models held in the cache.
 ModelCache::~ModelCache() {
     Model *r1, *r2;
-    int i;
-    for (i = 0; i < MODELCACHE_HASHSIZE; i++) {
+    for (long i = 0; i < capacity; i++) {
         r1 = hash[i];
         while (r1) {
             r2 = r1->getHashNext();
@@ -37,14 +36,13 @@ ModelCache::~ModelCache() {
             r1 = r2;
         }
     }
-    delete hash;
+    delete[] hash;
 }
 
 long ModelCache::size() {
-    long size = MODELCACHE_HASHSIZE * sizeof(Model*);
+    long size = capacity * sizeof(Model*);
     Model *r1;
-    int i;
-    for (i = 0; i < MODELCACHE_HASHSIZE; i++) {
+    for (long i = 0; i < capacity; i++) {
         r1 = hash[i];
         while (r1) {
             size += r1->size();
@@ -57,11 +55,13 @@ long ModelCache::size() {
 //-- addModel - put a new Model in the cache. If a matching Model already
 //-- exists, an error is returned.
 bool ModelCache::addModel(class Model *model) {
-    if (findModel(model->getPrintName()) != NULL)
+    if (findModel(model) != NULL)
         return false; //error; exists
-    int hashindex = hashcode(model->getPrintName(), MODELCACHE_HASHSIZE);
+    long hashindex = hashcode(model->getSignature(), capacity);
     model->setHashNext(hash[hashindex]);
     hash[hashindex] = model;
+    if (++count > capacity)
+        grow();
     return true;
 }
 
@@ -70,7 +70,7 @@ bool ModelCache::addModel(class Model *model) {
 bool ModelCache::deleteModel(class Model *model) {
     if (model == NULL)
         return false;
-    int hashindex = hashcode(model->getPrintName(), MODELCACHE_HASHSIZE);
+    long hashindex = hashcode(model->getSignature(), capacity);
     Model *rp = hash[hashindex];
     Model *prev = NULL;
     while (rp && (rp != model)) {
@@ -85,32 +85,110 @@ bool ModelCache::deleteModel(class Model *model) {
         }
         //		printf("deleting: %s\n", model->getPrintName());
         delete rp;
+        count--;
         return true;
     } else {
         return false;
     }
 }
 
+//-- matches - check that a model has exactly the given relations. Relations come
+//-- from the relation cache, so pointers can be compared.
+bool ModelCache::matches(Model *model, Relation **rels, int relCount) {
+    if (model->getRelationCount() != relCount)
+        return false;
+    for (int i = 0; i < relCount; i++) {
+        int j;
+        for (j = 0; j < relCount; j++) {
+            if (model->getRelation(j) == rels[i])
+                break;
+        }
+        if (j == relCount)
+            return false;
+    }
+    return true;
+}
+
 //-- findModel - find a Model in the cache.  Null is returned if the given
 //-- Model doesn't exist.
-class Model *ModelCache::findModel(const char *name) {
-    int hashindex = hashcode(name, MODELCACHE_HASHSIZE);
-    Model *rp = hash[hashindex];
-    while (rp && strcmp(name, rp->getPrintName()) != 0)
+class Model *ModelCache::findModel(Model *model) {
+    int relCount = model->getRelationCount();
+    Relation *rels[relCount > 0 ? relCount : 1];
+    model->getRelations(rels, relCount);
+    return findModel(model->getSignature(), rels, relCount);
+}
+
+class Model *ModelCache::findModel(unsigned long long signature, Relation **rels, int relCount) {
+    Model *rp = hash[hashcode(signature, capacity)];
+    while (rp && (rp->getSignature() != signature || !matches(rp, rels, relCount)))
         rp = rp->getHashNext();
     return rp; // either NULL, or the matching one
 }
 
+//-- findModelWith - this follows Model::addRelation with normalization: if a
+//-- relation of base already contains the new one, nothing changes; otherwise the
+//-- relations contained in the new one are dropped and it is added.
+class Model *ModelCache::findModelWith(Model *base, Relation *added, int skip) {
+    if (base->isStateBased() || added->isStateBased())
+        return NULL;
+    int baseCount = base->getRelationCount();
+    Relation *rels[baseCount + 1];
+    int relCount = 0;
+    unsigned long long signature = 0;
+    bool subsumed = false;
+    for (int i = 0; i < baseCount; i++) {
+        if (i == skip)
+            continue;
+        Relation *rel = base->getRelation(i);
+        if (rel->contains(added))
+            subsumed = true;
+        rels[relCount++] = rel;
+        signature ^= rel->getID();
+    }
+    if (!subsumed) {
+        int kept = 0;
+        for (int i = 0; i < relCount; i++) {
+            if (added->contains(rels[i]))
+                signature ^= rels[i]->getID();
+            else
+                rels[kept++] = rels[i];
+        }
+        relCount = kept;
+        rels[relCount++] = added;
+        signature ^= added->getID();
+    }
+    return findModel(signature, rels, relCount);
+}
+
+//-- grow - double the number of hash chains, and rehash the models
+void ModelCache::grow() {
+    long oldCapacity = capacity;
+    Model **oldHash = hash;
+    capacity *= 2;
+    hash = new Model*[capacity];
+    memset(hash, 0, capacity * sizeof(Model*));
+    for (long i = 0; i < oldCapacity; i++) {
+        Model *model = oldHash[i];
+        while (model) {
+            Model *next = model->getHashNext();
+            long hashindex = hashcode(model->getSignature(), capacity);
+            model->setHashNext(hash[hashindex]);
+            hash[hashindex] = model;
+            model = next;
+        }
+    }
+    delete[] oldHash;
+}
+
 //-- dump - print out all Models in the cache
 void ModelCache::dump() {
-    printf("\nDump ModelCache:\n");
-    for (int i = 0; i < MODELCACHE_HASHSIZE; i++) {
+    printf("\nDump ModelCache: %ld models in %ld chains\n", count, capacity);
+    for (long i = 0; i < capacity; i++) {
         if (hash[i]) {
-            printf("hash chain [%d]:\n", i);
+            printf("hash chain [%ld]:\n", i);
             for (Model *model = hash[i]; model; model = model->getHashNext()) {
                 model->dump();
             }
         }
     }
 }
-
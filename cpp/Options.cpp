@@ -141,6 +141,17 @@ static void setStandardOptions(Options *opts) {
     opts->addOptionValue(def, "#", "");
     def = opts->addOptionName("ipf-maxdev", "i", "Max error in IPF, default=0.25");
     opts->addOptionValue(def, "#", "");
+    def = opts->addOptionName("fit-cache-mb", "", "Megabytes of fitted tables to keep between statistics, default=64");
+    opts->addOptionValue(def, "#", "");
+    def = opts->addOptionName("cache-dir", "", "Directory for saving projections and model statistics between runs");
+    opts->addOptionValue(def, "$", "");
+    def = opts->addOptionName("projection-cache-mb", "", "Megabytes of relation projections to keep, default=0 (no limit)");
+    opts->addOptionValue(def, "#", "");
+    def = opts->addOptionName("search-threads", "", "Threads for computing the statistics of each search level, default=1");
+    opts->addOptionValue(def, "#", "");
+    def = opts->addOptionName("search-prune", "", "Skip fitting search candidates whose bound can't reach the kept models");
+    def = opts->addOptionName("checkpoint", "", "File to save a search to after each level, and to resume it from");
+    opts->addOptionValue(def, "$", "");
     def = opts->addOptionName("no-frequency", "", "There is no frequency data in table");
     def = opts->addOptionName("function-values", "", "Values represent function data, not frequencies.");
     opts->addOptionValue(def, "$", "");
@@ -281,7 +292,7 @@ void Options::setOptions(int argc, char **argv) {
                 currentOptDef = findOptionByName(optname);
                 if (currentOptDef) {
                     if (currentOptDef->values == NULL) { // boolean
-                        setOptionString(currentOptDef, "");
+                        setOptionString(currentOptDef, "Y");
                     } else if (strcmp(currentOptDef->values->value, "#") == 0) { // numeric
                         setOptionFloat(currentOptDef, strtod(optvalue, NULL));
                     } else {
@@ -296,9 +307,9 @@ void Options::setOptions(int argc, char **argv) {
                 if (currentOptDef == NULL) {
                     printf("Error 2: option %s not recognized\n", cp);
                 } else {
-                    //-- for boolean option, set value as "true"
+                    //-- for boolean option, set value as "Y"
                     if (currentOptDef->values == NULL) {
-                        setOptionString(currentOptDef, "");
+                        setOptionString(currentOptDef, "Y");
                         currentOptDef = NULL;
                     }
                 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "ParallelEvaluator.h"
+#include <unordered_set>
+
+ParallelEvaluator::ParallelEvaluator(ManagerBase *manager, int threads) :
+        manager(manager), threadCount(threads > 1 ? threads : 1), batch(NULL), batchCount(0), batchStatistic(NULL),
+        next(0), generation(0), busy(0), stopping(false) {
+}
+
+ParallelEvaluator::~ParallelEvaluator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    for (size_t i = 0; i < contexts.size(); i++)
+        delete contexts[i];
+}
+
+//-- prepare - compute the statistics of the reference models, and the DF, H and
+//-- transmission which the statistics of other models take from them, so that
+//-- the threads only read them
+void ParallelEvaluator::prepare(ModelStatistic statistic) {
+    Model *refs[] = { manager->getTopRefModel(), manager->getBottomRefModel(), manager->getRefModel() };
+    for (int i = 0; i < 3; i++) {
+        if (refs[i] == NULL)
+            continue;
+        statistic(manager, refs[i], NULL);
+        manager->computeDF(refs[i]);
+        manager->computeTransmission(refs[i]);
+    }
+}
+
+void ParallelEvaluator::evaluate(Model **models, long count, ModelStatistic statistic) {
+    if (count <= 0)
+        return;
+    if (count == 1 || threadCount < 2) {
+        for (long i = 0; i < count; i++)
+            statistic(manager, models[i], NULL);
+        return;
+    }
+    prepare(statistic);
+
+    //-- a model listed twice is only evaluated once, so no two threads write it
+    std::vector<Model*> unique;
+    std::unordered_set<Model*> seen;
+    for (long i = 0; i < count; i++)
+        if (seen.insert(models[i]).second)
+            unique.push_back(models[i]);
+
+    if (threads.empty()) {
+        for (int i = 0; i < threadCount; i++) {
+            contexts.push_back(new FitContext());
+            threads.push_back(std::thread(&ParallelEvaluator::work, this, contexts[i]));
+        }
+    }
+
+    //-- hand the batch to the threads; each takes the next model in the list, until
+    //-- none are left
+    std::unique_lock<std::mutex> lock(mutex);
+    batch = unique.data();
+    batchCount = (long) unique.size();
+    batchStatistic = statistic;
+    next = 0;
+    busy = threadCount;
+    generation++;
+    started.notify_all();
+    finished.wait(lock, [this] { return busy == 0; });
+    batch = NULL;
+}
+
+void ParallelEvaluator::work(FitContext *context) {
+    unsigned long done = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [this, done] { return stopping || generation != done; });
+            if (stopping)
+                return;
+            done = generation;
+        }
+        long i;
+        while ((i = next++) < batchCount)
+            batchStatistic(manager, batch[i], context);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busy == 0)
+            finished.notify_one();
+    }
+}
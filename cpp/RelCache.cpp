@@ -5,102 +5,216 @@
  * distribution of this software for license terms.
  */
 
+#include "Constants.h"
 #include "Relation.h"
 #include "RelCache.h"
+#include "Table.h"
 
-#include <assert.h>
 #include <stdio.h>
-#include <stdlib.h>
-#include <memory.h>
 #include <string.h>
 
-static int hashcode(const char *name, int hashsize) {
-    unsigned int key = 0;
-    for (const char *cp = name; *cp; cp++)
-        key = (key << 1) + *cp;
-    return key % hashsize;
-}
-
 RelCache::RelCache() {
-    hash = new Relation*[RELCACHE_HASHSIZE];
-    memset(hash, 0, RELCACHE_HASHSIZE * sizeof(Relation*));
+    capacity = RELCACHE_INITIAL_SIZE;
+    count = 0;
+    tableBudget = RELCACHE_DEFAULT_TABLE_BUDGET;
+    tableBytes = 0;
+    slots = new Relation*[capacity];
+    hashes = new unsigned long long[capacity];
+    memset(slots, 0, capacity * sizeof(Relation*));
 }
 
 //-- destroy relation cache.  This also deletes all the relations held in the cache.
 RelCache::~RelCache() {
-    Relation *r1, *r2;
-    int i;
-    for (i = 0; i < RELCACHE_HASHSIZE; i++) {
-        r1 = hash[i];
-        while (r1) {
-            r2 = r1->getHashNext();
-            delete r1;
-            r1 = r2;
-        }
+    for (long i = 0; i < capacity; i++) {
+        if (slots[i])
+            delete slots[i];
     }
-    delete hash;
+    delete[] slots;
+    delete[] hashes;
 }
 
 long RelCache::size() {
-    long size = RELCACHE_HASHSIZE * sizeof(Relation*);
-    Relation *r1;
-    int i;
-    for (i = 0; i < RELCACHE_HASHSIZE; i++) {
-        r1 = hash[i];
-        while (r1) {
-            size += r1->size();
-            r1 = r1->getHashNext();
-        }
+    long size = capacity * (sizeof(Relation*) + sizeof(unsigned long long));
+    for (long i = 0; i < capacity; i++) {
+        if (slots[i])
+            size += slots[i]->size();
     }
     return size;
 }
 
-//-- delete tables from all relations
+//-- delete tables from all relations, except those which are pinned
 void RelCache::deleteTables() {
-    Relation *r1;
-    int i;
-    for (i = 0; i < RELCACHE_HASHSIZE; i++) {
-        r1 = hash[i];
-        while (r1) {
-            r1->deleteTable();
-            r1 = r1->getHashNext();
+    for (long i = 0; i < capacity; i++) {
+        if (slots[i] == NULL)
+            continue;
+        std::unordered_map<Relation*, TableList::iterator>::iterator found = tableIndex.find(slots[i]);
+        if (found != tableIndex.end() && found->second->pinned)
+            continue;
+        slots[i]->deleteTable();
+    }
+    TableList::iterator it = tableLru.begin();
+    while (it != tableLru.end()) {
+        TableList::iterator next = it;
+        ++next;
+        if (!it->pinned) {
+            tableBytes -= it->bytes;
+            tableIndex.erase(it->rel);
+            tableLru.erase(it);
+        }
+        it = next;
+    }
+}
+
+void RelCache::addTable(Relation *rel) {
+    bool pinned = false;
+    std::unordered_map<Relation*, TableList::iterator>::iterator found = tableIndex.find(rel);
+    if (found != tableIndex.end()) {
+        //-- the table was replaced; forget the old entry but not the pin
+        pinned = found->second->pinned;
+        tableBytes -= found->second->bytes;
+        tableLru.erase(found->second);
+        tableIndex.erase(found);
+    }
+    TableEntry entry;
+    entry.rel = rel;
+    entry.bytes = rel->getTable() ? rel->getTable()->size() : 0;
+    entry.pinned = pinned;
+    tableLru.push_front(entry);
+    tableIndex[rel] = tableLru.begin();
+    tableBytes += entry.bytes;
+}
+
+void RelCache::useTable(Relation *rel) {
+    std::unordered_map<Relation*, TableList::iterator>::iterator found = tableIndex.find(rel);
+    if (found != tableIndex.end() && found->second != tableLru.begin())
+        tableLru.splice(tableLru.begin(), tableLru, found->second);
+}
+
+void RelCache::pinTable(Relation *rel) {
+    std::unordered_map<Relation*, TableList::iterator>::iterator found = tableIndex.find(rel);
+    if (found == tableIndex.end()) {
+        addTable(rel);
+        found = tableIndex.find(rel);
+    }
+    found->second->pinned = true;
+}
+
+void RelCache::trimTables() {
+    if (tableBudget <= 0)
+        return;
+    TableList::iterator it = tableLru.end();
+    while (tableBytes > tableBudget && it != tableLru.begin()) {
+        --it;
+        if (it->pinned)
+            continue;
+        TableList::iterator victim = it++;
+        removeTable(victim);
+    }
+}
+
+void RelCache::removeTable(TableList::iterator it) {
+    tableBytes -= it->bytes;
+    it->rel->deleteTable();
+    tableIndex.erase(it->rel);
+    tableLru.erase(it);
+}
+
+//-- hashKey - hash the variables and states of a relation. Variables which are
+//-- DONT_CARE hash the same as having no state, so that they match.
+unsigned long long RelCache::hashKey(const VarSet &vars, const int *states) {
+    unsigned long long hash = vars.hash();
+    if (states) {
+        int count = vars.count();
+        for (int i = 0; i < count; i++) {
+            if (states[i] != DONT_CARE)
+                hash ^= ((unsigned long long) states[i] + 1) * 0x9e3779b97f4a7c15ULL + i + (hash << 6) + (hash >> 2);
         }
     }
+    //-- finish by mixing the bits, since the slot is taken from the low ones
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+bool RelCache::matches(Relation *rel, const VarSet &vars, const int *states) {
+    if (rel->getVarSet() != vars)
+        return false;
+    int *relStates = rel->getStateIndices();
+    if (relStates == NULL && states == NULL)
+        return true;
+    int varCount = rel->getVariableCount();
+    for (int i = 0; i < varCount; i++) {
+        int state = states ? states[i] : DONT_CARE;
+        int relState = relStates ? relStates[i] : DONT_CARE;
+        if (state != relState)
+            return false;
+    }
+    return true;
 }
 
 //-- addRelation - put a new relation in the cache. If a matching relation already
 //-- exists, an error is returned.
-// [JSF] This doesn't seem to check for matches, or return errors.
 bool RelCache::addRelation(class Relation *rel) {
-    if (findRelation(rel->getPrintName()) != NULL)
-        return false; //error; exists
-    KeySegment *mask = rel->getMask();
-    int hashindex = hashcode(rel->getPrintName(), RELCACHE_HASHSIZE);
-    rel->setHashNext(hash[hashindex]);
-    hash[hashindex] = rel;
+    const VarSet &vars = rel->getVarSet();
+    int *states = rel->getStateIndices();
+    unsigned long long hash = hashKey(vars, states);
+    long mask = capacity - 1;
+    long slot;
+    for (slot = hash & mask; slots[slot]; slot = (slot + 1) & mask) {
+        if (hashes[slot] == hash && matches(slots[slot], vars, states))
+            return false; //error; exists
+    }
+    slots[slot] = rel;
+    hashes[slot] = hash;
+    if (++count * 2 > capacity)
+        grow();
     return true;
 }
 
 //-- findRelation - find a relation in the cache.  Null is returned if the given
 //-- relation doesn't exist.
-class Relation *RelCache::findRelation(const char *name) {
-    int hashindex = hashcode(name, RELCACHE_HASHSIZE);
-    Relation *rp = hash[hashindex];
-    while (rp && strcmp(name, rp->getPrintName()) != 0)
-        rp = rp->getHashNext();
-    return rp; // either NULL, or the matching one
+class Relation *RelCache::findRelation(const VarSet &vars, const int *states) {
+    unsigned long long hash = hashKey(vars, states);
+    long mask = capacity - 1;
+    for (long slot = hash & mask; slots[slot]; slot = (slot + 1) & mask) {
+        if (hashes[slot] == hash && matches(slots[slot], vars, states))
+            return slots[slot];
+    }
+    return NULL;
+}
+
+//-- grow - double the table size, and reinsert the relations
+void RelCache::grow() {
+    long oldCapacity = capacity;
+    Relation **oldSlots = slots;
+    unsigned long long *oldHashes = hashes;
+    capacity *= 2;
+    slots = new Relation*[capacity];
+    hashes = new unsigned long long[capacity];
+    memset(slots, 0, capacity * sizeof(Relation*));
+    long mask = capacity - 1;
+    for (long i = 0; i < oldCapacity; i++) {
+        if (oldSlots[i] == NULL)
+            continue;
+        long slot = oldHashes[i] & mask;
+        while (slots[slot])
+            slot = (slot + 1) & mask;
+        slots[slot] = oldSlots[i];
+        hashes[slot] = oldHashes[i];
+    }
+    delete[] oldSlots;
+    delete[] oldHashes;
 }
 
 //-- dump - print out all relations in the cache
 void RelCache::dump() {
-    printf("\nDumping RelCache:\n");
-    for (int i = 0; i < RELCACHE_HASHSIZE; i++) {
-        if (hash[i]) {
-            printf("hash chain [%d]:\n", i);
-            for (Relation *rel = hash[i]; rel; rel = rel->getHashNext()) {
-                rel->dump();
-            }
+    printf("\nDumping RelCache: %ld relations in %ld slots; %lld bytes of tables (budget %lld)\n",
+            count, capacity, tableBytes, tableBudget);
+    for (long i = 0; i < capacity; i++) {
+        if (slots[i]) {
+            printf("slot [%ld]:\n", i);
+            slots[i]->dump();
         }
     }
 }
-
@@ -5,33 +5,47 @@
  * distribution of this software for license terms.
  */
 
+#include <float.h>
+#include <math.h>
+
 #include "AttributeList.h"
 #include "Key.h"
 #include "Relation.h"
 #include "StateConstraint.h"
 #include "_Core.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+//-- the arena for relations; it is never destroyed, as relations may outlive statics
+Arena *Relation::getArena() {
+    static Arena *arena = new Arena();
+    return arena;
+}
+
 Relation::Relation(VariableList *list, int size, int keysz, long stateconstsz) {
+    id = list ? list->nextRelationID() : 0;
     varList = list;
     maxVarCount = size;
     varCount = 0;
-    vars = new int[size];
+    vars = (int *) getArena()->allocate(size * sizeof(int));
     table = NULL;
+    indexedSerial = 0;
+    inputIndex = NULL;
+    logValues = NULL;
     stateConstraints = NULL;
     states = NULL;
     if (stateconstsz >= 0) {
         //needs a better keysize value........Anjali
-        states = new int[size];
+        states = (int *) getArena()->allocate(size * sizeof(int));
         stateConstraints = new StateConstraint(keysz, stateconstsz);
     }
     mask = NULL;
-    hashNext = NULL;
-    attributeList = new AttributeList(2);
+    varSet = NULL;
+    attributeList = new (getArena()) AttributeList(2, getArena());
     printName = NULL;
     inverseName = NULL;
     indepOnly = -1;
@@ -40,20 +54,18 @@ Relation::Relation(VariableList *list, int size, int keysz, long stateconstsz) {
 Relation::~Relation() {
     // delete storage.
     delete attributeList;
-    if (states)
-        delete states;
-    if (printName)
-        delete printName;
-    if (inverseName)
-        delete inverseName;
-    if (vars)
-        delete vars;
+    Arena::release(states);
+    Arena::release(printName);
+    Arena::release(inverseName);
+    Arena::release(vars);
     if (stateConstraints)
         delete stateConstraints;
     if (table)
         delete table;
-    if (mask)
-        delete[] mask;
+    deleteInputIndex();
+    Arena::release(mask);
+    if (varSet)
+        delete varSet;
 }
 
 long Relation::size() {
@@ -76,9 +88,9 @@ bool Relation::isStateBased() {
 void Relation::addVariable(int varindex, int stateind) {
     const int FACTOR = 2;
     while (varCount >= maxVarCount) {
-        vars = (int*) growStorage(vars, maxVarCount*sizeof(int), FACTOR);
+        vars = (int*) getArena()->reallocate(vars, maxVarCount*sizeof(int), FACTOR*maxVarCount*sizeof(int));
         if (stateind >= 0 || stateind == DONT_CARE) {
-            states = (int*) growStorage(states, maxVarCount*sizeof(int), FACTOR);
+            states = (int*) getArena()->reallocate(states, maxVarCount*sizeof(int), FACTOR*maxVarCount*sizeof(int));
         }
         maxVarCount *= FACTOR;
     }
@@ -87,6 +99,10 @@ void Relation::addVariable(int varindex, int stateind) {
         states[varCount] = stateind;
     }
     varCount++;
+    if (varSet) {
+        delete varSet;
+        varSet = NULL;
+    }
 }
 
 // returns the VariableList object
@@ -220,6 +236,7 @@ double Relation::getExpansionSize() {
 }
 // sets a pointer to the table in the relation object
 void Relation::setTable(Table *tbl) {
+    deleteInputIndex();
     table = tbl;
 }
 
@@ -234,6 +251,7 @@ void Relation::deleteTable() {
         delete table;
         table = NULL;
     }
+    deleteInputIndex();
 }
 
 // sets/gets the state constraints for the relation
@@ -247,7 +265,7 @@ StateConstraint *Relation::getStateConstraints() {
 
 // compare two relations for equality (same set of variables)
 int Relation::compare(Relation *other) {
-    int compare = ocCompareVariables(varCount, vars, other->varCount, other->vars);
+    int compare = getVarSet().compare(other->getVarSet());
     if ((compare == 0) && (isStateBased() || other->isStateBased())) {
         return strcmp(getPrintName(), other->getPrintName());
     } else
@@ -260,7 +278,7 @@ bool Relation::contains(Relation *other) {
         return ocContainsStates(varCount, vars, states, other->varCount, other->vars, other->states);
         // or check if models of rel A & B are equivalent
     else
-        return ocContainsVariables(varCount, vars, other->varCount, other->vars);
+        return getVarSet().contains(other->getVarSet());
 }
 
 // see if all variables are independent variables. These relations are not decomposed during search
@@ -316,21 +334,18 @@ KeySegment *Relation::getMask() {
     return mask;
 }
 
-static int sortCompare(const void *k1, const void *k2) {
-    return *((int*) k1) - *((int*) k2);
-}
-
-static int *sorting_vars;
-//static int sbSortCompare(void *thunk, const void *k1, const void *k2) {
-static int sbSortCompare(const void *k1, const void *k2) {
-    //int* vars = (int *) thunk;
-    return sorting_vars[*((int *) k1)] - sorting_vars[*((int *) k2)];
-}
+//-- orders indices into a list of variables by the variables
+struct VarIndexOrder {
+    const int *vars;
+    bool operator()(int i1, int i2) const {
+        return vars[i1] < vars[i2];
+    }
+};
 
 void Relation::sort(int *vars, int varCount, int *states) {
     if (varCount <= 1) return;
     if (states == NULL) {
-        qsort(vars, varCount, sizeof(int), sortCompare);
+        std::sort(vars, vars + varCount);
     } else {
         // when there are states, we must arrange both lists in unison, by the vars values.
         // we do this by sorting an index list based on the vars values, and then arranging
@@ -338,10 +353,8 @@ void Relation::sort(int *vars, int varCount, int *states) {
         int* order = new int[varCount];
         for (int i = 0; i < varCount; i++)
             order[i] = i;
-        // order of args must be changed for qsort_r, and its compare function, from BSD to GNU.
-        // last 2 args of qsort_r must be switched, and the thunk moved to the end of compare.
-        sorting_vars = vars;
-        qsort(order, varCount, sizeof(int), sbSortCompare);
+        VarIndexOrder byVar = { vars };
+        std::stable_sort(order, order + varCount, byVar);
         int *vars_copy = new int[varCount];
         int *states_copy = new int[varCount];
         memcpy(vars_copy, vars, varCount * sizeof(int));
@@ -358,7 +371,6 @@ void Relation::sort(int *vars, int varCount, int *states) {
 
 void Relation::sort() {
     sort(vars, varCount, states);
-    //qsort(vars, varCount, sizeof(int), sortCompare);
 }
 
 void Relation::setAttribute(const char *name, double value) {
@@ -374,7 +386,7 @@ const char* Relation::getPrintName(int useInverse) {
         if (printName == NULL) {
             int maxlength = 0;
             maxlength = varList->getPrintLength(varCount, vars, states);
-            printName = new char[maxlength + 1];
+            printName = (char *) getArena()->allocate(maxlength + 1);
             varList->getPrintName(printName, maxlength, varCount, vars, states);
         }
         return printName;
@@ -394,7 +406,7 @@ const char* Relation::getPrintName(int useInverse) {
             }
             if (maxlength < 40)
                 maxlength = 40; //??String allocation bug?
-            inverseName = new char[maxlength + 1];
+            inverseName = (char *) getArena()->allocate(maxlength + 1);
             char *local_name = inverseName + 1;
             varList->getPrintName(local_name, maxlength, local_count, local_vars);
 
@@ -458,9 +470,71 @@ double Relation::getMatchingTupleValue(KeySegment *key) {
     return value;
 }
 
+long long *Relation::getInputIndex(Table *input) {
+    if (inputIndex && indexedSerial == input->getSerial())
+        return inputIndex;
+    deleteInputIndex();
+    Table *table = getTable();
+    if (table == NULL)
+        return NULL;
+    long long tableCount = table->getTupleCount();
+    inputIndex = new long long[input->getTupleCount()];
+    indexInput(input, inputIndex);
+    logValues = new double[tableCount + 2];
+    for (long long j = 0; j < tableCount; j++) {
+        double value = table->getValue(j);
+        logValues[j] = value > DBL_EPSILON ? log(value) : NAN;
+    }
+    logValues[tableCount] = NAN;
+    logValues[tableCount + 1] = 0.0;
+    indexedSerial = input->getSerial();
+    return inputIndex;
+}
+
+void Relation::indexInput(Table *input, long long *index) {
+    Table *table = getTable();
+    KeySegment *mask = getMask();
+    long keysize = getKeySize();
+    KeySegment newKey[keysize];
+    long long count = input->getTupleCount();
+    long long tableCount = table->getTupleCount();
+    for (long long i = 0; i < count; i++) {
+        KeySegment *key = input->getKey(i);
+        for (int k = 0; k < keysize; k++) {
+            newKey[k] = key[k] | mask[k];
+        }
+        long long j = table->indexOf(newKey);
+        if (j < 0) {
+            //-- a key with a don't care for one of the relation's variables isn't
+            //-- constrained by it; otherwise its marginal is zero
+            j = tableCount;
+            for (int v = 0; v < varCount; v++) {
+                Variable *var = varList->getVariable(vars[v]);
+                if ((key[var->segment] & var->mask) == var->mask) {
+                    j = tableCount + 1;
+                    break;
+                }
+            }
+        }
+        index[i] = j;
+    }
+}
+
+void Relation::deleteInputIndex() {
+    if (inputIndex) {
+        delete[] inputIndex;
+        inputIndex = NULL;
+    }
+    if (logValues) {
+        delete[] logValues;
+        logValues = NULL;
+    }
+    indexedSerial = 0;
+}
+
 void Relation::buildMask() {
     int keysize = varList->getKeySize();
-    mask = new KeySegment[keysize];
+    mask = (KeySegment *) getArena()->allocate(keysize * sizeof(KeySegment));
     Key::buildMask(mask, keysize, varList, vars, varCount);
 }
 
@@ -14,6 +14,7 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <algorithm>
 
 /* Global and static variables...
  * collected towards the top in an attempt to increase my understanding */
@@ -24,8 +25,6 @@ int Report::maxNameLength;
 
 Report::Report(class ManagerBase *mgr) {
     manager = mgr;
-    extern int searchDir;
-    searchDir = -1;
     maxModelCount = 10;
     models = new Model*[maxModelCount];
     memset(models, 0, maxModelCount * sizeof(Model*));
@@ -89,21 +88,11 @@ void Report::setAttributes(const char *attrlist) {
 }
 
 void Report::sort(const char *attr, Direction dir) {
-    extern const char *sortAttr;
-    extern Direction sortDir;
-    extern Direction searchDir;
-    sortAttr = attr;
-    sortDir = dir;
-    searchDir = manager->getSearchDirection();
-    qsort(models, modelCount, sizeof(Model*), sortCompare);
+    std::stable_sort(models, models + modelCount, ModelOrder(attr, dir, manager->getSearchDirection()));
 }
 
 void Report::sort(class Model** models, long modelCount, const char *attr, Direction dir) {
-    extern const char *sortAttr;
-    extern Direction sortDir;
-    sortAttr = attr;
-    sortDir = dir;
-    qsort(models, modelCount, sizeof(Model*), sortCompare);
+    std::stable_sort(models, models + modelCount, ModelOrder(attr, dir));
 }
 
 // Print a report of the search results
@@ -6,6 +6,7 @@
  */
 
 #include "Key.h"
+#include "KeyOrder.h"
 #include "Report.h"
 #include "ManagerBase.h"
 #include <cstring>
@@ -50,6 +51,7 @@ void Report::printConditional_DV(FILE *fd, Model *model, Relation *rel, bool cal
     if (test_sample_size > 0.0)
         test_table = new Table(key_size, test_data->getTupleCount());
     if (rel == NULL) {
+        manager->makeFitTable(model);
         Table* orig_table = manager->getFitTable();
         if (orig_table == NULL) {
             fprintf(fd, "Error: no fitted table computed.\n");
@@ -90,6 +92,7 @@ void Report::printConditional_DV(FILE *fd, Model *model, Relation *rel, bool cal
                 manager->makeProjection(test_data, test_table, predRelWithDV);
             iv_rel = predRelWithDV;
         } else {
+            manager->makeProjection(rel);
             fit_table = rel->getTable();
             manager->makeProjection(input_data, input_table, rel);
             if (test_sample_size > 0.0)
@@ -878,12 +881,7 @@ void Report::printConditional_DV(FILE *fd, Model *model, Relation *rel, bool cal
         key_order[i] = i;
     
     
-    sort_var_list = var_list;
-    sort_count = iv_count;
-    sort_vars = ind_vars;
-    sort_keys = fit_key;
-    
-    qsort(key_order, iv_statespace, sizeof(int), sortKeys);
+    KeyOrder(var_list, iv_count, ind_vars, NULL, fit_key).sort(key_order, iv_statespace);
 
     // Prep for P-MARGIN, P-RULE
     // Make table containing univorm distribution of DV cardinality
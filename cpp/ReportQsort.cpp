@@ -5,24 +5,22 @@
  * distribution of this software for license terms.
  */
 
+#include "AttributeList.h"
 #include "Key.h"
+#include "KeyOrder.h"
 #include "Model.h"
+#include "Report.h"
+#include "Table.h"
+#include "VariableList.h"
+#include <algorithm>
 #include <cctype>
 #include <cstring>
-//-- support routines for quicksort. The static variables
-//-- are used to communicate between the sort and compare routines
+#include <utility>
+//-- support routines for sorting. The comparators carry their own settings,
+//-- so sorts for different reports don't interfere.
 // The "levelPref" variable is used to sub-sort during a search,
 // preferring to keep the models sorted in the order of the search.
 
-VariableList *sort_var_list;
-int sort_count;
-int *sort_vars;
-KeySegment **sort_keys;
-Table *sort_table;
-const char *sortAttr;
-Direction sortDir;
-Direction searchDir;
-
 
 int allNumeric(const char* s) {
     bool ret = true;
@@ -40,46 +38,144 @@ int strcmpAccountingForNumbers(const char* s1, const char* s2) {
         return strcmp(s1, s2);
     }
 }
-int sortCompare(const void *k1, const void *k2) {
-    Model *m1 = *((Model**) k1);
-    Model *m2 = *((Model**) k2);
-    double a1 = m1->getAttribute(sortAttr);
-    double a2 = m2->getAttribute(sortAttr);
-    double l1 = m1->getAttribute("Level");
-    double l2 = m2->getAttribute("Level");
+ModelOrder::ModelOrder(const char *attr, Direction dir) :
+        attrName(attr), attrId(AttributeList::findId(attr)), dir(dir), byLevel(false),
+        searchDir(Direction::Ascending) {
+}
+
+ModelOrder::ModelOrder(const char *attr, Direction dir, Direction searchDir) :
+        attrName(attr), attrId(AttributeList::findId(attr)), dir(dir), byLevel(true), searchDir(searchDir) {
+}
+
+int ModelOrder::compare(Model *m1, Model *m2) const {
+    double a1, a2;
+    if (attrId >= 0) {
+        AttributeName attr = { attrId, attrName };
+        a1 = m1->getAttribute(attr);
+        a2 = m2->getAttribute(attr);
+    } else {
+        a1 = m1->getAttribute(attrName);
+        a2 = m2->getAttribute(attrName);
+    }
+    double l1 = m1->getAttribute(ATTRIBUTE_LEVEL);
+    double l2 = m2->getAttribute(ATTRIBUTE_LEVEL);
     int levelPref = 0;
-    if      (searchDir == Direction::Ascending)  { levelPref = (l1 > l2) ? -1 : (l1 < l2) ? 1 : 0; } 
-    else if (searchDir == Direction::Descending) { levelPref = (l1 < l2) ? -1 : (l1 > l2) ? 1 : 0; }
-    if (sortDir == Direction::Descending) { return (a1 > a2) ? -1 : (a1 < a2) ? 1 : levelPref; }
+    if      (byLevel && searchDir == Direction::Ascending)  { levelPref = (l1 > l2) ? -1 : (l1 < l2) ? 1 : 0; } 
+    else if (byLevel && searchDir == Direction::Descending) { levelPref = (l1 < l2) ? -1 : (l1 > l2) ? 1 : 0; }
+    if (dir == Direction::Descending) { return (a1 > a2) ? -1 : (a1 < a2) ? 1 : levelPref; }
     else                       { return (a1 < a2) ? -1 : (a1 > a2) ? 1 : levelPref; }
 }
-int sortKeys(const void *d1, const void *d2) {
-    int keysize = sort_var_list->getKeySize();
-    KeySegment *k1, *k2;
-    if (sort_keys == NULL) {
-        k1 = sort_table->getKey((long long)*(int*) d1);
-        k2 = sort_table->getKey((long long)*(int*) d2);
-    } else {
-        k1 = sort_keys[*(int*) d1];
-        k2 = sort_keys[*(int*) d2];
+
+KeyOrder::KeyOrder(VariableList *varlist, int count, int *vars, Table *table, KeySegment **keys) :
+        varList(varlist), count(count), vars(vars), table(table), keys(keys), keysize(varlist->getKeySize()),
+        totalBits(0) {
+    ranks = new int*[count];
+    bits = new int[count];
+    for (int j = 0; j < count; j++) {
+        int v = vars ? vars[j] : j;
+        Variable *var = varList->getVariable(v);
+        //-- every value the variable's bits can hold, including DONT_CARE
+        int valueCount = (int) (var->mask >> var->shift) + 1;
+        int *byLabel = new int[valueCount];
+        for (int i = 0; i < valueCount; i++)
+            byLabel[i] = i;
+        std::stable_sort(byLabel, byLabel + valueCount, [this, v](int a, int b) {
+            return strcmpAccountingForNumbers(varList->getVarValue(v, a), varList->getVarValue(v, b)) < 0;
+        });
+        //-- values which print the same share a rank
+        ranks[j] = new int[valueCount];
+        int rank = 0;
+        for (int i = 0; i < valueCount; i++) {
+            if (i > 0 && strcmpAccountingForNumbers(varList->getVarValue(v, byLabel[i - 1]),
+                    varList->getVarValue(v, byLabel[i])) != 0)
+                rank++;
+            ranks[j][byLabel[i]] = rank;
+        }
+        delete[] byLabel;
+        bits[j] = 0;
+        while ((1 << bits[j]) <= rank)
+            bits[j]++;
+        totalBits += bits[j];
     }
-    const char *s1, *s2;
-    int test;
-    int v;
-    for (int j = 0; j < sort_count; j++) {
-        if (sort_vars == NULL) {
-            v = j;
-        } else {
-            v = sort_vars[j];
+}
+
+KeyOrder::~KeyOrder() {
+    for (int j = 0; j < count; j++)
+        delete[] ranks[j];
+    delete[] ranks;
+    delete[] bits;
+}
+
+KeySegment *KeyOrder::getKey(int i) {
+    return keys ? keys[i] : table->getKey((long long) i);
+}
+
+int KeyOrder::getRank(KeySegment *key, int j) {
+    int v = vars ? vars[j] : j;
+    return ranks[j][Key::getKeyValue(key, keysize, varList, v)];
+}
+
+int KeyOrder::compare(int i1, int i2) {
+    KeySegment *k1 = getKey(i1);
+    KeySegment *k2 = getKey(i2);
+    for (int j = 0; j < count; j++) {
+        int r1 = getRank(k1, j);
+        int r2 = getRank(k2, j);
+        if (r1 != r2)
+            return r1 < r2 ? -1 : 1;
+    }
+    return 0;
+}
+
+void KeyOrder::sort(int *order, long long n) {
+    if (n < 2)
+        return;
+    if (totalBits <= 64) {
+        //-- the ranks of a key, packed with the first variable highest, sort as
+        //-- one integer
+        std::pair<unsigned long long, int> *packed = new std::pair<unsigned long long, int>[n];
+        for (long long i = 0; i < n; i++) {
+            KeySegment *key = getKey(order[i]);
+            unsigned long long value = 0;
+            for (int j = 0; j < count; j++)
+                value = (value << bits[j]) | (unsigned long long) getRank(key, j);
+            packed[i] = std::make_pair(value, order[i]);
         }
-        s1 = sort_var_list->getVarValue(v, Key::getKeyValue(k1, keysize, sort_var_list, v));
-        s2 = sort_var_list->getVarValue(v, Key::getKeyValue(k2, keysize, sort_var_list, v));
-        test = strcmpAccountingForNumbers(s1, s2);
-        if (test != 0) {
-            return test;
+        std::stable_sort(packed, packed + n,
+                [](const std::pair<unsigned long long, int> &a, const std::pair<unsigned long long, int> &b) {
+                    return a.first < b.first;
+                });
+        for (long long i = 0; i < n; i++)
+            order[i] = packed[i].second;
+        delete[] packed;
+    } else {
+        //-- too many variables to pack; compare rows of ranks
+        int *rows = new int[n * count];
+        int *position = new int[n];
+        for (long long i = 0; i < n; i++) {
+            KeySegment *key = getKey(order[i]);
+            for (int j = 0; j < count; j++)
+                rows[i * count + j] = getRank(key, j);
+            position[i] = (int) i;
         }
+        int width = count;
+        std::stable_sort(position, position + n, [rows, width](int a, int b) {
+            const int *ra = rows + (long long) a * width;
+            const int *rb = rows + (long long) b * width;
+            for (int j = 0; j < width; j++) {
+                if (ra[j] != rb[j])
+                    return ra[j] < rb[j];
+            }
+            return false;
+        });
+        int *sorted = new int[n];
+        for (long long i = 0; i < n; i++)
+            sorted[i] = order[position[i]];
+        memcpy(order, sorted, n * sizeof(int));
+        delete[] sorted;
+        delete[] position;
+        delete[] rows;
     }
-    return 0;
 }
 
 
@@ -66,6 +66,7 @@ bool SBMManager::initFromCommandLine(int argc, char **argv) {
         }
         Relation *top = getRelation(var_indices, var_count, false, state_indices);
         top->setTable(inputData);
+        openDiskCache("sb");
         makeReferenceModels(top);
         delete[] var_indices;
         delete[] state_indices;
@@ -128,14 +129,14 @@ void SBMManager::makeReferenceModels(Relation *top) {
             }
         }
         rel = getRelation(varindices, pos, true, state_indices);
-        model->addRelation(rel, true, getModelCache());
+        model->addRelation(rel, true);
         //-- now add a unary relation for each dependent variable
         for (i = 0; i < varCount; i++) {
             var = varList->getVariable(i);
             if (var->dv) {
                 varindices[0] = i;
                 rel = getRelation(varindices, 1, true, state_indices);
-                model->addRelation(rel, true, getModelCache());
+                model->addRelation(rel, true);
             }
         }
         model->completeSbModel();
@@ -148,7 +149,7 @@ void SBMManager::makeReferenceModels(Relation *top) {
         for (i = 0; i < varCount; i++) {
             varindices[0] = i;
             rel = getRelation(varindices, 1, true, state);
-            model->addRelation(rel, true, getModelCache());
+            model->addRelation(rel, true);
             /*
              int inputCells = 1;
              int varcount = varList->getVarCount();
@@ -178,7 +179,7 @@ void SBMManager::makeReferenceModels(Relation *top) {
     }
     bottomRef = model;
     if (!modelCache->addModel(bottomRef)) {
-        Model *cached_model = modelCache->findModel(bottomRef->getPrintName());
+        Model *cached_model = modelCache->findModel(bottomRef);
         delete bottomRef;
         bottomRef = cached_model;
     }
@@ -193,6 +194,7 @@ void SBMManager::makeReferenceModels(Relation *top) {
     //-- set default reference model depending on whether
     //-- the system is directed or neutral
     refModel = varList->isDirected() ? bottomRef : bottomRef;
+    pinProjections(bottomRef);
     delete[] state_indices;
     delete[] varindices;
 }
@@ -204,17 +206,19 @@ Model *SBMManager::setRefModel(const char *name) {
         refModel = bottomRef;
     } else {
         refModel = makeSbModel(name, true);
+        if (refModel)
+            pinProjections(refModel);
     }
     return refModel;
 }
 
-double SBMManager::computeExplainedInformation(Model *model) {
+double SBMManager::computeExplainedInformation(Model *model, FitContext *context) {
     double info = model->getAttribute(ATTRIBUTE_EXPLAINED_I);
     if (info >= 0)
         return info;
     double topH = topRef->getAttribute(ATTRIBUTE_H);
     double botH = bottomRef->getAttribute(ATTRIBUTE_H);
-    double modelT = computeTransmission(model, IPF);
+    double modelT = computeTransmission(model, IPF, 0, context);
     info = (botH - topH - modelT) / (botH - topH);
     // info is normalized but may not quite be between zero and 1 due to roundoff. Fix this here.
     if (info <= 0.0)
@@ -225,10 +229,10 @@ double SBMManager::computeExplainedInformation(Model *model) {
     return info;
 }
 
-double SBMManager::computeUnexplainedInformation(Model *model) {
+double SBMManager::computeUnexplainedInformation(Model *model, FitContext *context) {
     double topH = topRef->getAttribute(ATTRIBUTE_H);
     double botH = bottomRef->getAttribute(ATTRIBUTE_H);
-    double modelT = computeTransmission(model, IPF);
+    double modelT = computeTransmission(model, IPF, 0, context);
     double info = modelT / (botH - topH);
     // info is normalized but may not quite be between zero and 1 due to roundoff. Fix this here.
     if (info <= 0.0)
@@ -270,30 +274,30 @@ void SBMManager::computeDFStatistics(Model *model) {
     computeDDF(model);
 }
 
-void SBMManager::computeInformationStatistics(Model *model) {
+void SBMManager::computeInformationStatistics(Model *model, FitContext *context) {
     if (model == topRef || model == bottomRef) {
-        computeH(model, ALGEBRAIC, 1);
-        computeTransmission(model, ALGEBRAIC, 1);
+        computeH(model, ALGEBRAIC, 1, context);
+        computeTransmission(model, ALGEBRAIC, 1, context);
     } else {
-        computeH(model, IPF, 1);
-        computeTransmission(model, IPF, 1);
+        computeH(model, IPF, 1, context);
+        computeTransmission(model, IPF, 1, context);
     }
-    computeExplainedInformation(model);
-    computeUnexplainedInformation(model);
+    computeExplainedInformation(model, context);
+    computeUnexplainedInformation(model, context);
 }
 
-void SBMManager::computeL2Statistics(Model *model) {
+void SBMManager::computeL2Statistics(Model *model, FitContext *context) {
     //-- make sure we have the fitted table (needed for some statistics)
     //-- this will return immediately if the table was already created.
     //-- make sure the other attributes are there
     computeDFStatistics(model);
-    computeInformationStatistics(model);
+    computeInformationStatistics(model, context);
     //-- compute chi-squared statistics and related statistics. L2 = 2*n*sum(p(ln p/q))
     //-- which is 2*n*ln(2)*T
     int errcode;
-    double modelT = computeTransmission(model, IPF);
+    double modelT = computeTransmission(model, IPF, 0, context);
     double modelL2 = 2.0 * M_LN2 * sampleSize * modelT;
-    double refT = computeTransmission(refModel);
+    double refT = computeTransmission(refModel, AUTO, 0, context);
     double refL2 = 2.0 * M_LN2 * sampleSize * refT;
     double refModelL2 = refL2 - modelL2;
     double modelDF = computeDfSb(model);
@@ -355,14 +359,10 @@ void SBMManager::computePearsonStatistics(Model *model) {
     //-- sure one has been created.
     if (model == NULL || bottomRef == NULL)
         return;
-    makeFitTable(model);
-
-    Table *modelFitTable = new Table(keysize, fitTable1->getTupleCount());
-
-    modelFitTable->copy(fitTable1);
-    makeFitTable(bottomRef);
-    double modelP2 = ocPearsonChiSquared(inputData, modelFitTable, (long) round(sampleSize));
-    double refP2 = ocPearsonChiSquared(inputData, fitTable1, (long) round(sampleSize));
+    computeFitStatistics(model);
+    computeFitStatistics(bottomRef);
+    double modelP2 = model->getAttribute(ATTRIBUTE_FIT_P2);
+    double refP2 = bottomRef->getAttribute(ATTRIBUTE_FIT_P2);
 
     int errcode;
     double modelDF = computeDfSb(model);
@@ -391,10 +391,9 @@ void SBMManager::computePearsonStatistics(Model *model) {
     model->setAttribute(ATTRIBUTE_P2, modelP2);
     model->setAttribute(ATTRIBUTE_P2_ALPHA, refP2Prob);
     model->setAttribute(ATTRIBUTE_P2_BETA, refP2Power);
-    delete modelFitTable;
 }
 
-void SBMManager::computeDependentStatistics(Model *model) {
+void SBMManager::computeDependentStatistics(Model *model, FitContext *context) {
     //-- the basic metric is the conditional uncertainty u(Z|ABC...), which is
     //-- u(model) - u(ABC...), where ABC... are the independent variables
     //-- first, compute the relation stats for the bottom reference model, which
@@ -410,11 +409,11 @@ void SBMManager::computeDependentStatistics(Model *model) {
             break; // this is the one.
     }
     double indH = indRel->getAttribute(ATTRIBUTE_H);
-    double refH = computeH(bottomRef);
+    double refH = computeH(bottomRef, AUTO, 0, context);
     double refCondH = refH - indH;
 
     //printf("compute H in SB computeDependStat\n");
-    double h = computeH(model, IPF);
+    double h = computeH(model, IPF, 0, context);
     double condH = h - indH;
     model->setAttribute(ATTRIBUTE_COND_H, condH);
     model->setAttribute(ATTRIBUTE_COND_DH, refH - h);
@@ -517,20 +516,13 @@ void SBMManager::computeBPStatistics(Model *model) {
     long fullDimension = (long) ocDegreesOfFreedom(topRef->getRelation(0)) + 1;
 
     BPIntersectProcessor processor(inputData, model->getRelationCount(), fullDimension);
-    if (intersectArray != NULL) {
-        delete[] intersectArray;
-        intersectCount = 0;
-        intersectMax = model->getRelationCount();
-        ;
-        intersectArray = NULL;
-    }
 
     doIntersectionProcessing(model, &processor);
     double t = processor.getTransmission();
     model->setAttribute(ATTRIBUTE_BP_T, t);
 }
 
-void SBMManager::computePercentCorrect(Model *model) {
+void SBMManager::computePercentCorrect(Model *model, FitContext *context) {
     double total;
     long long count, i;
     Relation *indRel = getIndRelation();
@@ -539,11 +531,11 @@ void SBMManager::computePercentCorrect(Model *model) {
     if (indRel == 0 || depRel == 0)
         return;
     ((ManagerBase*) this)->makeProjection(depRel);
-    if (!makeFitTable(model)) {
+    if (!makeFitTable(model, context)) {
         printf("ERROR: Failed to create state-based fit table. Terminating.\n");
         exit(1);
     }
-    Table *modelTable = fitTable1;
+    Table *modelTable = getFitTable(context);
     Table *maxTable = new Table(modelTable->getKeySize(), modelTable->getTupleCount());
 
     int maxCount = varList->getVarCount();
@@ -16,19 +16,17 @@
 #include "Math.h"
 #include <assert.h>
 #include <iostream>
+#include <unordered_set>
+#include <vector>
 using namespace std;
 
 //----- Full search down through the lattice -----
 
-Model **SearchFullDown::search(Model *start) {
-    //-- worst case - need a list with a slot for each relation in start model,
-    //-- plus one for null termination of list
+void SearchFullDown::generate(Model *start, CandidateSink &sink) {
     int relcount = start->getRelationCount();
-    Model **models = new Model *[relcount + 1];
     Model *model;
-    int i, slot;
-    memset(models, 0, (relcount + 1) * sizeof(Model*));
-    for (i = 0, slot = 0; i < relcount; i++) {
+    int i;
+    for (i = 0; i < relcount; i++) {
         Relation *rel = start->getRelation(i);
         //-- skip trivial relations
         if (rel->getVariableCount() == 1)
@@ -41,9 +39,8 @@ Model **SearchFullDown::search(Model *start) {
         //-- otherwise this will generate a child relation
         model = ((VBMManager *) manager)->makeChildModel(start, i, 0, makeProjection());
         if (((VBMManager *) manager)->applyFilter(model))
-            models[slot++] = model;
+            sink.accept(model);
     }
-    return models;
 }
 
 //----- Full search up through the lattice -----
@@ -278,56 +275,43 @@ static bool pop(SearchStackEntry *stack, int &top) {
 void SearchFullUp::makeCandidate(SearchStackEntry *stack, int top, Model *start) {
     int varcount = top;
     SearchStackEntry *stackEntry;
-    int *vars = new int[top];
+    int vars[top];
     for (int i = 0; i < top; i++) {
         stackEntry = &stack[i];
         vars[i] = stackEntry->outerList[stackEntry->varIndex];
     }
+    //-- a relation found before gives the same model again (each model adds a different
+    //-- relation to the start), so it is dropped before anything is made
+    if (!candidates.insert(VarSet(manager->getVariableList()->getVarCount(), vars, varcount)).second)
+        return;
     Relation::sort(vars, varcount);
     Relation *rel = manager->getRelation(vars, varcount, true);
-    Model *newModel = new Model(start->getRelationCount() + 1);
-    newModel->copyRelations(*start);
-    newModel->addRelation(rel, true);
     ModelCache *cache = manager->getModelCache();
-    if (!cache->addModel(newModel)) {
-        //-- already exists in cache; return that one
-        Model *cachedModel = cache->findModel(newModel->getPrintName());
-        delete newModel;
-        newModel = cachedModel;
-        //-- since all models come from the cache, we can do pointer compares to see if
-        //-- this model is already in the list. The model might also be the current model
-        if (newModel == start)
-            newModel = NULL;
-        else if (((VBMManager *) manager)->applyFilter(newModel)) {
-            int i;
-            for (i = 0; i < parentListCount; i++) {
-                if (parentList[i] == newModel)
-                    break;
-            }
-            if (i >= parentListCount) {
-                parentList[parentListCount++] = newModel;
-            } else
-                newModel = NULL;
+    //-- look for the model in the cache before building it
+    Model *newModel = cache->findModelWith(start, rel);
+    if (newModel == NULL) {
+        newModel = new Model(start->getRelationCount() + 1);
+        newModel->copyRelations(*start);
+        newModel->addRelation(rel, true);
+        if (!cache->addModel(newModel)) {
+            //-- already exists in cache; return that one
+            Model *cachedModel = cache->findModel(newModel);
+            delete newModel;
+            newModel = cachedModel;
         }
-    } else if (((VBMManager *) manager)->applyFilter(newModel)) {
-        parentList[parentListCount++] = newModel;
     }
-    delete[] vars;
+    //-- the relation may be contained in one of the start model's, giving the start again
+    if (newModel != start && ((VBMManager *) manager)->applyFilter(newModel))
+        sink->accept(newModel);
 }
 
-Model **SearchFullUp::search(Model *start) {
+void SearchFullUp::generate(Model *start, CandidateSink &sink) {
     //-- moving upwards involves finding a candidate relation for insertion, and then
     //-- verifying that all its immediate subrelations are present in the model. This
     //-- must be done for all candidate relations.
     int relationCount = start->getRelationCount();
-
-    //-- allocate model storage. Since each relation in the model can be augmented with at
-    //-- most one variable, an upper bound on the number of parents is the number of variables
-    //-- times the number of relations in this model.
-    int parentListMax = relationCount * (start->getRelation(0)->getVariableList()->getVarCount() - 1);
-    parentList = new Model*[parentListMax];
-    memset(parentList, 0, parentListMax * sizeof(Model*));
-    parentListCount = 0;
+    this->sink = &sink;
+    candidates.clear();
 
     //-- The stack depth can be no more than the number of relations in the model. Allocate
     //-- the stack.
@@ -369,7 +353,7 @@ Model **SearchFullUp::search(Model *start) {
         }
     }
     delete[] stack;
-    return parentList;
+    this->sink = NULL;
 }
 
 void SearchSbFullUp::recurseDirected(Model *start, int cur_var, int cur_index, int *var_indices, int *state_indices,
@@ -384,7 +368,7 @@ void SearchSbFullUp::recurseDirected(Model *start, int cur_var, int cur_index, i
                     return;
             Model *model = new Model(start->getRelationCount() + 1);
             model->copyRelations(*start);
-            model->addRelation(new_relation, true, manager->getModelCache()); // may not need to normalize here, or if so, may need to check if it did anything
+            model->addRelation(new_relation, true); // may not need to normalize here, or if so, may need to check if it did anything
             if (model->getRelationCount() > start->getRelationCount()) {
                 addToCache(model, models_found, model_list);
             } else {
@@ -412,7 +396,7 @@ bool SearchSbFullUp::addToCache(Model *model, int &models_found, Model **model_l
     ModelCache* cache = manager->getModelCache();
     // put the model in the cache, or use the cached one if already there
     if (!cache->addModel(model)) {
-        Model *cached_model = cache->findModel(model->getPrintName());
+        Model *cached_model = cache->findModel(model);
         delete model;
         model = cached_model;
     }
@@ -526,7 +510,7 @@ Model** SearchSbFullUp::search(Model* start) {
  * This algorithm is simpler to implement and also eliminates consideration of the same
  * pair of variables more than once.
  */
-Model **SearchLooplessDown::search(Model *start) {
+void SearchLooplessDown::generate(Model *start, CandidateSink &sink) {
     VariableList *varList = manager->getVariableList();
     int varcount = varList->getVarCount();
     bool isDirected = varList->isDirected();
@@ -535,11 +519,11 @@ Model **SearchLooplessDown::search(Model *start) {
         int dvIndex = varList->getDV();
         // must have one relation with all vars; or one of IVs and one with DV plus some IVs
         if ((relCount > 2) || (relCount < 1))
-            return NULL;
+            return;
         Relation *rel, *ivRel;
         if (relCount == 1) {
             if (start != manager->getTopRefModel())
-                return NULL;
+                return;
             rel = start->getRelation(0);
             ivRel = manager->getChildRelation(rel, dvIndex);
         } else {
@@ -551,19 +535,15 @@ Model **SearchLooplessDown::search(Model *start) {
             }
         }
         if (rel->isIndependentOnly() || !ivRel->isIndependentOnly())
-            return NULL;
+            return;
         int activeIVs = rel->getVariableCount() - 1;
         if (activeIVs == 0)
-            return NULL;
+            return;
         int indices[activeIVs];
         if (rel->getIndependentVariables(indices, activeIVs) != activeIVs)
-            return NULL;
-        // allocate space for that many models
-        Model **models = new Model *[activeIVs + 1];
-        memset(models, 0, (activeIVs + 1) * sizeof(Model*));
+            return;
         Relation *newRel;
         Model *model;
-        int slot = 0;
         // for each IV
         for (int i = 0; i < activeIVs; i++) {
             // create a child relation minus that IV
@@ -575,24 +555,16 @@ Model **SearchLooplessDown::search(Model *start) {
             // put in cache, or use the cached one if already there
             ModelCache *cache = manager->getModelCache();
             if (!cache->addModel(model)) {
-                Model *cachedModel = cache->findModel(model->getPrintName());
+                Model *cachedModel = cache->findModel(model);
                 delete model;
                 model = cachedModel;
             }
             if (((VBMManager *) manager)->applyFilter(model))
-                models[slot++] = model;
+                sink.accept(model);
         }
-        return models;
     } else {
-        int maxChildren = varcount * (varcount - 1);
         int i, j;
-
-        //-- worst case - need a list with a slot for each pair of variables
-        //-- plus one for null termination of list
-        Model **models = new Model *[maxChildren + 1];
-        memset(models, 0, (maxChildren + 1) * sizeof(Model*));
         Model *model;
-        int slot = 0;
 
         //-- consider each pair of variables
         for (i = 0; i < varcount - 1; i++) {
@@ -624,16 +596,15 @@ Model **SearchLooplessDown::search(Model *start) {
                     //-- put in cache, or use the cached one if already there
                     ModelCache *cache = manager->getModelCache();
                     if (!cache->addModel(model)) {
-                        Model *cachedModel = cache->findModel(model->getPrintName());
+                        Model *cachedModel = cache->findModel(model);
                         delete model;
                         model = cachedModel;
                     }
                     if (((VBMManager *) manager)->applyFilter(model))
-                        models[slot++] = model;
+                        sink.accept(model);
                 }
             }
         }
-        return models;
     }
 }
 
@@ -646,7 +617,7 @@ void SearchSbLooplessUp::recurseDirected(int cur_var, int cur_index, int *var_in
             model->addRelation(manager->getIndRelation(), false);
             model->addRelation(manager->getDepRelation(), false);
             Relation *new_relation = manager->getRelation(var_indices, cur_index, true, state_indices);
-            model->addRelation(new_relation, true, manager->getModelCache());
+            model->addRelation(new_relation, true);
             addToCache(model, models_found, model_list);
         }
         return;
@@ -670,7 +641,7 @@ bool SearchSbLooplessUp::addToCache(Model *model, int &models_found, Model **mod
     Model* cached_model = NULL;
     // put the model in the cache, or use the cached one if already there
     if (!cache->addModel(model)) {
-        Model *cached_model = cache->findModel(model->getPrintName());
+        Model *cached_model = cache->findModel(model);
         delete model;
         model = cached_model;
     }
@@ -801,7 +772,7 @@ Model **SearchSbLooplessUp::search(Model *start) {
                     model = new Model(3);
                     model->addRelation(manager->getIndRelation(), false);
                     model->addRelation(manager->getDepRelation(), false);
-                    model->addRelation(new_relation, false, manager->getModelCache());
+                    model->addRelation(new_relation, false);
                     addToCache(model, models_found, model_list);
                     state_indices[i] = old_value;
                 }
@@ -823,7 +794,7 @@ Model **SearchSbLooplessUp::search(Model *start) {
                 model = new Model(3);
                 model->addRelation(manager->getIndRelation(), false);
                 model->addRelation(manager->getDepRelation(), false);
-                model->addRelation(new_relation, false, manager->getModelCache());
+                model->addRelation(new_relation, false);
                 addToCache(model, models_found, model_list);
             }
             // If the relation has all of the variables possible, and no new relations are found, then
@@ -862,92 +833,84 @@ Model **SearchSbLooplessUp::search(Model *start) {
  * new models will still have a single predictive component, and all possible
  * parents will be created.
  */
-Model **SearchLooplessUp::search(Model *start) {
+void SearchLooplessUp::generate(Model *start, CandidateSink &sink) {
     VariableList *varList = manager->getVariableList();
     int varcount = varList->getVarCount();
     int relcount = start->getRelationCount();
-    int maxChildren = varcount * (relcount - 1);
     int i, r;
     int indOnlyRel = -1;
 
+    //-- the new relations below are tested only where they touch the start model,
+    //-- which is sound because the start model is checked here, once
     if (manager->hasLoops(start)) {
         printf("SearchLooplessUp: Error. Cannot complete a loopless search starting from a model with a loop.\n");
         exit(1);
-        return NULL;
+        return;
     }
     // Neutral loopless up
+    //-- each new relation joins a pair of variables which aren't yet in a relation
+    //-- together, along with the variables shared by a relation containing each of
+    //-- them. The relations are indexed by variable, and each distinct new relation
+    //-- is checked for loops before any model (or the relation itself) is made.
     if (!varList->isDirected()) {
-        maxChildren = 4;
-        Model **models = new Model *[maxChildren];
         Model *model, *cachedModel;
-        memset(models, 0, maxChildren * sizeof(Model*));
-        int modelsFound = 0;
-        int *pair = new int[2];
         int *newRelVars = new int[varcount+1];
-        int newRelVarCount = 0;
-        Relation *pairRel, *newRel;
-        bool found;
+        int newRelVarCount;
+        Relation *newRel;
+        std::vector<VarSet> relVars;
+        std::vector<std::vector<int> > relsWith(varcount);
+        for (int m = 0; m < relcount; m++) {
+            Relation *rel = start->getRelation(m);
+            relVars.push_back(VarSet(varcount));
+            for (int k = 0; k < rel->getVariableCount(); k++) {
+                relVars[m].add(rel->getVariable(k));
+                relsWith[rel->getVariable(k)].push_back(m);
+            }
+        }
+        std::unordered_set<VarSet, VarSetHash> produced;
         for (int i = 0; i < varcount; i++) {
             for (int j = i+1; j < varcount; j++) {
-                pair[0] = i;
-                pair[1] = j;
-                pairRel = manager->getRelation(pair, 2, false);
-                if (start->containsRelation(pairRel))
+                bool joined = false;
+                for (size_t m = 0; m < relsWith[i].size() && !joined; m++)
+                    joined = relVars[relsWith[i][m]].has(j);
+                if (joined)
                     continue;
-                for (int m = 0; m < relcount; m++) {
-                    if (start->getRelation(m)->findVariable(i) != -1) {
-                        for (int n = 0; n < relcount; n++) {
-                            if (start->getRelation(n)->findVariable(j) != -1) {
-                                newRelVarCount = 2;
-                                newRelVars[0] = i;
-                                newRelVars[1] = j;
-                                for (int k = 0; k < start->getRelation(m)->getVariableCount(); k++) {
-                                    if (start->getRelation(n)->findVariable(start->getRelation(m)->getVariable(k)) != -1) {
-                                        newRelVars[newRelVarCount] = start->getRelation(m)->getVariable(k);
-                                        newRelVarCount++;
-                                    }
-                                }
-                                model = new Model(relcount+1);
-                                model->copyRelations(*start);
-                                newRel = manager->getRelation(newRelVars, newRelVarCount, true);
-                                model->addRelation(newRel, true);
-                                // put the model in the cache, or use the cached one if already there
-                                ModelCache *cache = manager->getModelCache();
-                                if (!cache->addModel(model)) {
-                                    cachedModel = cache->findModel(model->getPrintName());
-                                    delete model;
-                                    model = cachedModel;
-                                }
-                                if (manager->hasLoops(model))
-                                    continue;
-                                // check if this model is in the return list, so we don't add a duplicate
-                                found = false;
-                                for (int l = 0; l < modelsFound; l++) {
-                                    if (models[l] == model) {
-                                        found = true;
-                                        break;
-                                    }
-                                }
-                                if (!found) {
-                                    if (((VBMManager *) manager)->applyFilter(model)) {
-                                        if (modelsFound >= maxChildren - 1) {
-                                            const int GROWTH_FACTOR = 2;
-                                            while (modelsFound >= maxChildren - 1) {
-                                                models = (Model**) growStorage(models, maxChildren*sizeof(Model*), GROWTH_FACTOR);
-                                                maxChildren *= GROWTH_FACTOR;
-                                            }
-                                        }
-                                        models[modelsFound++] = model;
-                                    }
-                                }
+                for (size_t m = 0; m < relsWith[i].size(); m++) {
+                    for (size_t n = 0; n < relsWith[j].size(); n++) {
+                        VarSet newVars(relVars[relsWith[i][m]]);
+                        newVars &= relVars[relsWith[j][n]];
+                        newVars.add(i);
+                        newVars.add(j);
+                        //-- a relation already produced gives the same model again
+                        if (!produced.insert(newVars).second)
+                            continue;
+                        if (manager->hasLoopsWith(start, newVars))
+                            continue;
+                        newRelVarCount = newVars.copyVariables(newRelVars);
+                        newRel = manager->getRelation(newRelVars, newRelVarCount, true);
+                        // use the cached model if there is one, rather than building it
+                        ModelCache *cache = manager->getModelCache();
+                        model = cache->findModelWith(start, newRel);
+                        if (model == NULL) {
+                            model = new Model(relcount+1);
+                            model->copyRelations(*start);
+                            model->addRelation(newRel, true);
+                            // put the model in the cache, or use the cached one if already there
+                            if (!cache->addModel(model)) {
+                                cachedModel = cache->findModel(model);
+                                delete model;
+                                model = cachedModel;
                             }
                         }
+                        model->setAttribute(ATTRIBUTE_LOOPS, 0);
+                        if (((VBMManager *) manager)->applyFilter(model))
+                            sink.accept(model);
                     }
                 }
             }
         }
-        delete[] pair; delete[] newRelVars;
-        return models;
+        delete[] newRelVars;
+        return;
     }
 
     //-- determine which relation is the one containing only independent variables.
@@ -959,13 +922,10 @@ Model **SearchLooplessUp::search(Model *start) {
         }
     }
     if (indOnlyRel == -1) { // no independent-only relation; malformed model for this algorithm
-        return NULL;
+        return;
     }
 
-    Model **models = new Model *[maxChildren + 1];
     Model *model;
-    int slot = 0;
-    memset(models, 0, (maxChildren + 1) * sizeof(Model*));
 
     //-- for each variable, see if we can add it to each relation (other than the indonly one)
     for (i = 0; i < varcount; i++) {
@@ -974,29 +934,31 @@ Model **SearchLooplessUp::search(Model *start) {
                 continue;
             Relation *rel = start->getRelation(r);
             if (-1 == rel->findVariable(i)) {
-                model = new Model(relcount + 1);
-                model->copyRelations(*start, r);
                 int relvarcount = rel->getVariableCount();
                 int *relvars = new int[relvarcount + 1];
                 rel->copyVariables(relvars, relvarcount);
                 relvars[relvarcount++] = i;
                 Relation *newRelation = manager->getRelation(relvars, relvarcount, true);
-                model->addRelation(newRelation);
-                //-- put in cache, or use the cached one if already there
+                //-- use the cached model if there is one, rather than building it
                 ModelCache *cache = manager->getModelCache();
-                if (!cache->addModel(model)) {
-                    Model *cachedModel = cache->findModel(model->getPrintName());
-                    delete model;
-                    model = cachedModel;
-                }
-                if (((VBMManager *) manager)->applyFilter(model)) {
-                    models[slot++] = model;
+                model = cache->findModelWith(start, newRelation, r);
+                if (model == NULL) {
+                    model = new Model(relcount + 1);
+                    model->copyRelations(*start, r);
+                    model->addRelation(newRelation);
+                    //-- put in cache, or use the cached one if already there
+                    if (!cache->addModel(model)) {
+                        Model *cachedModel = cache->findModel(model);
+                        delete model;
+                        model = cachedModel;
+                    }
                 }
+                if (((VBMManager *) manager)->applyFilter(model))
+                    sink.accept(model);
                 delete relvars;
             }
         }
     }
-    return models;
 }
 
 //----- Bottom-up disjoint search -----
@@ -1080,7 +1042,7 @@ Model **SearchDisjointUp::search(Model *start) {
                 //-- put in cache, or use the cached one if already there
                 ModelCache *cache = manager->getModelCache();
                 if (!cache->addModel(model)) {
-                    Model *cachedModel = cache->findModel(model->getPrintName());
+                    Model *cachedModel = cache->findModel(model);
                     delete model;
                     model = cachedModel;
                 }
@@ -1116,7 +1078,7 @@ Model **SearchDisjointUp::search(Model *start) {
             //-- put in cache, or use the cached one if already there
             ModelCache *cache = manager->getModelCache();
             if (!cache->addModel(model)) {
-                Model *cachedModel = cache->findModel(model->getPrintName());
+                Model *cachedModel = cache->findModel(model);
                 delete model;
                 model = cachedModel;
             }
@@ -1199,7 +1161,7 @@ bool SearchChain::makeChainModels() {
             oldBrk = (char*) sbrk(0);
         double used = ((char*) sbrk(0)) - oldBrk;
         if (!cache->addModel(model)) {
-            Model *cachedModel = cache->findModel(model->getPrintName());
+            Model *cachedModel = cache->findModel(model);
             delete model;
             model = cachedModel;
         }
@@ -1327,7 +1289,7 @@ Model **SearchDisjointDown::search(Model *start) {
          // put in cache, or use the cached one if already there
          ModelCache *cache = manager->getModelCache();
          if (!cache->addModel(model)) {
-         Model *cachedModel = cache->findModel(model->getPrintName());
+         Model *cachedModel = cache->findModel(model);
          delete model;
          model = cachedModel;
          }
@@ -1367,7 +1329,7 @@ Model **SearchDisjointDown::search(Model *start) {
                     // add the model if it is not in the cache
                     ModelCache *cache = manager->getModelCache();
                     if (!cache->addModel(m)) {
-                        Model *cachedModel = cache->findModel(m->getPrintName());
+                        Model *cachedModel = cache->findModel(m);
                         delete m;
                         m = cachedModel;
                     }
@@ -1411,7 +1373,7 @@ Model **SearchDisjointDown::search(Model *start) {
                             ModelCache *cache = manager->getModelCache();
                             if (!cache->addModel(m1)) {
 
-                                Model *cachedModel = cache->findModel(m1->getPrintName());
+                                Model *cachedModel = cache->findModel(m1);
                                 delete m1;
                                 m1 = cachedModel;
                             }
@@ -10,6 +10,7 @@
 #include <math.h>
 #include "SearchBase.h"
 #include "Search.h"
+#include <vector>
 
 struct SearchType {
     const char *name;
@@ -45,6 +46,33 @@ Model **SearchBase::search(Model *start)
 }
 
 
+void SearchBase::generate(Model *start, CandidateSink &sink)
+{
+    Model **models = search(start);
+    if (models == NULL)
+        return;
+    for (Model **model = models; *model; model++)
+        sink.accept(*model);
+    delete[] models;
+}
+
+
+//-- collect - the list returned by search(), for a search which overrides generate()
+Model **SearchBase::collect(Model *start)
+{
+    struct ListSink : public CandidateSink {
+        std::vector<Model*> models;
+        void accept(Model *model) { models.push_back(model); }
+    } sink;
+    generate(start, sink);
+    Model **models = new Model *[sink.models.size() + 1];
+    for (size_t i = 0; i < sink.models.size(); i++)
+        models[i] = sink.models[i];
+    models[sink.models.size()] = NULL;
+    return models;
+}
+
+
 SearchBase* SearchFactory::getSearchMethod(ManagerBase *mgr, const char *name, bool proj)
 {
     SearchBase *search = NULL;
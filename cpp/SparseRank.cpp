@@ -0,0 +1,389 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "SparseRank.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+SparseRank::SparseRank(long long columnCount, long long minDenseBytes) :
+        dense(false), columnCount(columnCount), minDenseBytes(minDenseBytes), heldBytes(0), peakBytes(0),
+        rank(0), markPoint(0) {
+    mpz_init_set_ui(one, 1);
+}
+
+SparseRank::~SparseRank() {
+    for (size_t i = 0; i < added.size(); i++) {
+        if (dense)
+            delete[] denseRows[added[i]];
+        else
+            deleteRow(pivots[added[i]]);
+    }
+    mpz_clear(one);
+}
+
+//-- Cursor - steps through the nonzero columns of a row, in increasing order. The
+//-- digits of a pattern are counted through like an odometer, least significant first.
+class SparseRank::Cursor {
+    public:
+        Cursor(Row *row, mpz_srcptr one) :
+                row(row), one(one), index(0), col(0), digits(NULL) {
+            if (row->cols == NULL) {
+                digits = new int[row->digitCount > 0 ? row->digitCount : 1];
+                memset(digits, 0, (row->digitCount > 0 ? row->digitCount : 1) * sizeof(int));
+                col = row->base;
+            } else if (row->count > 0) {
+                col = row->cols[0];
+            }
+        }
+        ~Cursor() {
+            delete[] digits;
+        }
+        bool done() {
+            return index >= row->count;
+        }
+        long long column() {
+            return col;
+        }
+        mpz_srcptr value() {
+            return row->values ? row->values[index] : one;
+        }
+        void next() {
+            if (++index >= row->count)
+                return;
+            if (row->cols) {
+                col = row->cols[index];
+                return;
+            }
+            for (int d = 0; d < row->digitCount; d++) {
+                if (++digits[d] < row->sizes[d]) {
+                    col += row->strides[d];
+                    return;
+                }
+                col -= (long long) (digits[d] - 1) * row->strides[d];
+                digits[d] = 0;
+            }
+        }
+
+    private:
+        Row *row;
+        mpz_srcptr one;
+        long long index;
+        long long col;
+        int *digits;
+};
+
+//-- makeRow - a row with room for count listed columns, and their values if asked
+SparseRank::Row *SparseRank::makeRow(long long count, bool withValues) {
+    Row *row = new Row;
+    row->count = count;
+    row->cols = new long long[count > 0 ? count : 1];
+    row->values = NULL;
+    if (withValues) {
+        row->values = new mpz_t[count > 0 ? count : 1];
+        for (long long i = 0; i < count; i++)
+            mpz_init(row->values[i]);
+    }
+    row->base = 0;
+    row->digitCount = 0;
+    row->strides = NULL;
+    row->sizes = NULL;
+    return row;
+}
+
+//-- deleteRow - the first count values of a row are the initialized ones.
+void SparseRank::deleteRow(Row *row) {
+    if (row->values) {
+        for (long long i = 0; i < row->count; i++)
+            mpz_clear(row->values[i]);
+        delete[] row->values;
+    }
+    delete[] row->cols;
+    delete[] row->strides;
+    delete[] row->sizes;
+    delete row;
+}
+
+//-- rowBytes - the memory taken by a row, leaving out the limbs of its values
+long long SparseRank::rowBytes(Row *row) {
+    if (row->cols == NULL)
+        return sizeof(Row) + row->digitCount * (sizeof(long long) + sizeof(int));
+    return sizeof(Row) + row->count * (sizeof(long long) + (row->values ? sizeof(mpz_t) : 0));
+}
+
+//-- denseLimit - the memory the rows may take before they are made dense: that of
+//-- a dense matrix of the rows, with one more for the row being added
+long long SparseRank::denseLimit() {
+    long long denseBytes = (rank + 1) * columnCount * (long long) sizeof(double);
+    return denseBytes > minDenseBytes ? denseBytes : minDenseBytes;
+}
+
+void SparseRank::noteBytes(long long bytes) {
+    if (bytes > peakBytes)
+        peakBytes = bytes;
+}
+
+long long SparseRank::leadingColumn(Row *row) {
+    return row->cols ? row->cols[0] : row->base;
+}
+
+bool SparseRank::addUnitRow(const long long *cols, long long count) {
+    if (count <= 0)
+        return false;
+    Row *row = makeRow(count, false);
+    memcpy(row->cols, cols, count * sizeof(long long));
+    return addRow(row);
+}
+
+bool SparseRank::addPatternRow(long long base, int digitCount, const long long *strides, const int *sizes) {
+    Row *row = new Row;
+    row->count = 1;
+    row->cols = NULL;
+    row->values = NULL;
+    row->base = base;
+    row->digitCount = digitCount;
+    row->strides = new long long[digitCount > 0 ? digitCount : 1];
+    row->sizes = new int[digitCount > 0 ? digitCount : 1];
+    for (int d = 0; d < digitCount; d++) {
+        row->strides[d] = strides[d];
+        row->sizes[d] = sizes[d];
+        row->count *= sizes[d];
+    }
+    if (row->count <= 0) {
+        deleteRow(row);
+        return false;
+    }
+    return addRow(row);
+}
+
+//-- addRow - reduce the leading entry of a new row until it is in a column with no
+//-- pivot row, and keep it there; or delete it, if nothing is left.
+bool SparseRank::addRow(Row *row) {
+    if (dense)
+        return addDenseRow(row);
+    std::unordered_map<long long, Row*>::iterator pivot;
+    while (row->count > 0 && (pivot = pivots.find(leadingColumn(row))) != pivots.end()) {
+        if (row->cols && pivot->second->count == 1) {
+            dropUnitColumns(row);
+            if (row->count > 0)
+                normalize(row);
+            continue;
+        }
+        //-- the reduced row can have the columns of both
+        long long bytes = heldBytes + rowBytes(row) + sizeof(Row)
+                + (row->count + pivot->second->count) * (sizeof(long long) + sizeof(mpz_t));
+        if (bytes > denseLimit()) {
+            makeDense();
+            return addDenseRow(row);
+        }
+        noteBytes(bytes);
+        Row *next = eliminate(row, pivot->second);
+        deleteRow(row);
+        row = next;
+        if (row->count > 0)
+            normalize(row);
+    }
+    if (row->count == 0) {
+        deleteRow(row);
+        return false;
+    }
+    pivots[leadingColumn(row)] = row;
+    added.push_back(leadingColumn(row));
+    rank++;
+    heldBytes += rowBytes(row);
+    noteBytes(heldBytes);
+    return true;
+}
+
+//-- dropUnitColumns - take the leading columns out of a listed row, for as long as
+//-- each is the only column of its pivot row. Eliminating such a pivot (whose value
+//-- is 1, once normalized) just drops the column, so a run of them is dropped with
+//-- one copy of the row, rather than one for each; the rows of a saturated model
+//-- are all like this.
+void SparseRank::dropUnitColumns(Row *row) {
+    long long k = 0;
+    std::unordered_map<long long, Row*>::iterator pivot;
+    while (k < row->count && (pivot = pivots.find(row->cols[k])) != pivots.end() && pivot->second->count == 1)
+        k++;
+    if (row->values) {
+        for (long long i = 0; i < k; i++)
+            mpz_clear(row->values[i]);
+        memmove(row->values, row->values + k, (row->count - k) * sizeof(mpz_t));
+    }
+    memmove(row->cols, row->cols + k, (row->count - k) * sizeof(long long));
+    row->count -= k;
+}
+
+//-- eliminate - return (p * row - r * pivot) / g, where p and r are the leading
+//-- values of pivot and row, and g is their gcd. Both rows have the same leading
+//-- column, which cancels.
+SparseRank::Row *SparseRank::eliminate(Row *row, Row *pivot) {
+    Cursor r(row, one), p(pivot, one);
+    mpz_t g, a, b, term;
+    mpz_inits(g, a, b, term, NULL);
+    mpz_gcd(g, r.value(), p.value());
+    mpz_divexact(a, p.value(), g);
+    mpz_divexact(b, r.value(), g);
+    r.next();
+    p.next();
+
+    long long size = row->count + pivot->count - 2;
+    Row *result = makeRow(size, true);
+    long long k = 0;
+    while (!r.done() || !p.done()) {
+        long long col;
+        if (p.done() || (!r.done() && r.column() < p.column())) {
+            col = r.column();
+            mpz_mul(term, a, r.value());
+            r.next();
+        } else if (r.done() || p.column() < r.column()) {
+            col = p.column();
+            mpz_mul(term, b, p.value());
+            mpz_neg(term, term);
+            p.next();
+        } else {
+            col = r.column();
+            mpz_mul(term, a, r.value());
+            mpz_submul(term, b, p.value());
+            r.next();
+            p.next();
+        }
+        if (mpz_sgn(term) != 0) {
+            result->cols[k] = col;
+            mpz_swap(result->values[k], term);
+            k++;
+        }
+    }
+    //-- release the unused tail, so that count covers all initialized values, and
+    //-- move what is left into arrays of its size
+    for (long long unused = k; unused < size; unused++)
+        mpz_clear(result->values[unused]);
+    if (k < size) {
+        long long *cols = new long long[k > 0 ? k : 1];
+        mpz_t *values = new mpz_t[k > 0 ? k : 1];
+        memcpy(cols, result->cols, k * sizeof(long long));
+        memcpy(values, result->values, k * sizeof(mpz_t));
+        delete[] result->cols;
+        delete[] result->values;
+        result->cols = cols;
+        result->values = values;
+    }
+    result->count = k;
+    mpz_clears(g, a, b, term, NULL);
+    return result;
+}
+
+//-- normalize - divide a row by the gcd of its values, with the leading value
+//-- positive. This keeps the values of the echelon rows small. A row whose values
+//-- are then all 1 is kept as a bare list of columns.
+void SparseRank::normalize(Row *row) {
+    if (row->values == NULL)
+        return;
+    mpz_t g;
+    mpz_init(g);
+    for (long long i = 0; i < row->count && mpz_cmp_ui(g, 1) != 0; i++)
+        mpz_gcd(g, g, row->values[i]);
+    if (mpz_sgn(row->values[0]) < 0)
+        mpz_neg(g, g);
+    if (mpz_cmp_ui(g, 1) != 0) {
+        for (long long i = 0; i < row->count; i++)
+            mpz_divexact(row->values[i], row->values[i], g);
+    }
+    mpz_clear(g);
+    for (long long i = 0; i < row->count; i++) {
+        if (mpz_cmp_ui(row->values[i], 1) != 0)
+            return;
+    }
+    for (long long i = 0; i < row->count; i++)
+        mpz_clear(row->values[i]);
+    delete[] row->values;
+    row->values = NULL;
+}
+
+//-- expand - a dense copy of a row
+double *SparseRank::expand(Row *row) {
+    double *values = new double[columnCount];
+    memset(values, 0, columnCount * sizeof(double));
+    for (Cursor c(row, one); !c.done(); c.next())
+        values[c.column()] = mpz_get_d(c.value());
+    return values;
+}
+
+//-- makeDense - replace the echelon rows with dense ones, scaled so that their
+//-- leading values are 1
+void SparseRank::makeDense() {
+    long long denseBytes = columnCount * sizeof(double);
+    for (size_t i = 0; i < added.size(); i++) {
+        Row *row = pivots[added[i]];
+        double *values = expand(row);
+        double lead = values[added[i]];
+        for (long long j = added[i]; j < columnCount; j++)
+            values[j] /= lead;
+        denseRows[added[i]] = values;
+        heldBytes += denseBytes;
+        noteBytes(heldBytes);
+        heldBytes -= rowBytes(row);
+        deleteRow(row);
+    }
+    pivots.clear();
+    dense = true;
+}
+
+//-- addDenseRow - reduce a row against the dense echelon rows, in order of their
+//-- leading columns, and keep what is left, if anything is. As with the structure
+//-- matrix of old, values of DBL_EPSILON or less are taken as zero.
+bool SparseRank::addDenseRow(Row *row) {
+    double *values = expand(row);
+    deleteRow(row);
+    long long denseBytes = columnCount * sizeof(double);
+    noteBytes(heldBytes + denseBytes);
+    for (std::map<long long, double*>::iterator it = denseRows.begin(); it != denseRows.end(); ++it) {
+        long long lead = it->first;
+        double factor = values[lead];
+        if (fabs(factor) <= DBL_EPSILON)
+            continue;
+        double *pivot = it->second;
+        for (long long j = lead + 1; j < columnCount; j++)
+            values[j] -= factor * pivot[j];
+        values[lead] = 0.0;
+    }
+    long long lead = 0;
+    while (lead < columnCount && fabs(values[lead]) <= DBL_EPSILON)
+        values[lead++] = 0.0;
+    if (lead == columnCount) {
+        delete[] values;
+        return false;
+    }
+    double scale = values[lead];
+    for (long long j = lead; j < columnCount; j++)
+        values[j] /= scale;
+    denseRows[lead] = values;
+    added.push_back(lead);
+    rank++;
+    heldBytes += denseBytes;
+    return true;
+}
+
+void SparseRank::mark() {
+    markPoint = added.size();
+}
+
+void SparseRank::rollback() {
+    while (added.size() > markPoint) {
+        if (dense) {
+            delete[] denseRows[added.back()];
+            denseRows.erase(added.back());
+            heldBytes -= columnCount * sizeof(double);
+        } else {
+            heldBytes -= rowBytes(pivots[added.back()]);
+            deleteRow(pivots[added.back()]);
+            pivots.erase(added.back());
+        }
+        added.pop_back();
+        rank--;
+    }
+}
@@ -13,9 +13,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 
 const long long GROWTH_FACTOR = 2;
 
+static std::atomic<unsigned long long> nextSerial(0);
+
 
 /*
  * Table - initialize the table. The given keysize and number of tuples are used
@@ -48,6 +51,7 @@ Table::Table(int keysz, long long maxTuples, TableType typ)
     type = typ;
     maxTupleCount = maxTuples;
     tupleCount = 0;
+    serial = 0;
     data = new char[TupleBytes * maxTuples];
     memset(data, 0, TupleBytes * maxTuples * sizeof(char));
 }
@@ -71,8 +75,9 @@ void Table::copy(const Table* from)
         data = growStorage(data, maxTupleCount*TupleBytes, GROWTH_FACTOR);
         maxTupleCount *= GROWTH_FACTOR;
     }
-    memcpy(data, from->data, TupleBytes * maxTupleCount);
+    memcpy(data, from->data, TupleBytes * from->tupleCount);
     tupleCount = from->tupleCount;
+    serial = 0;
 }
 
 
@@ -92,6 +97,7 @@ void Table::addTuple(KeySegment *key, double value)
     if (type == TableType::SetTheoretic && value != 0.0) value = 1.0;
     *(ValuePtr(data, keysize, tupleCount)) = (ocTupleValue) value;		// copy value
     tupleCount++;
+    serial = 0;
 }
 
 
@@ -118,6 +124,7 @@ void Table::insertTuple(KeySegment *key, double value, long long index)
     if (type == TableType::SetTheoretic && value != 0.0) value = 1.0;
     *(ValuePtr(data, keysize, index)) = (ocTupleValue) value;						// copy value
     tupleCount++;
+    serial = 0;
 }
 
 
@@ -227,7 +234,7 @@ long long Table::indexOf(KeySegment *key, bool matchOnly)
  * the Unix QuickSort function qsort. We need a little adaptor function for the
  * comparator, because compareKeys isn't quite right
  */
-static int sortKeySize;	// must be set before calling sortCompare
+static thread_local int sortKeySize;	// must be set before calling sortCompare
 static int sortCompare(const void *k1, const void *k2)
 {
     return Key::compareKeys((KeySegment *)k1, (KeySegment *)k2, sortKeySize);
@@ -238,6 +245,7 @@ void Table::sort()
 {
     sortKeySize = keysize;
     qsort(data, tupleCount, TupleBytes, sortCompare);
+    serial = 0;
 }
 
 
@@ -284,6 +292,35 @@ double Table::getLowestValue()
 }
 
 
+long long Table::getTupleBytes()
+{
+    return TupleBytes;
+}
+
+
+void Table::setTuples(const void *tuples, long long count)
+{
+    while (count > maxTupleCount) {
+        data = growStorage(data, maxTupleCount*TupleBytes, GROWTH_FACTOR);
+        maxTupleCount *= GROWTH_FACTOR;
+    }
+    memcpy(data, tuples, TupleBytes * count);
+    tupleCount = count;
+    serial = 0;
+}
+
+
+/**
+ * getSerial - return the table's serial number, taking a new one if the keys
+ * have changed since it was last asked for
+ */
+unsigned long long Table::getSerial()
+{
+    if (serial == 0) serial = ++nextSerial;
+    return serial;
+}
+
+
 /**
  * reset - reset table to empty
  */
@@ -291,6 +328,7 @@ void Table::reset(int keysize)
 {
     this->tupleCount = 0;
     this->keysize = keysize;
+    serial = 0;
 }
 
 
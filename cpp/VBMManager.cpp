@@ -7,6 +7,7 @@
 
 #include <new>
 #include "AttributeList.h"
+#include "DiskCache.h"
 #include "Math.h"
 #include "ModelCache.h"
 #include "RelCache.h"
@@ -82,6 +83,7 @@ bool VBMManager::initFromCommandLine(int argc, char **argv) {
             top->addVariable(i); // all vars in saturated model
         getRelCache()->addRelation(top);
         top->setTable(inputData);
+        openDiskCache("vb");
         makeReferenceModels(top);
     }
     return true;
@@ -122,8 +124,7 @@ Model *VBMManager::makeChildModel(Model *model, int remove, bool *fromCache, boo
     }
     //-- return one from cache if possible
     if (!modelCache->addModel(newModel)) {
-        const char *name = newModel->getPrintName();
-        Model *cacheModel = modelCache->findModel(name);
+        Model *cacheModel = modelCache->findModel(newModel);
         delete newModel;
         newModel = cacheModel;
         if (fromCache)
@@ -191,6 +192,7 @@ void VBMManager::makeReferenceModels(Relation *top) {
     //-- set default reference model depending on whether
     //-- the system is directed or neutral
     refModel = varList->isDirected() ? bottomRef : bottomRef;
+    pinProjections(bottomRef);
     delete[] varindices;
 }
 
@@ -201,17 +203,19 @@ Model *VBMManager::setRefModel(const char *name) {
         refModel = bottomRef;
     } else {
         refModel = makeModel(name, true);
+        if (refModel)
+            pinProjections(refModel);
     }
     return refModel;
 }
 
-double VBMManager::computeExplainedInformation(Model *model) {
+double VBMManager::computeExplainedInformation(Model *model, FitContext *context) {
     double info = model->getAttribute(ATTRIBUTE_EXPLAINED_I);
     if (info >= 0)
         return info;
     double topH = topRef->getAttribute(ATTRIBUTE_H);
     double botH = bottomRef->getAttribute(ATTRIBUTE_H);
-    double modelT = computeTransmission(model);
+    double modelT = computeTransmission(model, AUTO, 0, context);
     info = (botH - topH - modelT) / (botH - topH);
     // info is normalized but may not quite be between zero and 1 due to roundoff. Fix this here.
     if (info <= 0.0)
@@ -222,13 +226,13 @@ double VBMManager::computeExplainedInformation(Model *model) {
     return info;
 }
 
-double VBMManager::computeUnexplainedInformation(Model *model) {
+double VBMManager::computeUnexplainedInformation(Model *model, FitContext *context) {
     double info = model->getAttribute(ATTRIBUTE_UNEXPLAINED_I);
     if (info >= 0)
         return info;
     double topH = topRef->getAttribute(ATTRIBUTE_H);
     double botH = bottomRef->getAttribute(ATTRIBUTE_H);
-    double modelT = computeTransmission(model);
+    double modelT = computeTransmission(model, AUTO, 0, context);
     info = modelT / (botH - topH);
     // info is normalized but may not quite be between zero and 1 due to
     // roundoff. Fix this here.
@@ -404,23 +408,23 @@ void VBMManager::computeDFStatistics(Model *model) {
     computeDDF(model);
 }
 
-void VBMManager::computeInformationStatistics(Model *model) {
-    computeH(model);
-    computeTransmission(model);
-    computeExplainedInformation(model);
-    computeUnexplainedInformation(model);
+void VBMManager::computeInformationStatistics(Model *model, FitContext *context) {
+    computeH(model, AUTO, 0, context);
+    computeTransmission(model, AUTO, 0, context);
+    computeExplainedInformation(model, context);
+    computeUnexplainedInformation(model, context);
 }
 
-void VBMManager::calculateBP_AicBic(Model *model) {
+void VBMManager::calculateBP_AicBic(Model *model, FitContext *context) {
     double sampleSize = getSampleSz();
-    double deltaH_Aic = computeH(model);
+    double deltaH_Aic = computeH(model, AUTO, 0, context);
     deltaH_Aic *= log(2.0); // convert h to ln rather than log base 2 again
     double deltaH_Bic = deltaH_Aic;
     double modelDF = computeDF(model); // get DF of the model
 
     // delta - AIC & BIC
     if (firstCome) {
-        double reDeltaH_Aic = computeH(refModel);
+        double reDeltaH_Aic = computeH(refModel, AUTO, 0, context);
         double refDF = computeDF(refModel); // get DF of the ref model
         reDeltaH_Aic *= log(2.0);
         firstCome = false;
@@ -436,14 +440,14 @@ void VBMManager::calculateBP_AicBic(Model *model) {
     model->setAttribute(ATTRIBUTE_BP_BIC, deltaH_Bic);
 }
 
-void VBMManager::computeL2Statistics(Model *model) {
+void VBMManager::computeL2Statistics(Model *model, FitContext *context) {
     try {
         //-- make sure the other attributes are there
-        computeInformationStatistics(model);
+        computeInformationStatistics(model, context);
         //-- compute chi-squared statistics and related statistics. L2 = 2*n*sum(p(ln p/q)) = 2*n*ln(2)*T
         // L2 (or dLR) is computed to always be positive
         // The values that depend on it (BIC and AIC) have their signs corrected below
-        double refL2 = computeLR(model);
+        double refL2 = computeLR(model, context);
         double refDDF = computeDDF(model);
 
         double refL2Prob = model->getAttribute(ATTRIBUTE_ALPHA);
@@ -490,17 +494,46 @@ void VBMManager::computeL2Statistics(Model *model) {
     }
 }
 
+//-- the bounds are loosened by this fraction of H(bottom) - H(top), as fitted H
+//-- values are only as close as IPF converges
+#define SORT_BOUND_MARGIN 1e-6
+
+bool VBMManager::computeSortBound(Model *model, const char *attr, double *bound) {
+    bool info = strcmp(attr, "information") == 0;
+    bool aic = strcmp(attr, "aic") == 0;
+    if (!info && !aic && strcmp(attr, "bic") != 0)
+        return false;
+    if (!info && refModel != bottomRef && refModel != topRef)
+        return false;
+    if (model->isStateBased() || !hasLoops(model))
+        return false;
+    double topH = topRef->getAttribute(ATTRIBUTE_H);
+    double botH = bottomRef->getAttribute(ATTRIBUTE_H);
+    double t = computeHLowerBound(model) - inputH - SORT_BOUND_MARGIN * (botH - topH);
+    if (info) {
+        double value = (botH - topH - t) / (botH - topH);
+        *bound = value < 0.0 ? 0.0 : value > 1.0 ? 1.0 : value;
+        return true;
+    }
+    //-- as in computeL2Statistics; dAIC and dBIC are negated when the top is the reference
+    double refT = computeTransmission(refModel);
+    double penalty = (aic ? 2.0 : log(sampleSize)) * computeDDF(model);
+    if (refModel == bottomRef)
+        *bound = 2.0 * M_LN2 * sampleSize * (refT - t) - penalty;
+    else
+        *bound = penalty - 2.0 * M_LN2 * sampleSize * (t > refT ? t - refT : 0.0);
+    return true;
+}
+
 void VBMManager::computePearsonStatistics(Model *model) {
     //-- these statistics require a full contingency table, so make
     //-- sure one has been created.
     if (model == NULL || bottomRef == NULL)
         return;
-    makeFitTable(model);
-    Table *modelFitTable = new Table(keysize, fitTable1->getTupleCount());
-    modelFitTable->copy(fitTable1);
-    makeFitTable(bottomRef);
-    double modelP2 = ocPearsonChiSquared(inputData, modelFitTable, (long) round(sampleSize));
-    double refP2 = ocPearsonChiSquared(inputData, fitTable1, (long) round(sampleSize));
+    computeFitStatistics(model);
+    computeFitStatistics(bottomRef);
+    double modelP2 = model->getAttribute(ATTRIBUTE_FIT_P2);
+    double refP2 = bottomRef->getAttribute(ATTRIBUTE_FIT_P2);
 
     int errcode;
     double refDDF = computeDDF(model);
@@ -527,10 +560,9 @@ void VBMManager::computePearsonStatistics(Model *model) {
     model->setAttribute(ATTRIBUTE_P2, modelP2);
     model->setAttribute(ATTRIBUTE_P2_ALPHA, refP2Prob);
     model->setAttribute(ATTRIBUTE_P2_BETA, refP2Power);
-    delete modelFitTable;
 }
 
-void VBMManager::computeDependentStatistics(Model *model) {
+void VBMManager::computeDependentStatistics(Model *model, FitContext *context) {
     //-- the basic metric is the conditional uncertainty u(Z|ABC...), which is
     //-- u(model) - u(ABC...), where ABC... are the independent variables
     //-- first, compute the relation stats for the bottom reference model, which
@@ -540,17 +572,17 @@ void VBMManager::computeDependentStatistics(Model *model) {
     double depH = topRef->getRelation(0)->getAttribute(ATTRIBUTE_DEP_H);
     Relation *indRel = getIndRelation();
     double indH = indRel->getAttribute(ATTRIBUTE_H);
-    double refH = computeH(bottomRef);
+    double refH = computeH(bottomRef, AUTO, 0, context);
     //double refCondH = refH - indH;
 
-    double h = computeH(model);
+    double h = computeH(model, AUTO, 0, context);
     double condH = h - indH;
     model->setAttribute(ATTRIBUTE_COND_H, condH);
     model->setAttribute(ATTRIBUTE_COND_DH, refH - h);
     model->setAttribute(ATTRIBUTE_COND_PCT_DH, 100 * (refH - h) / depH);
 }
 
-double VBMManager::computeBPT(Model *model) {
+double VBMManager::computeBPT(Model *model, FitContext *context) {
     // this function computes transmission using the Fourier BP method.
     // Individual q values are computed as the mean value from each projection,
     // q(x) = sum (R(x)/|R|) - (nR - 1), where R(x) is the projected value
@@ -652,7 +684,9 @@ double VBMManager::computeBPT(Model *model) {
             int originTerms;
     };
 
-    static BPIntersectProcessor *processor = NULL;
+    if (context == NULL)
+        context = fitContext;
+    BPIntersectProcessor *processor = (BPIntersectProcessor *) context->bpProcessor;
 
     //-- see if we did this already.
     double modelT = model->getAttribute(ATTRIBUTE_BP_T);
@@ -672,15 +706,8 @@ double VBMManager::computeBPT(Model *model) {
     }
 
     if (processor == NULL)
-        processor = new BPIntersectProcessor(inputData, fullDimension);
+        context->bpProcessor = processor = new BPIntersectProcessor(inputData, fullDimension);
     processor->reset(relCount);
-    if (intersectArray != NULL) {
-        delete[] intersectArray;
-        intersectCount = 0;
-        intersectMax = model->getRelationCount();
-        ;
-        intersectArray = NULL;
-    }
 
     doIntersectionProcessing(model, processor);
     modelT = processor->getTransmission();
@@ -688,12 +715,12 @@ double VBMManager::computeBPT(Model *model) {
     return modelT;
 }
 
-void VBMManager::computeBPStatistics(Model *model) {
-    double modelT = computeBPT(model);
-    double topH = computeH(topRef);
+void VBMManager::computeBPStatistics(Model *model, FitContext *context) {
+    double modelT = computeBPT(model, context);
+    double topH = computeH(topRef, AUTO, 0, context);
     //-- we need both BP and standard T for the bottom model
-    double botBPT = computeBPT(bottomRef);
-    double botStdT = computeTransmission(bottomRef);
+    double botBPT = computeBPT(bottomRef, context);
+    double botStdT = computeTransmission(bottomRef, AUTO, 0, context);
     //-- estimate H by scaling the standard T of the bottom model, proportionately
     //-- with the BP_T of the model and the bottom model
     double modelH = topH + modelT * botStdT / botBPT;
@@ -716,7 +743,7 @@ void VBMManager::computeBPStatistics(Model *model) {
     //-- which is 2*n*ln(2)*T
     int errcode;
     double modelL2 = 2.0 * M_LN2 * sampleSize * modelT;
-    double refT = computeBPT(refModel);
+    double refT = computeBPT(refModel, context);
     double refL2 = 2.0 * M_LN2 * sampleSize * refT;
     double refModelL2 = refL2 - modelL2;
     double refDDF = computeDDF(model);
@@ -761,38 +788,43 @@ void VBMManager::computeBPStatistics(Model *model) {
     double indH = topRef->getRelation(0)->getAttribute(ATTRIBUTE_IND_H);
     // for these computations, we need an estimated H which is compatible
     // with the Info-theoretic measures.
-    double refH = computeH(bottomRef);
+    double refH = computeH(bottomRef, AUTO, 0, context);
     //double refCondH = refH - indH;
 
     double condH = modelH - indH;
 
     //        calculate BP_AIC & BIC by Junghan
-    calculateBP_AicBic(model);
+    calculateBP_AicBic(model, context);
 
     model->setAttribute(ATTRIBUTE_BP_COND_H, condH);
     model->setAttribute(ATTRIBUTE_BP_COND_DH, refH - modelH);
     model->setAttribute(ATTRIBUTE_BP_COND_PCT_DH, 100 * (refH - modelH) / depH);
 }
 
-void VBMManager::computePercentCorrect(Model *model) {
-    double total;
-    long long count, i;
+void VBMManager::computeDataPercentCorrect(Model *model, FitContext *context) {
     Relation *indRel = getIndRelation();
     Relation *depRel = getDepRelation();
-
-    //-- if either of these is empty, then we don't have a directed system
     if (indRel == 0 || depRel == 0)
         return;
+    //-- the percent correct is computed (and cached) along with the fit statistics
+    static const char *fitAttributes[] = { ATTRIBUTE_FIT_H, ATTRIBUTE_FIT_T, ATTRIBUTE_FIT_P2,
+            ATTRIBUTE_PCT_CORRECT_DATA, ATTRIBUTE_IPF_ITERATIONS, ATTRIBUTE_IPF_ERROR };
+    if (model->getAttribute(ATTRIBUTE_FIT_P2) >= 0 && model->getAttribute(ATTRIBUTE_PCT_CORRECT_DATA) >= 0)
+        return;
+    if (diskCache && diskCache->restoreModel(model, fitAttributes, sizeof(fitAttributes) / sizeof(fitAttributes[0]))
+            && model->getAttribute(ATTRIBUTE_FIT_P2) >= 0 && model->getAttribute(ATTRIBUTE_PCT_CORRECT_DATA) >= 0)
+        return;
 
     ((ManagerBase*) this)->makeProjection(depRel);
 
-    if (!makeFitTable(model)) {
+    if (!makeFitTable(model, context)) {
         printf("ERROR: Failed to fit variable-based model '%s'\n", model->getPrintName());
         exit(1);
     }
-    Table *modelTable = fitTable1;
-    Table *maxTable = new Table(modelTable->getKeySize(), modelTable->getTupleCount());
+    Table *modelTable = getFitTable(context);
 
+    //-- the projections of the fit and the data onto the predicting variables are
+    //-- summed up during the same pass that computes the other statistics.
     int maxCount = varList->getVarCount();
     int varindices[maxCount], varcount;
     getPredictingVars(model, varindices, varcount, false);
@@ -800,33 +832,68 @@ void VBMManager::computePercentCorrect(Model *model) {
     getPredictingVars(model, varindices, varcount, true);
     Relation *predRelWithDV = getRelation(varindices, varcount);
     Table *predModelTable = new Table(keysize, modelTable->getTupleCount());
-
     Table *predInputTable = new Table(keysize, modelTable->getTupleCount());
-    ManagerBase::makeProjection(modelTable, predModelTable, predRelWithDV);
-    ManagerBase::makeProjection(inputData, predInputTable, predRelWithDV);
 
-    Table *inputsOnly = new Table(keysize, modelTable->getTupleCount());
-    ManagerBase::makeProjection(inputData, inputsOnly, predRelNoDV);
-    model->setAttribute(ATTRIBUTE_PCT_COVERAGE,
-            (double) inputsOnly->getTupleCount() / (double) predRelNoDV->getNC() * 100.0);
-    delete inputsOnly;
+    ocFitStats stats;
+    ocFitStatistics(inputData, modelTable, (long) round(sampleSize), stats, predRelWithDV->getMask(),
+            predInputTable, predModelTable);
+    model->setAttribute(ATTRIBUTE_FIT_H, stats.h);
+    model->setAttribute(ATTRIBUTE_FIT_T, stats.t);
+    model->setAttribute(ATTRIBUTE_FIT_P2, stats.p2);
 
     // "missedValues" is passed as NULL, to signify that this is inputData.  In this case,
     // there is no need to check for missed values, so that step can be skipped.
+    Table *maxTable = new Table(keysize, predModelTable->getTupleCount());
     makeMaxProjection(predModelTable, maxTable, predInputTable, predRelNoDV, depRel, NULL);
 
-    total = 0.0;
-    count = maxTable->getTupleCount();
-    for (i = 0; i < count; i++) {
+    double total = 0.0;
+    long long count = maxTable->getTupleCount();
+    for (long long i = 0; i < count; i++) {
         total += maxTable->getValue(i);
     }
     model->setAttribute(ATTRIBUTE_PCT_CORRECT_DATA, 100 * total);
+    delete maxTable;
+    delete predModelTable;
+    delete predInputTable;
+    if (diskCache)
+        diskCache->saveModel(model);
+}
+
+void VBMManager::computePercentCorrect(Model *model, FitContext *context) {
+    double total;
+    long long count, i;
+    Relation *indRel = getIndRelation();
+    Relation *depRel = getDepRelation();
+
+    //-- if either of these is empty, then we don't have a directed system
+    if (indRel == 0 || depRel == 0)
+        return;
+
+    //-- percent correct on the data comes from the fit statistics pass
+    computeDataPercentCorrect(model, context);
+
+    int maxCount = varList->getVarCount();
+    int varindices[maxCount], varcount;
+    getPredictingVars(model, varindices, varcount, false);
+    Relation *predRelNoDV = getRelation(varindices, varcount);
+    getPredictingVars(model, varindices, varcount, true);
+    Relation *predRelWithDV = getRelation(varindices, varcount);
+
+    Table *inputsOnly = new Table(keysize, inputData->getTupleCount());
+    ManagerBase::makeProjection(inputData, inputsOnly, predRelNoDV);
+    model->setAttribute(ATTRIBUTE_PCT_COVERAGE,
+            (double) inputsOnly->getTupleCount() / (double) predRelNoDV->getNC() * 100.0);
+    delete inputsOnly;
 
     if (testData) {
         //-- for test data, use projections involving only the predicting variables
+        makeFitTable(model, context);
+        Table *modelTable = getFitTable(context);
+        Table *predModelTable = new Table(keysize, modelTable->getTupleCount());
+        ManagerBase::makeProjection(modelTable, predModelTable, predRelWithDV);
         Table *predTestTable = new Table(keysize, testData->getTupleCount());
         ManagerBase::makeProjection(testData, predTestTable, predRelWithDV);
-        maxTable->reset(keysize);
+        Table *maxTable = new Table(keysize, predModelTable->getTupleCount());
         double missedTest = 0;
         makeMaxProjection(predModelTable, maxTable, predTestTable, predRelNoDV, depRel, &missedTest);
         total = 0.0;
@@ -836,10 +903,10 @@ void VBMManager::computePercentCorrect(Model *model) {
         }
         model->setAttribute(ATTRIBUTE_PCT_CORRECT_TEST, 100 * total);
         model->setAttribute(ATTRIBUTE_PCT_MISSED_TEST, 100 * missedTest);
+        delete maxTable;
         delete predTestTable;
+        delete predModelTable;
     }
-    delete maxTable;
-    delete predModelTable, predInputTable;
 }
 
 void VBMManager::setFilter(const char *attrname, double attrvalue, RelOp op) {
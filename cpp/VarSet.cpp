@@ -0,0 +1,109 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#include "VarSet.h"
+
+#include <string.h>
+
+VarSet::VarSet(int varCount) {
+    allocate((varCount + VARSET_WORD_BITS - 1) / VARSET_WORD_BITS);
+}
+
+VarSet::VarSet(int varCount, int *vars, int count) {
+    allocate((varCount + VARSET_WORD_BITS - 1) / VARSET_WORD_BITS);
+    for (int i = 0; i < count; i++)
+        add(vars[i]);
+}
+
+VarSet::VarSet(const VarSet &other) {
+    allocate(other.wordCount);
+    memcpy(words, other.words, wordCount * sizeof(unsigned long long));
+}
+
+VarSet::~VarSet() {
+    if (words != fixedWords)
+        delete[] words;
+}
+
+VarSet &VarSet::operator=(const VarSet &other) {
+    if (this == &other)
+        return *this;
+    if (wordCount != other.wordCount) {
+        if (words != fixedWords)
+            delete[] words;
+        allocate(other.wordCount);
+    }
+    memcpy(words, other.words, wordCount * sizeof(unsigned long long));
+    return *this;
+}
+
+//-- allocate - set up storage for the given number of words, and clear it.
+//-- Small sets (the usual case) use the fixed array.
+void VarSet::allocate(int count) {
+    if (count < 1)
+        count = 1;
+    wordCount = count;
+    words = count <= VARSET_FIXED_WORDS ? fixedWords : new unsigned long long[count];
+    clear();
+}
+
+void VarSet::clear() {
+    memset(words, 0, wordCount * sizeof(unsigned long long));
+}
+
+int VarSet::compare(const VarSet &other) const {
+    //-- The first difference between the two sorted lists is at the lowest variable
+    //-- which is in one set but not the other. If the set which has it has no more
+    //-- variables above that one, the other list is longer; otherwise the other list
+    //-- has a larger variable in that position.
+    for (int i = 0; i < wordCount; i++) {
+        unsigned long long diff = words[i] ^ other.words[i];
+        if (diff == 0)
+            continue;
+        unsigned long long low = diff & (~diff + 1);
+        const VarSet &lacking = (words[i] & low) ? other : *this;
+        unsigned long long above = ~(low | (low - 1));
+        bool more = (lacking.words[i] & above) != 0;
+        for (int j = i + 1; !more && j < wordCount; j++)
+            more = lacking.words[j] != 0;
+        //-- if this set has the lowest difference, then this list is smaller
+        //-- unless the other list ends there.
+        if (&lacking == &other)
+            return more ? -1 : 1;
+        else
+            return more ? 1 : -1;
+    }
+    return 0;
+}
+
+int VarSet::count() const {
+    int count = 0;
+    for (int i = 0; i < wordCount; i++)
+        count += __builtin_popcountll(words[i]);
+    return count;
+}
+
+int VarSet::copyVariables(int *vars) const {
+    int count = 0;
+    for (int i = 0; i < wordCount; i++) {
+        unsigned long long word = words[i];
+        while (word) {
+            int bit = __builtin_ctzll(word);
+            vars[count++] = i * VARSET_WORD_BITS + bit;
+            word &= word - 1;
+        }
+    }
+    return count;
+}
+
+unsigned long long VarSet::hash() const {
+    unsigned long long hash = 0;
+    for (int i = 0; i < wordCount; i++) {
+        hash ^= words[i] + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
@@ -41,6 +41,7 @@ VariableList::VariableList(int maxVars) {
     varCountDF = 0;
     vars = new Variable[maxVars];
     maxAbbrevLen = 0;
+    relationSeed = 0;
     //Anjali
     //maxVarMask = MAX_MASK;
     //maskVars = new long[MAX_MASK];
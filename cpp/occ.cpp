@@ -7,7 +7,7 @@
 
 #include "VBMManager.h"
 #include "SBMManager.h"
-#include "SearchBase.h"
+#include "BeamSearch.h"
 #include "Report.h"
 #include <string.h>
 #include <stdio.h>
@@ -24,6 +24,9 @@ int main(int argc, char* argv[]) {
         printf("\t-L search-levels\n");
         printf("\t-w search-width\n");
         printf("\t-m fit-model (required with -a fit)\n");
+        printf("\t--search-threads=N threads for each search level (default=1)\n");
+        printf("\t--search-prune skip fitting models which can't be kept\n");
+        printf("\t--checkpoint=FILE save the search after each level, and resume it from FILE\n");
         return 1;
     }
     time_t  t0, t1;
@@ -70,91 +73,65 @@ int main(int argc, char* argv[]) {
         if (!mgr->getOptionFloat("search-levels", NULL, &levels))
             levels = 3.0;
 
+        double threads;
+        if (!mgr->getOptionFloat("search-threads", NULL, &threads))
+            threads = 1.0;
+
+        const char *option, *checkpoint;
+        bool prune = mgr->getOptionString("search-prune", NULL, &option);
+        if (!mgr->getOptionString("checkpoint", NULL, &checkpoint))
+            checkpoint = NULL;
+
         mgr->printBasicStatistics();
 #ifdef SB
-        mgr->setSearch("sb-full-up");
+        const char *searchType = "sb-full-up";
 #else
-        mgr->setSearch("full-up");
+        const char *searchType = "full-up";
 #endif
         mgr->setRefModel("bottom");
         Model* start = mgr->getBottomRefModel();
         mgr->computeL2Statistics(start);
         mgr->computeDependentStatistics(start);
         mgr->computeIncrementalAlpha(start);
-        start->setAttribute("level", 0.0);
+        start->setAttribute(ATTRIBUTE_LEVEL, 0.0);
         report->addModel(start);
         int nextID = 0;
         mgr->setSortAttr("information");
-        mgr->setSearchDirection(Direction::Ascending);
         start->setID(nextID++);
 
-        Model **nextModels, **keptModels;
-        Model **model;
-        keptModels = new Model*[1];
-        keptModels[0] = start;
-        long count, levelCount, keptCount, nextCount, foundCount;
-        keptCount = 1;
-        Model** models;
-        bool found;
+        BeamSearch search(mgr, start, Direction::Ascending, searchType, (int) width, (int) levels, mgr->getSortAttr());
+        search.setThreads((int) threads);
+        search.setPruning(prune);
         t1 = clock();
         printf("Setup time: %f seconds\n", (float)(t1 - t0)/CLOCKS_PER_SEC);
-        for (int j=0; j < levels; j++) {
-            nextCount = 0;
-            nextModels = new Model*[keptCount * (int)width];
-            levelCount = 0;
-            printf("level: %d\t", j+1); fflush(stdout);
-            for (int k=0; k < keptCount; k++) {
-                models = mgr->getSearch()->search(keptModels[k]);
-                count = 0;
-                if (models) {
-                    for (model = models; *model; model++)
-                        count++;
-                    levelCount += count;
-                    for (int i=0; i < count; i++) {
-                        mgr->computeInformationStatistics(models[i]);
-                    }
-                    Report::sort(models, count, mgr->getSortAttr(), Direction::Descending);
-                    foundCount = 0;
-                    int i = 0;
-                    while ((foundCount < (width < count ? width : count)) && (i < count)) {
-                        found = false;
-                        for (int n=0; n < nextCount; n++) {
-                            if (nextModels[n] == models[i] || nextModels[n]->isEquivalentTo(models[i])) {
-                                found = true;
-                                break;
-                            }
-                        }
-                        if (!found) {
-                            foundCount++;
-                            nextModels[nextCount++] = models[i];
-                            models[i]->setProgenitor(keptModels[k]);
-                        }
-                        i++;
-                    }
-                    for (; i < count; i++) {
-                        mgr->deleteModelFromCache(models[i]);
-                    }
-                    delete[] models;
-                }
+        if (checkpoint && search.loadCheckpoint(checkpoint, &nextID)) {
+            for (int j=1; j <= search.getLevel(); j++) {
+                printf("level: %d\tresumed: %ld\n", j, search.getModelCount(j));
+                Model **keptModels = search.getModels(j);
+                for (int i=0; i < search.getModelCount(j); i++)
+                    report->addModel(keptModels[i]);
             }
-            delete[] keptModels;
-            keptCount = width < nextCount ? width : nextCount;
-            keptModels = new Model*[keptCount];
-            printf("models: %d\tkept: %d\n", levelCount, keptCount); fflush(stdout);
-            Report::sort(nextModels, nextCount, mgr->getSortAttr(), Direction::Descending);
-            int i;
-            for (i=0; i < keptCount; i++) {
-                nextModels[i]->setAttribute("level", (double)j+1);
-                nextModels[i]->setID(nextID++);
-                mgr->computeDFStatistics(nextModels[i]);
-                mgr->computeL2Statistics(nextModels[i]);
-                mgr->computeIncrementalAlpha(nextModels[i]);
-                report->addModel(nextModels[i]);
-                keptModels[i] = nextModels[i];
+        }
+        for (int j=search.getLevel(); j < levels; j++) {
+            printf("level: %d\t", j+1); fflush(stdout);
+            long keptCount = search.searchLevel();
+            Model **keptModels = search.getModels(j+1);
+            if (prune)
+                printf("models: %ld\tkept: %ld\tpruned: %ld\n", search.getGeneratedCount(j+1), keptCount,
+                        search.getPrunedCount(j+1));
+            else
+                printf("models: %ld\tkept: %ld\n", search.getGeneratedCount(j+1), keptCount);
+            fflush(stdout);
+            for (int i=0; i < keptCount; i++) {
+                keptModels[i]->setID(nextID++);
+                mgr->computeDFStatistics(keptModels[i]);
+                mgr->computeL2Statistics(keptModels[i]);
+                mgr->computeIncrementalAlpha(keptModels[i]);
+                report->addModel(keptModels[i]);
             }
-            delete[] nextModels;
+            if (checkpoint && !search.saveCheckpoint(checkpoint, nextID))
+                printf("WARNING: couldn't save the checkpoint %s\n", checkpoint);
         }
-        delete[] keptModels;
 
         report->setAttributes("level$I, h, ddf, lr, alpha, information, aic, bic, incr_alpha, prog_id");
         report->sort("information", Direction::Descending);
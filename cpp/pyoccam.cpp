@@ -8,6 +8,7 @@
 #include "AttributeList.h"
 #include "Math.h"
 #include "Report.h"
+#include "BeamSearch.h"
 #include "SBMManager.h"
 #include "SearchBase.h"
 #include "VBMManager.h"
@@ -65,6 +66,9 @@ DefinePyObject(SBMManager);
 DefinePyObject(Relation);
 DefinePyObject(Model);
 DefinePyObject(Report);
+DefinePyObject(BeamSearch);
+
+static PyObject *newBeamSearch(ManagerBase *mgr, PyObject *args);
 
 /**************************/
 /****** VBMManager ******/
@@ -552,6 +556,12 @@ DefinePyFunction(VBMManager, Report) {
     return Py_BuildValue("O", report);
 }
 
+// BeamSearch *BeamSearch(Model *start, const char *searchType, int dir, int width, int levels,
+//     const char *sortName, const char *sortDir, int tieByName, int compareProgenitors)
+DefinePyFunction(VBMManager, BeamSearch) {
+    return newBeamSearch(ObjRef(self, VBMManager), args);
+}
+
 // void makeFitTable(Model *model)
 DefinePyFunction(VBMManager, makeFitTable) {
     PyObject *Pmodel;
@@ -680,7 +690,7 @@ static struct PyMethodDef VBMManager_methods[] = { PyMethodDef(VBMManager, initF
         PyMethodDef(VBMManager, setAlphaThreshold),
         PyMethodDef(VBMManager, setValuesAreFunctions), PyMethodDef(VBMManager, setSearchDirection),
         PyMethodDef(VBMManager, printFitReport), PyMethodDef(VBMManager, getOption),
-        PyMethodDef(VBMManager, getOptionList), PyMethodDef(VBMManager, Report),
+        PyMethodDef(VBMManager, getOptionList), PyMethodDef(VBMManager, Report), PyMethodDef(VBMManager, BeamSearch),
         PyMethodDef(VBMManager, makeFitTable), PyMethodDef(VBMManager, isDirected),
         PyMethodDef(VBMManager, printOptions), PyMethodDef(VBMManager, deleteTablesFromCache),
         PyMethodDef(VBMManager, deleteModelFromCache), PyMethodDef(VBMManager, getSampleSz),
@@ -1111,6 +1121,12 @@ DefinePyFunction(SBMManager, Report) {
     return Py_BuildValue("O", report);
 }
 
+// BeamSearch *BeamSearch(Model *start, const char *searchType, int dir, int width, int levels,
+//     const char *sortName, const char *sortDir, int tieByName, int compareProgenitors)
+DefinePyFunction(SBMManager, BeamSearch) {
+    return newBeamSearch(ObjRef(self, SBMManager), args);
+}
+
 // void makeFitTable(Model *model)
 DefinePyFunction(SBMManager, makeFitTable) {
     PyObject *Pmodel;
@@ -1218,7 +1234,7 @@ static struct PyMethodDef SBMManager_methods[] = { PyMethodDef(SBMManager, initF
         PyMethodDef(SBMManager, computeIncrementalAlpha), PyMethodDef(SBMManager, compareProgenitors),
         PyMethodDef(SBMManager, setSearchDirection), PyMethodDef(SBMManager, printFitReport),
         PyMethodDef(SBMManager, getOption), PyMethodDef(SBMManager, getOptionList),
-        PyMethodDef(SBMManager, Report), PyMethodDef(SBMManager, makeFitTable),
+        PyMethodDef(SBMManager, Report), PyMethodDef(SBMManager, BeamSearch), PyMethodDef(SBMManager, makeFitTable),
         PyMethodDef(SBMManager, isDirected), PyMethodDef(SBMManager, printOptions),
         PyMethodDef(SBMManager, deleteModelFromCache), PyMethodDef(SBMManager, deleteTablesFromCache),
         PyMethodDef(SBMManager, computePercentCorrect), PyMethodDef(SBMManager, getSampleSz), PyMethodDef(SBMManager, getMemUsage),
@@ -1797,8 +1813,10 @@ DefinePyFunction(Report, bestModelData) {
     mgr->computeL2Statistics(mod);
     mgr->computeDFStatistics(mod);
     mgr->computeDependentStatistics(mod);
+    //-- a copy, as the cached fit changes with the statistics below
     mgr->makeFitTable(mod);
-    Table* fit = mgr->getFitTable();
+    Table* fit = new Table(input->getKeySize(), mgr->getFitTable()->getTupleCount());
+    fit->copy(mgr->getFitTable());
     fit->normalize();
 
     // DEBUG: print out the model using an iterator
@@ -1836,6 +1854,7 @@ DefinePyFunction(Report, bestModelData) {
         PyDict_SetItem(sparseTable, keyP, valueP);
     };
     tableKVIteration(fit, varlist, var_count, dictPopulator);
+    delete fit;
 
     // Make a Python object to hold everything
     PyObject *ret = Py_BuildValue(
@@ -1909,6 +1928,173 @@ PyTypeObject TReport = { PyObject_HEAD_INIT(&PyType_Type) 0, "Report", sizeof(PR
         (setattrofunc) 0,
     };
 
+/**************************/
+/****** BeamSearch ******/
+/**************************/
+
+//-- newBeamSearch - make a search for either kind of manager. dir is 0 for up, 1 for down.
+static PyObject *newBeamSearch(ManagerBase *mgr, PyObject *args) {
+    PModel *start;
+    char *searchType, *sortName, *sortDir;
+    int dir, width, levels, tieByName, compareProgenitors;
+    if (!PyArg_ParseTuple(args, "O!siiissii", &TModel, &start, &searchType, &dir, &width, &levels, &sortName,
+            &sortDir, &tieByName, &compareProgenitors))
+        return NULL;
+    if (start->obj == NULL)
+        onError("Model is NULL!");
+    BeamSearch *search = new BeamSearch(mgr, start->obj, dir == 1 ? Direction::Descending : Direction::Ascending,
+            searchType, width, levels, sortName,
+            strcmp(sortDir, "ascending") == 0 ? Direction::Ascending : Direction::Descending);
+    if (!search->isValid()) {
+        delete search;
+        onError("Undefined search type");
+    }
+    search->setTieOrder(tieByName ? BeamSearch::BY_NAME : BeamSearch::FIRST_FOUND);
+    search->setCompareProgenitors(compareProgenitors != 0);
+    PBeamSearch *psearch = ObjNew(BeamSearch);
+    psearch->obj = search;
+    return (PyObject*) psearch;
+}
+
+//-- levelModels - a list of the models kept at a level, best first
+static PyObject *levelModels(BeamSearch *search, int level) {
+    long count = search->getModelCount(level);
+    Model **models = search->getModels(level);
+    PyObject *list = PyList_New(count);
+    for (long i = 0; i < count; i++) {
+        PModel *pmodel = ObjNew(Model);
+        pmodel->obj = models[i];
+        PyList_SetItem(list, i, (PyObject*) pmodel);
+    }
+    Py_INCREF(list);
+    return list;
+}
+
+// Model **searchLevel()
+//-- returns the models kept at the new level, best first
+DefinePyFunction(BeamSearch, searchLevel) {
+    PyArg_ParseTuple(args, "");
+    BeamSearch *search = ObjRef(self, BeamSearch);
+    search->searchLevel();
+    return levelModels(search, search->getLevel());
+}
+
+// Model **getModels(int level)
+DefinePyFunction(BeamSearch, getModels) {
+    int level;
+    PyArg_ParseTuple(args, "i", &level);
+    return levelModels(ObjRef(self, BeamSearch), level);
+}
+
+// int getLevel()
+DefinePyFunction(BeamSearch, getLevel) {
+    PyArg_ParseTuple(args, "");
+    return Py_BuildValue("i", ObjRef(self, BeamSearch)->getLevel());
+}
+
+// long getGeneratedCount(int level)
+DefinePyFunction(BeamSearch, getGeneratedCount) {
+    int level;
+    PyArg_ParseTuple(args, "i", &level);
+    return Py_BuildValue("l", ObjRef(self, BeamSearch)->getGeneratedCount(level));
+}
+
+// long getCandidateCount(int level)
+DefinePyFunction(BeamSearch, getCandidateCount) {
+    int level;
+    PyArg_ParseTuple(args, "i", &level);
+    return Py_BuildValue("l", ObjRef(self, BeamSearch)->getCandidateCount(level));
+}
+
+// long getPrunedCount(int level)
+DefinePyFunction(BeamSearch, getPrunedCount) {
+    int level;
+    PyArg_ParseTuple(args, "i", &level);
+    return Py_BuildValue("l", ObjRef(self, BeamSearch)->getPrunedCount(level));
+}
+
+// void setPruning(int prune)
+DefinePyFunction(BeamSearch, setPruning) {
+    int prune;
+    if (!PyArg_ParseTuple(args, "i", &prune))
+        return NULL;
+    ObjRef(self, BeamSearch)->setPruning(prune != 0);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+// void setThreads(int threads)
+DefinePyFunction(BeamSearch, setThreads) {
+    int threads;
+    if (!PyArg_ParseTuple(args, "i", &threads))
+        return NULL;
+    ObjRef(self, BeamSearch)->setThreads(threads);
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+// int saveCheckpoint(const char *file, int nextID)
+DefinePyFunction(BeamSearch, saveCheckpoint) {
+    char *file;
+    int nextID;
+    if (!PyArg_ParseTuple(args, "si", &file, &nextID))
+        return NULL;
+    return Py_BuildValue("i", ObjRef(self, BeamSearch)->saveCheckpoint(file, nextID) ? 1 : 0);
+}
+
+// int loadCheckpoint(const char *file)
+//-- returns the next ID saved with the checkpoint, or -1 if nothing was resumed
+DefinePyFunction(BeamSearch, loadCheckpoint) {
+    char *file;
+    if (!PyArg_ParseTuple(args, "s", &file))
+        return NULL;
+    int nextID;
+    if (!ObjRef(self, BeamSearch)->loadCheckpoint(file, &nextID))
+        nextID = -1;
+    return Py_BuildValue("i", nextID);
+}
+
+static struct PyMethodDef BeamSearch_methods[] = { PyMethodDef(BeamSearch, searchLevel),
+        PyMethodDef(BeamSearch, getLevel), PyMethodDef(BeamSearch, getGeneratedCount),
+        PyMethodDef(BeamSearch, getCandidateCount), PyMethodDef(BeamSearch, getPrunedCount),
+        PyMethodDef(BeamSearch, setPruning), PyMethodDef(BeamSearch, setThreads), PyMethodDef(BeamSearch, getModels),
+        PyMethodDef(BeamSearch, saveCheckpoint), PyMethodDef(BeamSearch, loadCheckpoint), { NULL, NULL, 0 } };
+
+/****** Basic Type Operations ******/
+
+static void BeamSearch_dealloc(PBeamSearch *self) {
+    if (self->obj)
+        delete self->obj;
+    PyObject_DEL(self);
+}
+
+PyObject * BeamSearch_getattr(PyObject *self, char *name) {
+    return Py_FindMethod(BeamSearch_methods, self, name);
+}
+
+/****** Type Definition ******/
+PyTypeObject TBeamSearch = { PyObject_HEAD_INIT(&PyType_Type) 0, "BeamSearch", sizeof(PBeamSearch), 0,
+//-- standard methods
+        (destructor) BeamSearch_dealloc,
+        (printfunc) 0,
+        (getattrfunc) BeamSearch_getattr,
+        (setattrfunc) 0,
+        (cmpfunc) 0,
+        (reprfunc) 0,
+
+        //-- type categories
+        0,
+        0,
+        0,
+
+        //-- more methods
+        (hashfunc) 0,
+        (ternaryfunc) 0,
+        (reprfunc) 0,
+        (getattrofunc) 0,
+        (setattrofunc) 0,
+    };
+
 /**************************/
 /****** MODULE LOGIC ******/
 /**************************/
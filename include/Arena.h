@@ -0,0 +1,66 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___Arena
+#define ___Arena
+
+#include <stddef.h>
+#include <mutex>
+
+/**
+ * Arena.h - defines an allocator for the many small blocks of models and relations
+ * (the objects themselves, and their relation, variable, attribute and name arrays).
+ * Blocks are rounded up to one of a set of size classes, and each chunk holds blocks
+ * of one class. A released block is reused for the next block of its class, and a
+ * chunk is freed as a whole once every block in it has been released. So the models
+ * kept by a search don't hold on to the chunks they share with models the search has
+ * dropped: the space of the dropped ones is filled by the models made next.
+ *
+ * Models and relations each have their own arena (see Model::getArena and
+ * Relation::getArena), since relations live as long as the manager. An arena may be
+ * used from several threads.
+ */
+//-- the number of size classes of the blocks which share chunks (see Arena.cpp)
+#define ARENA_CLASS_COUNT 28
+
+class Arena {
+    public:
+	//-- construct an empty arena; chunks are made as blocks are allocated
+	Arena();
+
+	//-- destroy arena. The chunks still in use are left alone, so an arena can be a
+	//-- static which is destroyed before the last of its blocks.
+	~Arena();
+
+	//-- allocate - a block of at least size bytes, suitably aligned for any type
+	void *allocate(size_t size);
+
+	//-- reallocate - a block of newSize bytes, holding the first oldSize bytes of the
+	//-- old block (which is released), and zeros after them
+	void *reallocate(void *old, size_t oldSize, size_t newSize);
+
+	//-- release - give back a block from any arena. Null is ignored.
+	static void release(void *block);
+
+	//-- the bytes held in chunks, and the number of chunks
+	long long size();
+	long getChunkCount();
+
+    private:
+	struct Chunk;
+	Chunk *newChunk(size_t size, int sizeClass);
+	void freeChunk(Chunk *chunk);
+	void link(Chunk *chunk);
+	void unlink(Chunk *chunk);
+
+	Chunk *open[ARENA_CLASS_COUNT];	// for each size class, the chunks with room
+	long long bytes;
+	long chunkCount;
+	std::mutex mutex;
+};
+
+#endif
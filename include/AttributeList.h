@@ -8,33 +8,85 @@
 #ifndef ___AttributeList
 #define ___AttributeList
 
+#include "Arena.h"
+#include "Constants.h"
+
 /**
  * AttributeList - associated with models and relations, an attribute carries a name and a numeric value.
+ * The known attributes (see Constants.h) have a bit each to say whether they are set.
+ * Only the values which are set are stored, packed in order of their ids, so a value's
+ * slot is the count of bits set below its own. Attributes with other names are kept
+ * in a list, and searched by name.
+ * A list and its arrays are allocated from the arena of the model or relation it is
+ * attached to, as in "new (arena) AttributeList(size, arena)".
  */
+#define ATTRIBUTE_MASK_WORDS ((ATTRIBUTE_ID_COUNT + 63) / 64)
 class AttributeList {
     public:
-        // initialize empty attribute list
-        AttributeList(int size);
+        // initialize empty attribute list, with room for size attributes with other names
+        AttributeList(int size, Arena *arena);
         ~AttributeList();
+        static void *operator new(size_t size, Arena *arena) { return arena->allocate(size); }
+        static void operator delete(void *block, Arena *arena) { Arena::release(block); }
+        static void operator delete(void *block) { Arena::release(block); }
         long size();
         void reset();
+        // replace all attributes with those of another list
+        void copyFrom(AttributeList *other);
 
         // Add an attribute. Names are not copied so the name argument must point to a
         // permanent string. If an attribute by this name already exists, it is replaced.
         void setAttribute(const char *name, double value);
         double getAttribute(const char *name);
+
+        // known attributes, by id
+        void setAttribute(AttributeName attr, double value) {
+            if (isPresent(attr.id))
+                slots[slotOf(attr.id)] = value;
+            else
+                insertSlot(attr.id, value);
+        }
+        double getAttribute(AttributeName attr) {
+            return isPresent(attr.id) ? slots[slotOf(attr.id)] : -1.0;
+        }
+
+        // the index of an attribute which is set (known attributes first, then
+        // others), or -1; the count is one more than the highest possible index.
         int getAttributeIndex(const char *name);
         int getAttributeCount();
         double getAttributeByIndex(int index);
+        // the name of the attribute at an index, or NULL if it isn't set
+        const char *getAttributeName(int index);
+
+        // the id of a known attribute name, ignoring case and anything after a "$"
+        // (which is formatting information), or -1 if the name is not a known one.
+        static int findId(const char *name);
 
         // Print out values
         void dump();
 
     private:
+        bool isPresent(int id) {
+            return (present[id / 64] >> (id % 64)) & 1;
+        }
+        // the slot of a known attribute: the number of attributes set with lower ids
+        int slotOf(int id) {
+            int slot = 0;
+            for (int i = 0; i < id / 64; i++)
+                slot += __builtin_popcountll(present[i]);
+            return slot + __builtin_popcountll(present[id / 64] & ((1ULL << (id % 64)) - 1));
+        }
+        void insertSlot(int id, double value);
+
+        unsigned long long present[ATTRIBUTE_MASK_WORDS];
+        double *slots;		// values of the known attributes set, in order of id
+        int slotCount;
+        int maxSlotCount;
         const char** names;
         double *values;
         int attrCount;
         int maxAttrCount;
+        Arena *arena;
 };
 
 #endif
@@ -0,0 +1,152 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___BeamSearch
+#define ___BeamSearch
+
+#include "ParallelEvaluator.h"
+#include "Report.h"
+#include "SearchBase.h"
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * BeamSearch - a level-by-level search of the lattice of models, keeping the best
+ * models of each level as the parents of the next (a beam search). This is the
+ * search done by occ and by the Python search scripts.
+ *
+ * The models kept at each level are the best "width" distinct models generated from
+ * the models kept at the level before, by the sort attribute. They are chosen with a
+ * heap bounded at width models, and models already seen are recognized by a hash set,
+ * so each model is evaluated once per level. State-based models which are equivalent
+ * (see Model::isEquivalentTo) are also kept only once.
+ *
+ * With pruning on, a model with loops is not fitted if a bound on its sort attribute,
+ * found without fitting (see VBMManager::computeSortBound), can't reach the worst of
+ * the models being kept. The kept models are the same as without pruning.
+ *
+ * New models get the level as their "level" attribute, and the first kept model which
+ * generated them as their progenitor. The models are taken from the search as they are
+ * generated (see SearchBase::generate), and fitted and sorted in batches, so only the
+ * models of one parent are held at once: those which can't be kept are deleted from the
+ * manager's cache once the parent is done. Their names are remembered for the rest of
+ * the level, so a model made again by a later parent isn't fitted again.
+ *
+ * A search can be saved to a checkpoint file after any level, and a new search with
+ * the same options and data can be resumed from it: the kept models of each level
+ * are made again from their names, with the attributes, IDs and progenitors they had
+ * when saved, so the levels already searched aren't searched again.
+ */
+class BeamSearch {
+    public:
+        //-- how models with the same value of the sort attribute are ordered
+        enum TieOrder {
+            FIRST_FOUND,    // the model generated first is preferred
+            BY_NAME         // the model whose name sorts first is preferred
+        };
+
+        //-- searchType is a name known to SearchFactory. The sort statistic is chosen
+        //-- to suit sortAttr, as the Python scripts do; see setStatistic().
+        BeamSearch(ManagerBase *manager, Model *start, Direction direction, const char *searchType, int width,
+                int levels, const char *sortAttr, Direction sortDirection = Direction::Descending);
+        ~BeamSearch();
+
+        //-- false if the search type isn't known
+        bool isValid() { return search != NULL; }
+
+        //-- the statistic computed for each new model before it is sorted
+        void setStatistic(ModelStatistic stat) { statistic = stat; }
+
+        //-- compute the statistics with an evaluator, for each batch of new models at once
+        void setEvaluator(ParallelEvaluator *eval) { evaluator = eval; }
+
+        //-- compute the statistics on this many threads, with an evaluator owned by
+        //-- the search (as for the "search-threads" option). One thread needs none.
+        void setThreads(int threads);
+
+        void setTieOrder(TieOrder order) { tieOrder = order; }
+
+        //-- if set, a model which is generated again by another parent keeps whichever
+        //-- progenitor gives the better incremental alpha (see ManagerBase::compareProgenitors)
+        void setCompareProgenitors(bool compare) { compareProgenitors = compare; }
+
+        //-- skip fitting the models which can't be kept, when a bound is known for
+        //-- the sort attribute. This is done for variable-based models sorted by a
+        //-- descending information, aic or bic.
+        void setPruning(bool prune);
+
+        //-- search the next level, and return the number of models kept. Nothing is done
+        //-- once all levels are searched, or if nothing was kept at the last level.
+        long searchLevel();
+
+        //-- search all the remaining levels
+        void run();
+
+        //-- the number of levels searched so far
+        int getLevel() { return (int) kept.size() - 1; }
+
+        //-- the models kept at a level, best first. Level 0 is the start model.
+        Model **getModels(int level);
+        long getModelCount(int level);
+
+        //-- the number of models generated at a level, and how many of those were new
+        //-- (not generated before by another parent, or kept at an earlier level)
+        long getGeneratedCount(int level);
+        long getCandidateCount(int level);
+
+        //-- the number of new models at a level which were pruned, without being fitted
+        long getPrunedCount(int level);
+
+        //-- saveCheckpoint - save the levels searched so far, along with the caller's
+        //-- model ID counter. The file is replaced only once written.
+        bool saveCheckpoint(const char *file, int nextID);
+
+        //-- loadCheckpoint - resume a search saved by saveCheckpoint, before any level
+        //-- is searched. Returns false, leaving the search as it was, if there is no
+        //-- checkpoint, or it is for another search or other data (with a warning).
+        bool loadCheckpoint(const char *file, int *nextID);
+
+    private:
+        struct Level;   // the state of the level being searched
+        struct Candidate {
+            Model *model;
+            long sequence;  // order in which the models were found
+        };
+        bool isBetter(const Candidate &c1, const Candidate &c2) const;
+        void offer(std::vector<Candidate> &heap, const Candidate &cand, std::vector<Model*> &dropped);
+        void prune(std::vector<Model*> &models, const Candidate &worst, std::vector<Model*> &dropped);
+        void take(Level &lev, Model *model);
+        void evaluate(Level &lev);
+        void deleteModel(Model *model);
+        const char *managerKind();
+        std::string checkpointHeader();
+
+        ManagerBase *manager;
+        SearchBase *search;
+        char *searchType;
+        Direction direction;
+        int width;
+        int levels;
+        char *sortAttr;
+        ModelOrder order;
+        Direction sortDirection;
+        ModelStatistic statistic;
+        ParallelEvaluator *evaluator;
+        ParallelEvaluator *ownEvaluator;    // made by setThreads
+        TieOrder tieOrder;
+        bool compareProgenitors;
+        class VBMManager *boundManager; // set when pruning
+
+        std::vector<std::vector<Model*> > kept;  // the models kept at each level
+        std::vector<long> generated;
+        std::vector<long> candidates;
+        std::vector<long> pruned;
+        std::unordered_set<Model*> keptSet;     // every model kept so far
+};
+
+#endif
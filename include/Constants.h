@@ -28,73 +28,99 @@ const double PROB_MIN = 1e-36;
 #define OLD_ROW 0
 #define NEW_ROW 1
 
-#define ATTRIBUTE_LEVEL "level"
-#define ATTRIBUTE_H "h"
-#define ATTRIBUTE_T "t"
-#define ATTRIBUTE_DF "df"
-#define ATTRIBUTE_DDF "ddf"
-#define ATTRIBUTE_DDF_IND "ddf_bot"
-#define ATTRIBUTE_FIT_H "fit_h"
-#define ATTRIBUTE_ALG_H "alg_h"
-#define ATTRIBUTE_FIT_T "fit_t"
-#define ATTRIBUTE_ALG_T "alg_t"
-#define ATTRIBUTE_LOOPS "loops"
-#define ATTRIBUTE_EXPLAINED_I "information"
-#define ATTRIBUTE_AIC "aic"
-#define ATTRIBUTE_BIC "bic"
-#define ATTRIBUTE_BP_AIC "bp_aic"
-#define ATTRIBUTE_BP_BIC "bp_bic"
-#define ATTRIBUTE_UNEXPLAINED_I "unexplained"
-#define ATTRIBUTE_T_FROM_H "t_h"
-#define ATTRIBUTE_IPF_ITERATIONS "ipf_iterations"
-#define ATTRIBUTE_IPF_ERROR "ipf_error"
-#define ATTRIBUTE_PROCESSED "processed"
-#define ATTRIBUTE_IND_H "h_ind_vars"
-#define ATTRIBUTE_DEP_H "h_dep_vars"
-#define ATTRIBUTE_COND_H "cond_h"
-#define ATTRIBUTE_COND_DH "cond_dh"
-#define ATTRIBUTE_COND_PCT_DH "cond_pct_dh"
-#define ATTRIBUTE_COND_DF "cond_df"
-#define ATTRIBUTE_COND_DDF "cond_ddf"
-#define ATTRIBUTE_TOTAL_LR "total_lr"
-#define ATTRIBUTE_IND_LR "ind_lr"
-#define ATTRIBUTE_COND_LR "cond_lr"
-#define ATTRIBUTE_COND_H_PROB "cond_h_prob"
-#define ATTRIBUTE_P2 "p2"
-#define ATTRIBUTE_P2_IND "p2_bot"
-#define ATTRIBUTE_P2_ALPHA_IND "p2_alpha_bot"
-#define ATTRIBUTE_P2_BETA_IND "p2_beta_bot"
-#define ATTRIBUTE_P2_ALPHA_SAT "p2_alpha_top"
-#define ATTRIBUTE_P2_BETA_SAT "p2_beta_top"
-#define ATTRIBUTE_P2_ALPHA "p2_alpha"
-#define ATTRIBUTE_P2_BETA "p2_beta"
-#define ATTRIBUTE_LR "lr"
-#define ATTRIBUTE_LR_IND "lr_bot"
-#define ATTRIBUTE_ALPHA_IND "alpha_bot"
-#define ATTRIBUTE_BETA_IND "beta_bot"
-#define ATTRIBUTE_ALPHA_SAT "alpha_top"
-#define ATTRIBUTE_BETA_SAT "beta_top"
-#define ATTRIBUTE_ALPHA "alpha"
-#define ATTRIBUTE_BETA "beta"
-#define ATTRIBUTE_INCR_ALPHA "incr_alpha"
-#define ATTRIBUTE_INCR_ALPHA_REACHABLE "incr_alpha_reachable"
-#define ATTRIBUTE_PROG_ID "prog_id"
-#define ATTRIBUTE_MAX_REL_WIDTH "max_rel_width"
-#define ATTRIBUTE_MIN_REL_WIDTH "min_rel_width"
-#define ATTRIBUTE_BP_T "bp_t"
-#define ATTRIBUTE_BP_H "bp_h"
-#define ATTRIBUTE_BP_LR "bp_lr"
-#define ATTRIBUTE_BP_ALPHA "bp_alpha"
-#define ATTRIBUTE_BP_BETA "bp_beta"
-#define ATTRIBUTE_BP_EXPLAINED_I "bp_information"
-#define ATTRIBUTE_BP_UNEXPLAINED_I "bp_unexplained"
-#define ATTRIBUTE_BP_COND_H "bp_cond_h"
-#define ATTRIBUTE_BP_COND_DH "bp_cond_dh"
-#define ATTRIBUTE_BP_COND_PCT_DH "bp_cond_pct_dh"
-#define ATTRIBUTE_PCT_CORRECT_DATA "pct_correct_data"
-#define ATTRIBUTE_PCT_COVERAGE "pct_coverage"
-#define ATTRIBUTE_PCT_CORRECT_TEST "pct_correct_test"
-#define ATTRIBUTE_PCT_MISSED_TEST "pct_missed_test"
+//-- Attributes of models and relations. The known attributes are numbered, so that
+//-- an AttributeList can find them by number. Each ATTRIBUTE_ constant is an
+//-- AttributeName, which carries the slot as well as the name, and converts to the
+//-- name wherever a string is wanted. Attributes can still be looked up by name
+//-- (e.g., from Python or report options), and names outside this list are allowed.
+#define OCCAM_ATTRIBUTES(ATTR) \
+    ATTR(LEVEL, "level") \
+    ATTR(H, "h") \
+    ATTR(T, "t") \
+    ATTR(DF, "df") \
+    ATTR(DDF, "ddf") \
+    ATTR(DDF_IND, "ddf_bot") \
+    ATTR(FIT_H, "fit_h") \
+    ATTR(ALG_H, "alg_h") \
+    ATTR(FIT_T, "fit_t") \
+    ATTR(ALG_T, "alg_t") \
+    ATTR(FIT_P2, "fit_p2") \
+    ATTR(LOOPS, "loops") \
+    ATTR(EXPLAINED_I, "information") \
+    ATTR(AIC, "aic") \
+    ATTR(BIC, "bic") \
+    ATTR(BP_AIC, "bp_aic") \
+    ATTR(BP_BIC, "bp_bic") \
+    ATTR(UNEXPLAINED_I, "unexplained") \
+    ATTR(T_FROM_H, "t_h") \
+    ATTR(IPF_ITERATIONS, "ipf_iterations") \
+    ATTR(IPF_ERROR, "ipf_error") \
+    ATTR(PROCESSED, "processed") \
+    ATTR(IND_H, "h_ind_vars") \
+    ATTR(DEP_H, "h_dep_vars") \
+    ATTR(COND_H, "cond_h") \
+    ATTR(COND_DH, "cond_dh") \
+    ATTR(COND_PCT_DH, "cond_pct_dh") \
+    ATTR(COND_DF, "cond_df") \
+    ATTR(COND_DDF, "cond_ddf") \
+    ATTR(TOTAL_LR, "total_lr") \
+    ATTR(IND_LR, "ind_lr") \
+    ATTR(COND_LR, "cond_lr") \
+    ATTR(COND_H_PROB, "cond_h_prob") \
+    ATTR(P2, "p2") \
+    ATTR(P2_IND, "p2_bot") \
+    ATTR(P2_ALPHA_IND, "p2_alpha_bot") \
+    ATTR(P2_BETA_IND, "p2_beta_bot") \
+    ATTR(P2_ALPHA_SAT, "p2_alpha_top") \
+    ATTR(P2_BETA_SAT, "p2_beta_top") \
+    ATTR(P2_ALPHA, "p2_alpha") \
+    ATTR(P2_BETA, "p2_beta") \
+    ATTR(LR, "lr") \
+    ATTR(LR_IND, "lr_bot") \
+    ATTR(ALPHA_IND, "alpha_bot") \
+    ATTR(BETA_IND, "beta_bot") \
+    ATTR(ALPHA_SAT, "alpha_top") \
+    ATTR(BETA_SAT, "beta_top") \
+    ATTR(ALPHA, "alpha") \
+    ATTR(BETA, "beta") \
+    ATTR(INCR_ALPHA, "incr_alpha") \
+    ATTR(INCR_ALPHA_REACHABLE, "incr_alpha_reachable") \
+    ATTR(PROG_ID, "prog_id") \
+    ATTR(MAX_REL_WIDTH, "max_rel_width") \
+    ATTR(MIN_REL_WIDTH, "min_rel_width") \
+    ATTR(BP_T, "bp_t") \
+    ATTR(BP_H, "bp_h") \
+    ATTR(BP_LR, "bp_lr") \
+    ATTR(BP_ALPHA, "bp_alpha") \
+    ATTR(BP_BETA, "bp_beta") \
+    ATTR(BP_EXPLAINED_I, "bp_information") \
+    ATTR(BP_UNEXPLAINED_I, "bp_unexplained") \
+    ATTR(BP_COND_H, "bp_cond_h") \
+    ATTR(BP_COND_DH, "bp_cond_dh") \
+    ATTR(BP_COND_PCT_DH, "bp_cond_pct_dh") \
+    ATTR(PCT_CORRECT_DATA, "pct_correct_data") \
+    ATTR(PCT_COVERAGE, "pct_coverage") \
+    ATTR(PCT_CORRECT_TEST, "pct_correct_test") \
+    ATTR(PCT_MISSED_TEST, "pct_missed_test")
+
+enum AttributeId {
+#define OCCAM_ATTRIBUTE_ID(sym, name) ATTRIBUTE_ID_##sym,
+    OCCAM_ATTRIBUTES(OCCAM_ATTRIBUTE_ID)
+#undef OCCAM_ATTRIBUTE_ID
+    ATTRIBUTE_ID_COUNT
+};
+
+struct AttributeName {
+    int id;
+    const char *name;
+    constexpr operator const char *() const {
+        return name;
+    }
+};
+
+#define OCCAM_ATTRIBUTE_NAME(sym, name) constexpr AttributeName ATTRIBUTE_##sym = { ATTRIBUTE_ID_##sym, name };
+OCCAM_ATTRIBUTES(OCCAM_ATTRIBUTE_NAME)
+#undef OCCAM_ATTRIBUTE_NAME
 
 
 
@@ -0,0 +1,74 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___DiskCache
+#define ___DiskCache
+
+#include <map>
+#include <mutex>
+#include <stdio.h>
+#include <string>
+#include <unordered_map>
+
+/**
+ * DiskCache.h - defines the persistent cache, which keeps projection tables and
+ * model statistics on disk so that later runs on the same data can reuse them.
+ * Each data set gets its own subdirectory of the cache directory, named by a hash
+ * of its content (variables, input and test data, and the options which affect
+ * the fit), so a cache directory can be shared by different data sets.
+ *
+ * Projections are kept one per file, named from the relation name: a small header
+ * followed by the tuples exactly as a Table stores them, so a file can be mapped
+ * and copied into a table without parsing. Model statistics are appended to a text
+ * file, one model per line, keyed by the model name; values are written with full
+ * precision, so a cached run gives the same results as the first one.
+ *
+ * The model statistics may be restored and saved from concurrent fits; a lock
+ * guards them. Tables are loaded and saved under the manager's cache lock.
+ */
+class DiskCache {
+    public:
+	//-- open (creating if needed) the cache for data with the given content hash
+	DiskCache(const char *dir, unsigned long long dataHash);
+	~DiskCache();
+
+	//-- false if the cache directory couldn't be created
+	bool isOpen() { return ready; }
+
+	//-- loadTable - fill an empty table with the projection saved for a relation.
+	//-- Returns false if there is none.
+	bool loadTable(class Relation *rel, class Table *table);
+	void saveTable(class Relation *rel, class Table *table);
+
+	//-- restoreModel - set those of the given statistics which are saved for a
+	//-- model, other than those it already has. Returns false if nothing is saved
+	//-- for it. Each routine restores only the statistics it computes, so that
+	//-- another's aren't taken as computed (see ManagerBase::calculateDfAndEntropy).
+	bool restoreModel(class Model *model, const char *const *attributes, int count);
+
+	//-- saveModel - save those of the model's statistics which are cached
+	void saveModel(class Model *model);
+
+	//-- hashBytes - continue a 64-bit FNV-1a hash over some bytes; start with
+	//-- DISKCACHE_HASH_SEED
+	static unsigned long long hashBytes(unsigned long long hash, const void *bytes, long long count);
+
+    private:
+	std::string tablePath(class Relation *rel);
+	void loadModels();
+
+	typedef std::map<std::string, double> AttributeMap;
+	std::string path;
+	bool ready;
+	std::unordered_map<std::string, AttributeMap> models;
+	FILE *modelFile;
+	std::mutex modelMutex;
+};
+
+#define DISKCACHE_HASH_SEED 0xcbf29ce484222325ULL
+
+#endif
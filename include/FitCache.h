@@ -0,0 +1,91 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___FitCache
+#define ___FitCache
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * FitCache.h - defines the fit table cache.  This keeps the fitted tables of
+ * recently used models, so that statistics and reports which need the same fit
+ * (Pearson, percent correct, residuals, conditional DV) only pay for it once.
+ * Like the model cache, entries are matched on the printName of the model, which
+ * uniquely identifies the set of relations and therefore the fit.
+ * The cache holds at most a configurable number of bytes of tables (as reported by
+ * Table::size()). When a new table would exceed the budget, the least recently
+ * used tables are deleted. Pinned tables (the reference models) are never evicted,
+ * nor are held tables. A table returned by the cache remains valid until another,
+ * unpinned model is added to the cache, unless it is held; a caller who needs it
+ * longer holds it, and releases it when done.
+ */
+#define FITCACHE_DEFAULT_BUDGET (64L * 1024 * 1024)
+class FitCache {
+    public:
+	//-- construct an empty fit cache, holding at most budget bytes of tables
+	FitCache(long long budget = FITCACHE_DEFAULT_BUDGET);
+
+	//-- destroy fit cache.  This also deletes all the tables held in the cache.
+	~FitCache();
+
+	long long size();
+	long long getBudget() { return budget; }
+
+	//-- set the byte budget, evicting tables if the cache is now over budget
+	void setBudget(long long bytes);
+
+	//-- findTable - find the fit table for a model, and mark it as most recently
+	//-- used. Null is returned if the model has no cached fit.
+	class Table *findTable(class Model *model);
+
+	//-- addTable - put a fit table for a model in the cache. The cache takes
+	//-- ownership of the table. Any previous table for the model is replaced.
+	//-- IPF iteration count and error are kept so they can be restored on a hit.
+	void addTable(class Model *model, class Table *table, bool pinned = false,
+		double ipfIterations = -1, double ipfError = -1);
+
+	//-- restore the IPF attributes recorded with a model's table, if any
+	void restoreAttributes(class Model *model);
+
+	//-- deleteTable - remove the fit for a model, even if it is pinned
+	bool deleteTable(class Model *model);
+
+	//-- delete all tables which are neither pinned nor held
+	void deleteUnpinned();
+
+	//-- holdTable - keep a cached table from being deleted (except by deleteTable())
+	//-- until it is released. Holds are counted. Tables not in the cache are ignored.
+	void holdTable(class Table *table);
+	void releaseTable(class Table *table);
+
+	void dump();
+
+    private:
+	struct Entry {
+	    std::string name;
+	    class Table *table;
+	    long long bytes;
+	    bool pinned;
+	    int holds;
+	    double ipfIterations;
+	    double ipfError;
+	};
+	typedef std::list<Entry> EntryList;
+
+	void evict(Entry *keep);
+	void remove(EntryList::iterator it);
+
+	EntryList lru;	// most recently used at the front
+	std::unordered_map<std::string, EntryList::iterator> index;
+	std::unordered_map<class Table*, EntryList::iterator> tableIndex;
+	long long budget;
+	long long bytes;
+};
+
+#endif
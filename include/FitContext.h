@@ -0,0 +1,42 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___FitContext
+#define ___FitContext
+
+/**
+ * FitContext - the mutable state of fitting models: the IPF work tables, the data
+ * being fit, the most recent fit, and scratch space for statistics. ManagerBase keeps
+ * a default context, which is used when none is given. Fits in different contexts
+ * may run at the same time on different threads, for different models; the manager's
+ * caches are shared between them, under a lock (see ManagerBase). The statistics of
+ * models shared by such fits, such as the reference models, should be computed first.
+ *
+ * The work tables are made on first use, and kept for later fits in the context.
+ */
+class FitContext {
+    public:
+        // data is the table to fit against; NULL means the manager's input data
+        FitContext(class Table *data = 0);
+        ~FitContext();
+
+        // make the work tables, if needed, with room for size tuples to start
+        void makeTables(int keysize, long long size);
+
+        // take the result of the last computeFitTable() (in fitTable1) away from the
+        // context. The caller must delete it.
+        class Table *disownFit();
+
+        class Table *data;        // data to fit against, or NULL for the manager's input data
+        class Table *fitTable1;   // IPF work tables. A computed fit is left in fitTable1.
+        class Table *fitTable2;
+        class Table *projTable;
+        class Table *currentFit;  // the table from the most recent makeFitTable()
+        class ocIntersectProcessor *bpProcessor; // for VBMManager::computeBPT, made on first use
+};
+
+#endif
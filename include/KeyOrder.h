@@ -0,0 +1,56 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___KeyOrder
+#define ___KeyOrder
+
+#include "Types.h"
+
+/**
+ * KeyOrder - orders keys for printing, by the printed values of some of the
+ * variables in turn (numerically, when both values are numbers). It orders
+ * indices, either of the tuples of a table or into an array of keys. Keys
+ * that print the same keep their order.
+ *
+ * The value labels are compared once, when the order is made: each variable
+ * gets a table of the rank of each of its values. sort() then packs the ranks
+ * of each key into an integer (or, if they don't fit, a short tuple of them),
+ * and sorts those. Each KeyOrder carries everything it uses, so tables may be
+ * sorted for several reports at once.
+ */
+class KeyOrder {
+    public:
+        // order by the first count variables of varlist, or, if vars is given, by
+        // the count variables listed there. If keys is NULL, the indices are those
+        // of the tuples of table.
+        KeyOrder(class VariableList *varlist, int count, int *vars, class Table *table, KeySegment **keys = nullptr);
+        ~KeyOrder();
+
+        // sort n indices into order
+        void sort(int *order, long long n);
+
+        // negative, zero or positive, like strcmp
+        int compare(int i1, int i2);
+
+    private:
+        KeyOrder(const KeyOrder &);
+        KeyOrder &operator=(const KeyOrder &);
+        KeySegment *getKey(int i);
+        int getRank(KeySegment *key, int j);
+
+        class VariableList *varList;
+        int count;
+        int *vars;
+        class Table *table;
+        KeySegment **keys;
+        int keysize;
+        int **ranks;  // for each sort variable, the rank of each value index
+        int *bits;    // for each sort variable, the bits needed for its ranks
+        int totalBits;
+};
+
+#endif
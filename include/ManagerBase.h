@@ -8,10 +8,14 @@
 #ifndef ___ManagerBase
 #define ___ManagerBase
 
+#include "FitContext.h"
 #include "Model.h"
 #include "Options.h"
 #include "VarIntersect.h"
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 /**
  * ocIntersectProcessor - this is a base class for processing classes
@@ -48,6 +52,13 @@ class ocIntersectProcessor {
  * - creation of a fit table for a model using IPF
  * - calculation of various parameters for a table or model
  * - determination if a model contains loops
+ *
+ * The mutable state of fitting a model is kept in a FitContext. The fitting and
+ * statistics functions take an optional context (by default the manager's own), so
+ * that fits of different models can run at the same time, each in its own context.
+ * The caches which those fits share (relations and their projections, intersections,
+ * fitted tables, and the disk cache) are used under cacheMutex, and projections are
+ * only trimmed to the cache budget while no fit is running.
  */
 
 using std::map;
@@ -81,6 +92,9 @@ class ManagerBase {
         // corresponding to the relation is also created.
         virtual Relation *getRelation(int *varindices, int varcount, bool makeProject = false, int *stateindices = NULL);
 
+        // make a new relation from a sorted variable list, and put it in the cache
+        Relation *makeRelation(int *varindices, int varcount, int *stateindices);
+
         // get a relation just like the given relation, but with the given variable removed.
         // (skip is the variable id in the master variable list).
         virtual Relation *getChildRelation(Relation *rel, int skip, bool makeProject = false,
@@ -106,20 +120,47 @@ class ManagerBase {
         // as many times as needed.
         virtual bool makeProjections(Model *model);
 
-        // delete projection tables from all relations in cache
+        // delete projection tables from all relations in cache, and all
+        // fit tables other than those of the reference models
         virtual void deleteTablesFromCache();
 
-        // delete a model from the model cache
+        // delete a model from the model cache, along with its cached fit table
         virtual bool deleteModelFromCache(Model *model);
 
-
-        // Make a fit table. This function uses the IPF algorithm. The fit table is
-        // linked to the model.  If the model already has a fit table, the function
-        // returns immediately. False is returned on any error.
-        virtual void fitTestAlgebraic(Model *model, Table* algTable, double missingCard, const FitIntersectMap& map);
-        virtual bool makeFitTable(Model *model);
-        virtual bool makeFitTableIPF(Model *model);
-        virtual bool makeFitTableAlgebraic(Model *model);
+        // set the maximum number of bytes of fit tables kept by the fit cache
+        void setFitCacheBudget(long long bytes);
+
+        // set the maximum number of bytes of projection tables kept by the relation
+        // cache (0 for no limit). Least recently used projections beyond this are
+        // deleted before each fit, and made again when next needed.
+        void setProjectionCacheBudget(long long bytes);
+
+        // make the projections of a model's relations, and keep them from being
+        // deleted to stay within the projection budget
+        void pinProjections(Model *model);
+
+        // open the persistent cache in the directory given by the cache-dir option,
+        // if any. kind distinguishes the managers, whose statistics differ for the
+        // same model names. Called once the data has been read.
+        void openDiskCache(const char *kind);
+
+        // a hash of everything a fit depends on: the variables, the input and test
+        // data, and the IPF options. kind is as for openDiskCache.
+        unsigned long long getDataHash(const char *kind);
+
+        // Make a fit table. Loopless neutral models are fit algebraically; all others
+        // use the IPF algorithm. The fit table is kept in the fit cache and becomes the
+        // table returned by getFitTable(). If the model was fit recently, the cached
+        // table is used and the function returns immediately. False is returned on any error.
+        // In a context other than the default one, the table is the context's own copy.
+        virtual void fitTestAlgebraic(Model *model, Table* algTable, double missingCard, const FitIntersectMap& map,
+                Table *data = NULL);
+        virtual bool makeFitTable(Model *model, FitContext *context = NULL);
+        // Fit a model without consulting the fit cache. The result is left in the
+        // context's fitTable1.
+        virtual bool computeFitTable(Model *model, FitContext *context = NULL);
+        virtual bool makeFitTableIPF(Model *model, FitContext *context = NULL);
+        virtual bool makeFitTableAlgebraic(Model *model, FitContext *context = NULL);
 
         // Expand a single tuple into all values of all missing variables, recursively
         void expandTuple(double tupleValue, KeySegment *key, int *missingVars, int missingCount, Table *outTable,
@@ -131,14 +172,50 @@ class ManagerBase {
         // Process relations and intersections, as need for DF and H computation
         void doIntersectionProcessing(Model *model, ocIntersectProcessor *proc);
 
+        // Get the intersection expansion of a model: the relations, then each level of
+        // intersections among them, with signs and counts. The list is built on first
+        // use and cached on the model.
+        const IntersectTermList &getIntersectTerms(Model *model);
+        void makeIntersectTerms(Relation **rels, int count, IntersectTermList &terms);
+
+        // Get the relation which is the intersection of two relations, or NULL if they
+        // have no variables in common. Results are memoized for the life of the manager.
+        Relation *getIntersection(Relation *rel1, Relation *rel2);
+
         // Compute degrees of freedom of a model.  This involves computing degrees
         // of freedom of the constituent relations, minus the first order overlaps,
         // plus the second order overlaps, etc. This also computes entropy, though
         // it isn't correct if the model contains loops. For models with loops, use IPF.
         void calculateDfAndEntropy(Model *model);
 
-        // Determine if the model has loops, and cache this fact for later use
-        bool hasLoops(Model *model);
+        // Compute the DF of a model from that of its progenitor, when the two differ
+        // by only a few relations. Only the intersection terms involving the changed
+        // relations are computed. False is returned if this can't be done.
+        bool calculateDfIncremental(Model *model);
+
+        // A lower bound on the H of a model with loops, without fitting it. The model
+        // is contained in the loopless model made by adding one relation over the
+        // variables left in its loops, whose H is algebraic and no greater than its own.
+        double computeHLowerBound(Model *model);
+
+        // Compute the change in DF and H (unless withH is false) from adding a relation
+        // to a list of relations.
+        void addedDfAndEntropy(std::vector<Relation*> &rels, Relation *rel, double &df, double &h,
+                bool withH = true);
+
+        // Determine if the model has loops, and cache this fact for later use.
+        // If the model adds one relation to a loopless parent (by default, its
+        // progenitor), only the new relation needs to be checked.
+        bool hasLoops(Model *model, Model *parent = NULL);
+
+        // Determine if adding a relation with the given variables to a model would
+        // make loops, without making the relation or the new model. Only the part of
+        // a loopless model touching the relation is examined (the model's loops are
+        // tested first, and cached).
+        bool hasLoopsWith(Model *model, const VarSet &newVars);
+
+        // The relation which the model adds to a loopless parent, or null.
+        Relation *addedRelation(Model *parent, Model *model);
 
         // compute various relation and model attributes. False is returned on error
         // (e.g., no table has been computed) If computation is successful, the
@@ -146,11 +223,15 @@ class ManagerBase {
         virtual double computeDF(Relation *rel); // degrees of freedom
         virtual double computeDF(Model *model);
         virtual double computeH(Relation *rel); // uncertainty
-        virtual double computeH(Model *model, HMethod method = AUTO, int SB = 0);
-        virtual double computeTransmission(Model *model, HMethod method = AUTO, int SB = 0);
+        virtual double computeH(Model *model, HMethod method = AUTO, int SB = 0, FitContext *context = NULL);
+        virtual double computeTransmission(Model *model, HMethod method = AUTO, int SB = 0,
+                FitContext *context = NULL);
         virtual void computeStatistics(Relation *rel);
+        // Fit the model and compute the statistics of the fitted table (fit H,
+        // fit T, Pearson) in one pass over it. Nothing is done if they are present.
+        void computeFitStatistics(Model *model, FitContext *context = NULL);
         virtual void computeRelWidth(Model *model);
-        double computeLR(Model *model);
+        double computeLR(Model *model, FitContext *context = NULL);
         virtual double computeDDF(Model *model);
 
         //-- computes the incremental alpha relative to a model's progenitor
@@ -242,8 +323,17 @@ class ManagerBase {
 
         void printOptions(bool printHTML = false, bool skipNominal = false);
 
-        class Table *getFitTable() {
-            return fitTable1;
+        // the table from the most recent makeFitTable() in a context (by default the
+        // manager's own). In the default context, it belongs to the fit cache, which
+        // keeps it until the next makeFitTable() there; copy it to keep it longer.
+        class Table *getFitTable(FitContext *context = NULL) {
+            return (context ? context : fitContext)->currentFit;
+        }
+        FitContext *getFitContext() {
+            return fitContext;
+        }
+        class FitCache *getFitCache() {
+            return fitCache;
         }
         // state based Model functions
         // calculates the number of state constraints generated
@@ -280,27 +370,32 @@ class ManagerBase {
         int keysize;
         double sampleSize;
         double testSampleSize;
-        unsigned long long stateSpaceSize;
         Table *inputData;
         Table *testData;
         double inputH;
         class RelCache *relCache;
         class ModelCache *modelCache;
+        class FitCache *fitCache;
+        class DiskCache *diskCache;
         class Options *options;
-        Table *fitTable1;
-        Table *fitTable2;
-        Table *projTable;
+        FitContext *fitContext; // the default context
+        std::recursive_mutex cacheMutex; // guards the caches shared by fits
+        std::atomic<int> activeFits; // fits running now, in any context
         int dataLines;
         int *DVOrder;
         int useInverseNotation;
-        VarIntersect *intersectArray;
-        int intersectCount;
-        int intersectMax;
+        std::unordered_map<std::pair<Relation*, Relation*>, Relation*, RelationPairHash<Relation*> > intersectMemo; // bounded by INTERSECT_MEMO_MAX
         double functionConstant;
         double negativeConstant;
         bool valuesAreFunctions;
         Direction searchDirection;
 
+        // trim the projections to the relation cache budget, unless a fit is running
+        void trimProjections();
+
+        // make a cached table the current fit of the default context, holding it
+        void setCurrentFit(class Table *fit);
+
 
 };
 
@@ -44,6 +44,26 @@ double ocMaxDist(Table* p, Table* q);
  */
 double ocPearsonChiSquared(Table *p, Table *q, long sampleSize);
 double ocPearsonChiSquaredFlat(int card, double* p, double* q, long sampleSize);
+
+/**
+ * Statistics of a fitted table against the input data, from ocFitStatistics.
+ */
+struct ocFitStats {
+        double h;	// entropy of the fitted table
+        double t;	// transmission between the input and the fitted table
+        double p2;	// Pearson chisquare
+        double g2;	// likelihood ratio chisquare, 2n ln(2) t
+};
+
+/**
+ * Compute the statistics of a fitted table q in a single pass, walking it together
+ * with the input data p (both tables must be sorted). The values are the same as
+ * ocEntropy(q), ocTransmission(p, q) and ocPearsonChiSquared(p, q, sampleSize).
+ * If a mask is given, the tuples of p and q are also summed into pProj and qProj
+ * with the masked variables set to don't care, as makeProjection() would do.
+ */
+void ocFitStatistics(Table *p, Table *q, long sampleSize, ocFitStats &stats, KeySegment *mask = NULL,
+        Table *pProj = NULL, Table *qProj = NULL);
 /**
  * Determine whether the relations in a model have overlaps
  */
@@ -55,6 +75,24 @@ bool ocHasOverlaps(Model *model);
  */
 bool ocHasLoops(Model *model);
 
+/**
+ * Find the variables in the loops of a model: those left by the GYO reduction
+ * of its relations. The set is empty for a loopless model.
+ */
+void ocLoopVariables(Model *model, VarSet &vars);
+
+/**
+ * Determine if adding a relation to a model without loops would create a loop.
+ * Only the parts of the model connected to the new relation are examined.
+ */
+bool ocHasLoopsWithRelation(Model *model, Relation *added);
+
+/**
+ * The same, for a relation given by its variables, which needn't have been made.
+ * If the model isn't known to be loopless, all of it is examined.
+ */
+bool ocHasLoopsWithVars(Model *model, const VarSet &newVars, bool loopless = true);
+
 /**
  * Compute the degrees of freedom of a relation.  This takes into account
  * the cardinality of the variables in the relation, but is independent
@@ -10,22 +10,26 @@
 
 #include "ModelCache.h"
 #include "Relation.h"
+#include "VarIntersect.h"
 
 /**
- * Model - defines a model as a list of Relations.
+ * Model - defines a model as a list of Relations. Models and their arrays are
+ * allocated from the model arena (see Arena.h), apart from the relations' own.
  */
 class Model {
     public:
         // initialize model, with space for the given number of relations
         Model(int size = 2);
         ~Model();
-        void deleteStructMatrix();
+        static void *operator new(size_t size) { return getArena()->allocate(size); }
+        static void operator delete(void *block) { Arena::release(block); }
+        static Arena *getArena();
         long size();
 
         bool isStateBased();
 
         // get/set relations
-        void addRelation(Relation *relation, bool normalize = true, ModelCache *cache=NULL);
+        void addRelation(Relation *relation, bool normalize = true);
         int getRelations(Relation **rels, int maxRelations);
         Relation *getRelation(int index);
         int getRelationCount();
@@ -43,10 +47,23 @@ class Model {
         }
         void setAttribute(const char *name, double value);
         double getAttribute(const char *name);
+        // known attributes, by slot (the usual case)
+        void setAttribute(AttributeName attr, double value) {
+            attributeList->setAttribute(attr, value);
+        }
+        double getAttribute(AttributeName attr) {
+            return attributeList->getAttribute(attr);
+        }
 
         // get a printable name for the relation, using the variable abbreviations
         const char *getPrintName(int useInverse = 0);
 
+        // the XOR of the IDs of the relations, which identifies the set of relations
+        // (with high probability). It is updated as relations are added or removed.
+        unsigned long long getSignature() {
+            return signature;
+        }
+
         // set, get hash chain linkages
         Model *getHashNext() {
             return hashNext;
@@ -57,7 +74,9 @@ class Model {
 
         // Checks if this model contains the specified relation.  That is, checks if any of
         // the model's relations *contain* this relation, not if any of them *are* this relation.
-        bool containsRelation(Relation *relation, ModelCache *cache=NULL);
+        // For state-based models, this is decided by whether the relation's constraints
+        // raise the rank of the model's structure matrix.
+        bool containsRelation(Relation *relation);
 
         // Checks to see if this model is parent (or higher) of the specified child model.
         // That is, if the "child" is between this model and the bottom on the lattice.
@@ -82,22 +101,28 @@ class Model {
         // print out model info
         void dump(bool detail = false);
 
-        // state based models need to make structure matrix for DF calculation
-        void makeStructMatrix(int statespace, VariableList *vars, int **stateSpaceArr);
-        int* getIndicesFromKey(KeySegment *key, VariableList *vars, int statespace,
-                int **stateSpaceArr, int *counter);
+        // state based models need the rank of their structure matrix for DF calculation
         void completeSbModel();
-        int** makeStateSpaceArray(VariableList *varList, int statespace = 0);
+
+        // the intersection expansion of the model, cached by ManagerBase::getIntersectTerms().
+        // The model owns the list, which is deleted when the relations change.
+        IntersectTermList *getIntersectTerms() {
+            return intersectTerms;
+        }
+        void setIntersectTerms(IntersectTermList *terms);
+
+        // the exact rank of the structure matrix of a state-based model (which is the
+        // DF + 1), built on first use and extended as relations are added
+        class SparseRank *getStateRank();
+        void deleteStateRank();
 
         void printStructMatrix();
-        int **getStructMatrix(int *statespace, int *totalConst);
-//            *statespace = stateSpaceSize;
-//            *totalConst = totalConstraints;
-//            return structMatrix;
-//        }
 
  
     private:
+        bool addStateConstraints(Relation *relation, bool keep);
+        void addStateRows(class SparseRank *rank, Relation *relation, VariableList *vars);
+
         Relation **relations;
         Model *progenitor; // the model from which this one was derived in a search
         int ID; // ID of the model in a search list
@@ -106,11 +131,11 @@ class Model {
         class Table *fitTable;
         class AttributeList *attributeList;
         Model *hashNext;
+        unsigned long long signature;
         char *printName;
         char *inverseName;
-        int **structMatrix;
-        long totalConstraints;
-        int stateSpaceSize;
+        IntersectTermList *intersectTerms;
+        class SparseRank *stateRank;
 };
 
 #endif
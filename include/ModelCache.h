@@ -11,12 +11,14 @@
 /**
  * ModelCache.h - defines the model cache.  This provides a way to reuse model
  * objects.
- * the cache matches on the printName for the model, which uniquely identifies the
- * set of relations.
+ * the cache matches on the set of relations in the model. Models are hashed on
+ * their signature (the XOR of their relations' random IDs), so a model can be
+ * looked up from a list of relations, before it is built. Hash chains are kept
+ * short by doubling the table when it holds more models than buckets.
  * There must be a separate model cache for each different problem instance.
  *
  */
-#define MODELCACHE_HASHSIZE 1001
+#define MODELCACHE_INITIAL_SIZE 1024
 class ModelCache {
     public:
 	//-- construct an empty model cache
@@ -35,16 +37,30 @@ class ModelCache {
 	//-- returns true if successful, false if not found.
 	bool deleteModel(class Model *model);
 
-	//-- findModel - find a model in the cache.  Null is returned if the given
-	//-- model doesn't exist.
-	class Model *findModel(const char *name);
+	//-- findModel - find a model in the cache with the same relations as the given
+	//-- one (which may be the model itself).  Null is returned if there is none.
+	class Model *findModel(class Model *model);
+
+	//-- find the cached model with exactly the given relations, given the XOR of
+	//-- their IDs. Null is returned if there is none.
+	class Model *findModel(unsigned long long signature, class Relation **rels, int count);
+
+	//-- findModelWith - find the cached model which adding a relation to base would
+	//-- give (see Model::addRelation), optionally leaving out one of base's relations,
+	//-- without building it. Only works for models which are not state-based;
+	//-- otherwise null is returned.
+	class Model *findModelWith(class Model *base, class Relation *added, int skip = -1);
 
 	void dump();
 
     private:
+	static bool matches(class Model *model, class Relation **rels, int count);
+	void grow();
+
 	class Model **hash;
+	long capacity;		// always a power of 2
+	long count;
 };
 
 #endif
 
-
@@ -0,0 +1,69 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___ParallelEvaluator
+#define ___ParallelEvaluator
+
+#include "ManagerBase.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ParallelEvaluator - computes a statistic for a list of models, such as the
+ * candidates of one search level, on a pool of threads. The threads share the
+ * manager, and its relation, model and fit caches (which it guards); each thread
+ * fits models in a FitContext of its own.
+ *
+ * The reference models are read by every fit, so their statistics are computed on
+ * the calling thread before the others start. The threads are started on first use,
+ * and kept until the evaluator is deleted.
+ *
+ * The models' progenitors must not be among the models being evaluated, and no
+ * other thread may use the manager while evaluate() runs.
+ */
+typedef void (*ModelStatistic)(ManagerBase *manager, Model *model, FitContext *context);
+
+class ParallelEvaluator {
+    public:
+        // evaluate with the given number of threads. With fewer than two threads,
+        // the statistics are computed on the calling thread.
+        ParallelEvaluator(ManagerBase *manager, int threads);
+        ~ParallelEvaluator();
+
+        int getThreadCount() {
+            return threadCount;
+        }
+
+        // compute the statistic for each of the models
+        void evaluate(Model **models, long count, ModelStatistic statistic);
+
+    private:
+        void prepare(ModelStatistic statistic);
+        void work(FitContext *context);
+
+        ManagerBase *manager;
+        int threadCount;
+        std::vector<std::thread> threads;   // started on first use
+        std::vector<FitContext*> contexts;  // one for each thread
+
+        //-- the batch being evaluated. generation counts the batches, so that each
+        //-- thread takes part in each batch once; busy counts the threads still in it.
+        std::mutex mutex;
+        std::condition_variable started, finished;
+        Model **batch;
+        long batchCount;
+        ModelStatistic batchStatistic;
+        std::atomic<long> next;
+        unsigned long generation;
+        int busy;
+        bool stopping;
+};
+
+#endif
@@ -8,16 +8,28 @@
 #ifndef ___RelationCache
 #define ___RelationCache
 
+#include <list>
+#include <unordered_map>
+
 /**
  * RelCache.h - defines the relation cache.  This provides a way to reuse relation
  * objects, since once constructed a relation object can be used by any model
  * containing that relation.
- * the cache matches on the mask for the relation, which uniquely identifies the
- * set of variables in the relation.
+ * The cache matches on the set of variables in the relation and, for state-based
+ * relations, the state of each variable. A state of DONT_CARE matches a relation
+ * with no states, as the two have the same name.
+ * Relations are kept in an open-addressing hash table (linear probing), which is
+ * doubled in size when it gets half full.
+ * The cache also keeps track of the projection tables of its relations, in least
+ * recently used order, and can hold them to a budget of bytes (as reported by
+ * Table::size()). When the budget is exceeded, trimTables() deletes the least
+ * recently used tables; they are made again the next time they are needed. Tables
+ * of pinned relations (those of the reference models) are never deleted by trimming.
  * There must be a separate relation cache for each different problem instance.
  *
  */
-#define RELCACHE_HASHSIZE 1001
+#define RELCACHE_INITIAL_SIZE 1024
+#define RELCACHE_DEFAULT_TABLE_BUDGET 0	// no limit
 class RelCache {
     public:
 	//-- construct an empty relation cache
@@ -28,22 +40,62 @@ class RelCache {
 
 	long size();
 
-	//-- delete projection tables from all relations in cache
+	//-- delete projection tables from all relations in cache, other than pinned ones
 	void deleteTables();
 
+	//-- addTable - note that a projection table has been made for a relation. It
+	//-- becomes the most recently used one.
+	void addTable(class Relation *rel);
+
+	//-- useTable - mark the table of a relation as the most recently used one
+	void useTable(class Relation *rel);
+
+	//-- pinTable - keep the table of a relation from being deleted by trimTables()
+	//-- or deleteTables(). The relation should already have its table.
+	void pinTable(class Relation *rel);
+
+	//-- trimTables - delete least recently used, unpinned tables until the tables
+	//-- are within budget. Tables returned by Relation::getTable() are only valid
+	//-- until the next trim.
+	void trimTables();
+
+	//-- set the byte budget for tables (0 for no limit)
+	void setTableBudget(long long bytes) { tableBudget = bytes; }
+	long long getTableBudget() { return tableBudget; }
+	long long getTableBytes() { return tableBytes; }
+
 	//-- addRelation - put a new relation in the cache. If a matching relation already
 	//-- exists, an error is returned.
 	bool addRelation(class Relation *rel);
 
-	//-- findRelation - find a relation in the cache.  Null is returned if the given
-	//-- relation doesn't exist.
-	class Relation *findRelation(const char *name);
+	//-- findRelation - find a relation in the cache, given its variables and the
+	//-- state of each (in variable order; null for no states). Null is returned if
+	//-- the relation doesn't exist.
+	class Relation *findRelation(const class VarSet &vars, const int *states = 0);
 
 	void dump();
 
     private:
-	class Relation **hash;
+	static unsigned long long hashKey(const class VarSet &vars, const int *states);
+	static bool matches(class Relation *rel, const class VarSet &vars, const int *states);
+	void grow();
+
+	struct TableEntry {
+	    class Relation *rel;
+	    long long bytes;
+	    bool pinned;
+	};
+	typedef std::list<TableEntry> TableList;
+	void removeTable(TableList::iterator it);
+
+	class Relation **slots;
+	unsigned long long *hashes;	// hash of the relation in each slot
+	long capacity;			// always a power of 2
+	long count;
+	TableList tableLru;	// most recently used at the front
+	std::unordered_map<class Relation*, TableList::iterator> tableIndex;
+	long long tableBudget;
+	long long tableBytes;
 };
 
 #endif
-
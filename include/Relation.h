@@ -8,7 +8,9 @@
 #ifndef ___Relation
 #define ___Relation
 
+#include "AttributeList.h"
 #include "Table.h"
+#include "VarSet.h"
 #include "VariableList.h"
 
 /*
@@ -18,6 +20,7 @@
  * there is no StateConstraint object, then all states are constrained (the normal
  * variable-based modeling case).
  * The variables in a relation are always kept in sorted order.
+ * Relations and their arrays are allocated from the relation arena (see Arena.h).
  */
 class Relation {
     public:
@@ -26,6 +29,9 @@ class Relation {
         // if needed).
         Relation(VariableList *list = 0, int size = 0, int keysz = 0, long stateconstsz = -1);
         ~Relation();
+        static void *operator new(size_t size) { return getArena()->allocate(size); }
+        static void operator delete(void *block) { Arena::release(block); }
+        static Arena *getArena();
         long size();
 
         // returns true if the relation has state constraints, false otherwise
@@ -94,6 +100,19 @@ class Relation {
         void makeMask(KeySegment *msk);
         KeySegment *getMask();
 
+        // get the set of variables in the relation, as a bitset (built on first use)
+        const VarSet &getVarSet() {
+            if (varSet == NULL)
+                varSet = new VarSet(varList->getVarCount(), vars, varCount);
+            return *varSet;
+        }
+
+        // a random 64-bit ID for the relation. A model's signature is the XOR of the
+        // IDs of its relations (see Model::getSignature()).
+        unsigned long long getID() {
+            return id;
+        }
+
         // get the key size; a convenience function for getting it from the variable list
         int getKeySize() {
             return varList->getKeySize();
@@ -103,20 +122,19 @@ class Relation {
         void sort();
         static void sort(int *vars, int varcount, int *states = nullptr);
 
-        // set, get hash chain linkages
-        Relation *getHashNext() {
-            return hashNext;
-        }
-        void setHashNext(Relation *next) {
-            hashNext = next;
-        }
-
         // get the attribute list for the relation
         class AttributeList *getAttributeList() {
             return attributeList;
         }
         void setAttribute(const char *name, double value);
         double getAttribute(const char *name);
+        // known attributes, by slot (the usual case)
+        void setAttribute(AttributeName attr, double value) {
+            attributeList->setAttribute(attr, value);
+        }
+        double getAttribute(AttributeName attr) {
+            return attributeList->getAttribute(attr);
+        }
 
         // get a printable name for the relation, using the variable abbreviations
         const char *getPrintName(int useInverse = 0);
@@ -126,11 +144,31 @@ class Relation {
         // of this relation (otherwise zero is returned).
         double getMatchingTupleValue(KeySegment *key);
 
+        // get, for each tuple of the input table (from which the projection was made),
+        // the index of the matching tuple in the projection table. These are computed on
+        // first use, along with the log values below, and deleted with the table. They
+        // are made again if the input table's keys change (see Table::getSerial).
+        long long *getInputIndex(Table *input);
+
+        // fill index (with a slot per tuple of input) the same way, for a table other
+        // than the one the relation keeps an index for. Nothing is kept.
+        void indexInput(Table *input, long long *index);
+
+        // get the natural log of each projection value, indexed as above. Values too small
+        // to be used (DBL_EPSILON or less) are NAN. Input tuples with no match in the
+        // projection are given one of two extra slots at the end: the first holds NAN,
+        // as their marginal is zero, unless the tuple has a don't care for one of the
+        // relation's variables, which gets the second, holding log(1).
+        double *getLogValues() {
+            return logValues;
+        }
+
         // dump data to stdout
         void dump();
 
     private:
         void buildMask(); // build the variable mask from the list of variables
+        void deleteInputIndex();
 
         VariableList *varList; // variable list associated with this relation
         int *vars; // array of variable indices
@@ -139,9 +177,13 @@ class Relation {
         int varCount; // number of vars in relation
         int maxVarCount; // size of vars array
         class Table *table;
+        unsigned long long indexedSerial; // serial of the input table inputIndex was made for
+        long long *inputIndex;
+        double *logValues;
         class StateConstraint *stateConstraints; // state constraints
-        Relation *hashNext; // linkage for storing relations in a hash table
         KeySegment *mask; // mask has zero for variables in this rel, 1's elsewhere
+        VarSet *varSet; // bitset of the variables in this rel
+        unsigned long long id;
         class AttributeList *attributeList;
         char *printName;
         char *inverseName;
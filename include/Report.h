@@ -32,8 +32,26 @@ class dv_Data{
     int *rule_index;
 };
 
-int sortKeys(const void *d1, const void *d2);
-int sortCompare(const void *k1, const void *k2);
+//-- ModelOrder - orders models by an attribute, in the given direction, for
+//-- std::stable_sort. If a search direction is given, models with equal values
+//-- are ordered by level, as that search would reach them.
+class ModelOrder {
+    public:
+        ModelOrder(const char *attr, Direction dir);
+        ModelOrder(const char *attr, Direction dir, Direction searchDir);
+        bool operator()(Model *m1, Model *m2) const {
+            return compare(m1, m2) < 0;
+        }
+        int compare(Model *m1, Model *m2) const;
+
+    private:
+        const char *attrName;
+        int attrId; // slot of the attribute, if it is a known one
+        Direction dir;
+        bool byLevel;
+        Direction searchDir;
+};
+
 void orderIndices(const char **stringArray, int len, int *order);
 	
 class Report {
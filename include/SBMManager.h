@@ -64,8 +64,9 @@ class SBMManager: public ManagerBase {
         //-- compute various measures. These generally involve the top and/or bottom
         //-- reference models, so makeReferenceModels must be called before any of
         //-- these are used.
-        double computeExplainedInformation(Model *model);
-        double computeUnexplainedInformation(Model *model);
+        //-- Those taking a FitContext fit models in that context (see ManagerBase).
+        double computeExplainedInformation(Model *model, FitContext *context = NULL);
+        double computeUnexplainedInformation(Model *model, FitContext *context = NULL);
         double computeDDF(Model *model);
 
         //-- flag to indicate whether to make projections on all relations
@@ -83,25 +84,25 @@ class SBMManager: public ManagerBase {
         void setSearch(const char *name);
 
         //-- compute basic informational statistics
-        void computeInformationStatistics(Model *model);
+        void computeInformationStatistics(Model *model, FitContext *context = NULL);
 
         //-- compute DF and related statistics
         void computeDFStatistics(Model *model);
 
         //-- compute log likelihood statistics
-        void computeL2Statistics(Model *model);
+        void computeL2Statistics(Model *model, FitContext *context = NULL);
 
         //-- compute Pearson statistics
         void computePearsonStatistics(Model *model);
 
         //-- compute dependent variable statistics
-        void computeDependentStatistics(Model *model);
+        void computeDependentStatistics(Model *model, FitContext *context = NULL);
 
         //-- compute BP-based transmission
         void computeBPStatistics(Model *model);
 
         //-- compute percentage correct of a model for a directed system
-        void computePercentCorrect(Model *model);
+        void computePercentCorrect(Model *model, FitContext *context = NULL);
 
         //-- Filter definitions. If a filter is set on a search object, then
         //-- generated models which do not pass the filter are not kept.
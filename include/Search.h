@@ -8,34 +8,40 @@
 #ifndef ___Search
 #define ___Search
 #include "SearchBase.h"
+#include "VarSet.h"
+#include <unordered_set>
 
 class SearchFullDown : public SearchBase {
     public:
 	SearchFullDown() {};
 	virtual ~SearchFullDown() {};
-	Model **search(Model *start);
+	Model **search(Model *start) { return collect(start); }
+	void generate(Model *start, CandidateSink &sink);
 	static SearchBase *make() { return new SearchFullDown(); }
 };
 
 class SearchFullUp : public SearchBase {
     public:
-	SearchFullUp(): parentList(0), parentListCount(0), parentListMax(0) {};
+	SearchFullUp(): sink(0) {};
 	virtual ~SearchFullUp() {};
-	Model **search(Model *start);
+	Model **search(Model *start) { return collect(start); }
+	void generate(Model *start, CandidateSink &sink);
 	void makeCandidate(class SearchStackEntry *stack, int top, Model *start);
 	static SearchBase *make() { return new SearchFullUp(); }
 
     protected:
-	Model **parentList;
-	long parentListCount;
-	long parentListMax;
+	CandidateSink *sink;	// takes the models of the current search
+	// the variables of each candidate relation found by the current search. The
+	// same relation is reached along many paths, but needs to be made only once.
+	std::unordered_set<VarSet, VarSetHash> candidates;
 };
 
 class SearchLooplessDown : public SearchBase {
     public:
 	SearchLooplessDown() {};
 	virtual ~SearchLooplessDown() {};
-	Model **search(Model *start);
+	Model **search(Model *start) { return collect(start); }
+	void generate(Model *start, CandidateSink &sink);
 	static SearchBase *make() { return new SearchLooplessDown(); }
 };
 
@@ -63,7 +69,8 @@ class SearchLooplessUp : public SearchBase {
     public:
 	SearchLooplessUp() {};
 	virtual ~SearchLooplessUp() {};
-	Model **search(Model *start);
+	Model **search(Model *start) { return collect(start); }
+	void generate(Model *start, CandidateSink &sink);
 	static SearchBase *make() { return new SearchLooplessUp(); }
 };
 
@@ -12,6 +12,14 @@
 #include "VBMManager.h"
 #include "SBMManager.h"
 
+//-- CandidateSink - takes the models generated by a search, one at a time, as they are
+//-- found (see SearchBase::generate). The models are in the manager's cache.
+class CandidateSink {
+    public:
+    virtual ~CandidateSink() {}
+    virtual void accept(Model *model) = 0;
+};
+
 class SearchBase {
     friend class SearchFactory;
     protected:
@@ -19,7 +27,15 @@ class SearchBase {
     public:
     virtual ~SearchBase();
 
+    //-- search - the models generated from start, as a null-terminated list
     virtual Model **search(Model *start);
+
+    //-- generate - give the models generated from start to the sink as they are
+    //-- found, without making a list of them. The default gives the sink the models
+    //-- in the list from search(); a search which generates them itself overrides
+    //-- this, and uses collect() for search().
+    virtual void generate(Model *start, CandidateSink &sink);
+
     bool isDirected() { return directed; }
     bool makeProjection() { return projection; }
     ManagerBase *getManager() { return manager; }
@@ -28,6 +44,7 @@ class SearchBase {
     void setManager(ManagerBase *mgr) { manager = mgr; }
     void setDirected(bool dir) { directed = dir; }
     void setMakeProjection(bool proj) { projection = proj; }
+    Model **collect(Model *start);
 
     //-- data
     ManagerBase *manager;
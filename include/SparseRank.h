@@ -0,0 +1,111 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___SparseRank
+#define ___SparseRank
+
+#include <gmp.h>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * SparseRank - exact rank of a matrix built up one row at a time. Rows are kept
+ * sparse and reduced by fraction-free elimination against a row echelon form
+ * indexed by leading column, so no rounding is involved. This is used for the
+ * structure matrices of state-based models, whose rows are 0/1 and mostly zero.
+ *
+ * A 0/1 row is kept either as a bare list of its columns, or as a pattern: a base
+ * column plus every combination of some digits, each with a stride and a size (a
+ * constraint with don't care variables, in a mixed radix numbering of the states).
+ * A pattern takes space for its digits only, however many columns it covers, so the
+ * row of all ones is a pattern with every digit free. Rows get integer (GMP) values
+ * only when elimination makes them, and go back to a bare list if those are all 1.
+ *
+ * Elimination can fill rows in, until they have nearly every column. Rows are kept
+ * sparse only while they take less memory than the larger of minDenseBytes and a
+ * dense matrix of the rows; past that, the echelon rows are expanded to dense rows
+ * of doubles, and further rows are reduced against those (as the structure matrix
+ * of every state-based model once was). So the rows never take much more than that.
+ *
+ * Rows added after mark() can be dropped again with rollback(), so a caller can
+ * test whether some new rows are independent of the current ones.
+ */
+class SparseRank {
+    public:
+        SparseRank(long long columnCount, long long minDenseBytes = 16 << 20);
+        ~SparseRank();
+
+        // add a row which is 1 in the given columns (sorted, no duplicates) and 0
+        // elsewhere. Returns true if the row is independent of those already added.
+        bool addUnitRow(const long long *cols, long long count);
+
+        // add a row which is 1 in the columns base + sum(digit[i] * strides[i]), for
+        // each 0 <= digit[i] < sizes[i]. The strides are increasing, and each is at
+        // least the span of the digits before it, so no column is repeated.
+        bool addPatternRow(long long base, int digitCount, const long long *strides, const int *sizes);
+
+        long getRank() {
+            return rank;
+        }
+
+        long long getColumnCount() {
+            return columnCount;
+        }
+
+        // the most memory the rows have taken at once, and whether they are now dense
+        long long getPeakBytes() {
+            return peakBytes;
+        }
+
+        bool isDense() {
+            return dense;
+        }
+
+        // remember the current rows, so that rows added later can be rolled back
+        void mark();
+        void rollback();
+
+    private:
+        struct Row {
+            long long count;    // nonzero columns
+            long long *cols;    // the columns, or NULL for a pattern
+            mpz_t *values;      // the values of the columns, or NULL if all are 1
+            long long base;     // for a pattern, the first column,
+            int digitCount;     // and the stride and size of each digit
+            long long *strides;
+            int *sizes;
+        };
+        class Cursor;
+        Row *makeRow(long long count, bool withValues);
+        void deleteRow(Row *row);
+        long long leadingColumn(Row *row);
+        long long rowBytes(Row *row);
+        long long denseLimit();
+        void noteBytes(long long bytes);
+        bool addRow(Row *row);
+        void dropUnitColumns(Row *row);
+        Row *eliminate(Row *row, Row *pivot);
+        void normalize(Row *row);
+        double *expand(Row *row);
+        void makeDense();
+        bool addDenseRow(Row *row);
+
+        std::unordered_map<long long, Row*> pivots; // the echelon row with each leading column
+        std::map<long long, double*> denseRows; // the same, once the rows are dense
+        bool dense;
+        long long columnCount;
+        long long minDenseBytes;
+        long long heldBytes;    // memory taken by the echelon rows
+        long long peakBytes;
+        long rank;
+        std::vector<long long> added; // leading columns, in the order rows were added
+        size_t markPoint;
+        mpz_t one;
+};
+
+#endif
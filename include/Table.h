@@ -10,7 +10,7 @@
 
 #include "Key.h"
 #include "Constants.h"
-#include "Globals.h"
+#include "KeyOrder.h"
 #include <stdlib.h>
 #include <stdio.h>
 
@@ -70,12 +70,27 @@ class Table {
         // Returns the lowest value in the table.
         double getLowestValue();
 
+        // raw tuple storage ({key, value} for each tuple), for saving tables to disk.
+        // setTuples replaces the contents of the table with count tuples in that form.
+        const void *getTupleData() {
+            return data;
+        }
+        long long getTupleBytes();
+        void setTuples(const void *tuples, long long count);
+
+        // a number which identifies the table's current set of keys. It differs from
+        // that of every other table, and changes when keys are added, replaced or
+        // reordered, so it can be used to tell if something made from the keys is
+        // still valid.
+        unsigned long long getSerial();
+
     private:
         void* data; // storage for all keys and values
         int keysize; // number of key segments in the key for each tuple
         long long tupleCount; // number of tuples in the tuple array
         long long maxTupleCount; // the total size of the data member, in terms of tuples
         TableType type; // one of INFO_TYPE, SET_TYPE
+        unsigned long long serial; // see getSerial; zero until asked for after a change
 };
 
 template <typename F>
@@ -85,12 +100,7 @@ void tableIteration(Table* input_table, VariableList* varlist, Relation* rel,
     long long dataCount = input_table->getTupleCount();
     int *key_order = new int[dataCount];
     for (long long i = 0; i < dataCount; i++) { key_order[i] = i; }
-    sort_var_list = varlist;
-    sort_count = var_count;
-    sort_vars = nullptr;
-    sort_keys = nullptr;
-    sort_table = input_table;
-    qsort(key_order, dataCount, sizeof(int), sortKeys);
+    KeyOrder(varlist, var_count, nullptr, input_table).sort(key_order, dataCount);
     if (fit_table == NULL) { fit_table = input_table; }
     if (indep_table == NULL) { indep_table = fit_table; }
 
@@ -121,12 +131,7 @@ void tableKVIteration(Table* table, VariableList* varlist, long var_count, F act
     char* keystr = new char[var_count * MAXABBREVLEN + 1];
     int *key_order = new int[dataCount];
     for (long long i = 0; i < dataCount; i++) { key_order[i] = i; }
-    sort_var_list = varlist;
-    sort_count = var_count;
-    sort_vars = nullptr;
-    sort_keys = nullptr;
-    sort_table = table;
-    qsort(key_order, dataCount, sizeof(int), sortKeys);
+    KeyOrder(varlist, var_count, nullptr, table).sort(key_order, dataCount);
     for (long long order_i = 0; order_i < dataCount; order_i++) {
         int i = key_order[order_i];
         KeySegment* key = table->getKey(i);
@@ -69,8 +69,9 @@ public:
     //-- compute various measures. These generally involve the top and/or bottom
     //-- reference models, so makeReferenceModels must be called before any of
     //-- these are used.
-    double computeExplainedInformation(Model *model);
-    double computeUnexplainedInformation(Model *model);
+    //-- Those taking a FitContext fit models in that context (see ManagerBase).
+    double computeExplainedInformation(Model *model, FitContext *context = NULL);
+    double computeUnexplainedInformation(Model *model, FitContext *context = NULL);
     double computeDDF(Model *model);
     void setDDFMethod(int method);
 
@@ -94,29 +95,39 @@ public:
     void setSearch(const char *name);
 
     //-- compute basic informational statistics
-    void computeInformationStatistics(Model *model);
+    void computeInformationStatistics(Model *model, FitContext *context = NULL);
 
     //-- compute DF and related statistics
     void computeDFStatistics(Model *model);
 
     //-- compute log likelihood statistics
-    void computeL2Statistics(Model *model);
+    void computeL2Statistics(Model *model, FitContext *context = NULL);
 
     //-- compute Pearson statistics
     void computePearsonStatistics(Model *model);
 
+    //-- compute the percent correct on the data of a model for a directed system.
+    //-- It is found in the same pass over the fitted table as the fit statistics,
+    //-- which are computed too; a plain computeFitStatistics() doesn't compute it.
+    void computeDataPercentCorrect(Model *model, FitContext *context = NULL);
+
     //-- compute dependent variable statistics
-    void computeDependentStatistics(Model *model);
+    void computeDependentStatistics(Model *model, FitContext *context = NULL);
 
     //-- compute BP-based transmission
     //void doBPIntersection(Model *model);
-    double computeBPT(Model *model);
+    double computeBPT(Model *model, FitContext *context = NULL);
 
     //-- compute all statistics based on BP_T
-    void computeBPStatistics(Model *model);
+    void computeBPStatistics(Model *model, FitContext *context = NULL);
 
     //-- compute percentage correct of a model for a directed system
-    void computePercentCorrect(Model *model);
+    void computePercentCorrect(Model *model, FitContext *context = NULL);
+
+    //-- an upper bound on a sort attribute of a model with loops (information, or
+    //-- aic or bic with the top or bottom reference), found without fitting the model.
+    //-- False is returned if there is none, e.g., for a loopless model.
+    bool computeSortBound(Model *model, const char *attr, double *bound);
 
     //-- Filter definitions. If a filter is set on a search object, then
     //-- generated models which do not pass the filter are not kept.
@@ -149,7 +160,7 @@ public:
     //-- the varindices arg is filled with the variable indices;
     //-- it needs to have been allocated large enough.
 
-    void calculateBP_AicBic(Model *model);
+    void calculateBP_AicBic(Model *model, FitContext *context = NULL);
 
 private:
     // data
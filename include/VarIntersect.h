@@ -9,6 +9,8 @@
 #define ___VarIntersect
 
 #include "Relation.h"
+#include <functional>
+#include <vector>
 
 struct VarIntersect {
         int startIndex; // the highest numbered relation index this intersection term represents
@@ -20,4 +22,38 @@ struct VarIntersect {
         }
 };
 
+//-- IntersectTerm - one term of the intersection expansion of a model, as passed
+//-- to an ocIntersectProcessor: a relation, with its sign and multiplicity.
+struct IntersectTerm {
+        Relation *rel;
+        bool sign;
+        int count;
+        IntersectTerm(Relation *r, bool s, int c) :
+                rel(r), sign(s), count(c) {
+        }
+};
+typedef std::vector<IntersectTerm> IntersectTermList;
+
+//-- hash for a pair of relations (or a relation and an index), used to memoize
+//-- intersections and to merge duplicate intersection terms. The std::hash of a
+//-- pointer is the pointer itself, whose low bits are always zero, so the combined
+//-- value is mixed (the finalizer of MurmurHash3).
+template <typename T> struct RelationPairHash {
+        size_t operator()(const std::pair<Relation*, T> &p) const {
+            unsigned long long h = std::hash<Relation*>()(p.first);
+            h ^= std::hash<T>()(p.second) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb53fa14ce23bULL;
+            h ^= h >> 33;
+            return (size_t) h;
+        }
+};
+
+//-- the most intersections the manager remembers; past this the memo is cleared.
+//-- Its entries also count against the projection budget, if there is one.
+#define INTERSECT_MEMO_MAX (1 << 18)
+#define INTERSECT_MEMO_ENTRY_BYTES (sizeof(std::pair<Relation*, Relation*>) + 3 * sizeof(void*))
+
 #endif
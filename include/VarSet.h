@@ -0,0 +1,133 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+#ifndef ___VarSet
+#define ___VarSet
+
+#include <stddef.h>
+
+/**
+ * VarSet - a set of variable indices, stored as a bitset with one bit per
+ * variable. Up to VARSET_FIXED_VARS variables are held in a fixed array inside
+ * the object; for larger variable lists, the bits are allocated on the heap.
+ * Set operations are done a word at a time. Sets which are combined or compared
+ * should be built for the same number of variables.
+ */
+#define VARSET_FIXED_WORDS 4
+#define VARSET_WORD_BITS 64
+#define VARSET_FIXED_VARS (VARSET_FIXED_WORDS * VARSET_WORD_BITS)
+
+class VarSet {
+    public:
+        // make an empty set, with room for varCount variables
+        VarSet(int varCount = 0);
+        // make a set from a list of variable indices
+        VarSet(int varCount, int *vars, int count);
+        VarSet(const VarSet &other);
+        ~VarSet();
+        VarSet &operator=(const VarSet &other);
+
+        int getWordCount() const {
+            return wordCount;
+        }
+
+        void clear();
+
+        void add(int var) {
+            words[var / VARSET_WORD_BITS] |= 1ULL << (var % VARSET_WORD_BITS);
+        }
+
+        void remove(int var) {
+            words[var / VARSET_WORD_BITS] &= ~(1ULL << (var % VARSET_WORD_BITS));
+        }
+
+        bool has(int var) const {
+            return (words[var / VARSET_WORD_BITS] >> (var % VARSET_WORD_BITS)) & 1;
+        }
+
+        bool isEmpty() const {
+            for (int i = 0; i < wordCount; i++)
+                if (words[i])
+                    return false;
+            return true;
+        }
+
+        // true if this set is a superset of (or equal to) the other
+        bool contains(const VarSet &other) const {
+            for (int i = 0; i < wordCount; i++)
+                if (other.words[i] & ~words[i])
+                    return false;
+            return true;
+        }
+
+        // true if the sets have any variables in common
+        bool intersects(const VarSet &other) const {
+            for (int i = 0; i < wordCount; i++)
+                if (other.words[i] & words[i])
+                    return true;
+            return false;
+        }
+
+        bool operator==(const VarSet &other) const {
+            for (int i = 0; i < wordCount; i++)
+                if (other.words[i] != words[i])
+                    return false;
+            return true;
+        }
+
+        bool operator!=(const VarSet &other) const {
+            return !(*this == other);
+        }
+
+        VarSet &operator&=(const VarSet &other) {
+            for (int i = 0; i < wordCount; i++)
+                words[i] &= other.words[i];
+            return *this;
+        }
+
+        VarSet &operator|=(const VarSet &other) {
+            for (int i = 0; i < wordCount; i++)
+                words[i] |= other.words[i];
+            return *this;
+        }
+
+        // remove the variables of the other set from this one
+        VarSet &subtract(const VarSet &other) {
+            for (int i = 0; i < wordCount; i++)
+                words[i] &= ~other.words[i];
+            return *this;
+        }
+
+        // compare as sorted variable lists would be compared (see ocCompareVariables):
+        // returns -1, 0 or 1.
+        int compare(const VarSet &other) const;
+
+        // number of variables in the set
+        int count() const;
+
+        // copy the variables to an array, in sorted order. Returns the count.
+        int copyVariables(int *vars) const;
+
+        // a hash of the set, for use in hash tables
+        unsigned long long hash() const;
+
+    private:
+        void allocate(int words);
+
+        unsigned long long fixedWords[VARSET_FIXED_WORDS];
+        unsigned long long *words; // either fixedWords, or allocated
+        int wordCount;
+};
+
+//-- hash for keeping variable sets in unordered containers
+struct VarSetHash {
+        size_t operator()(const VarSet &set) const {
+            return (size_t) set.hash();
+        }
+};
+
+#endif
@@ -9,6 +9,7 @@
 #define ___VariableList
 
 #include "Variable.h"
+#include <atomic>
 
 /**
  * VariableList - defines a list of variables for the current problem. A public
@@ -87,6 +88,16 @@ class VariableList {
         //get the new rebinning value for an old one
         int getNewValue(int, char*, char*);
 
+        //-- nextRelationID - make a random 64-bit ID for a new relation over these
+        //-- variables (splitmix64). Each manager's list has its own sequence, the same
+        //-- on every run, so results are repeatable.
+        unsigned long long nextRelationID() {
+            unsigned long long z = (relationSeed += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
     private:
         Variable *vars;
         int varCount; // number of variables defined so far
@@ -97,6 +108,7 @@ class VariableList {
         //long *maskVars;		//(Anjali) this should store the positions of variables which are to be ignored
         int noUseMaskSize;
         bool *noUseMask;
+        std::atomic<unsigned long long> relationSeed; // the last relation ID made
 };
 
 #endif
@@ -29,6 +29,7 @@ constexpr attrDesc attrDescriptions[] = {
     { ATTRIBUTE_ALG_H, "H(ALG)", "%12.4f" }, 
     { ATTRIBUTE_FIT_T, "T(IPF)", "%12.4f" }, 
     { ATTRIBUTE_ALG_T, "T(ALG)", "%12.4f" }, 
+    { ATTRIBUTE_FIT_P2, "P2(IPF)", "%12.4f" }, 
     { ATTRIBUTE_LOOPS, "Loops", "%2.0f" }, 
     { ATTRIBUTE_EXPLAINED_I, "Inf", "%1.8f" }, 
     { ATTRIBUTE_AIC, "dAIC", "%12.4f" },
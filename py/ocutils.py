@@ -224,70 +224,46 @@ class ocUtils:
             if a1 < a2: result = 1
         return result
 
-    # this function decides which statistic to computed, based
-    # on how search is sorting the models. We want to avoid any
-    # extra expensive computations
-    def computeSortStatistic(self, model):
-        if self.sortName == "h" or self.sortName == "information" or self.sortName == "unexplained" or self.sortName == "alg_t" :
-            self.__manager.computeInformationStatistics(model)
-        elif self.sortName == "df" or self.sortName == "ddf" :
-            self.__manager.computeDFStatistics(model)
-        elif self.sortName == "bp_t" or self.sortName == "bp_information" or self.sortName == "bp_alpha" :
-            self.__manager.computeBPStatistics(model)
-        elif self.sortName == "pct_correct_data":
-            self.__manager.computePercentCorrect(model)
-        # anything else, just compute everything we might need
-        else:
-            self.__manager.computeL2Statistics(model)
-            self.__manager.computeDependentStatistics(model)
- 
-    # this function generates the parents/children of the given model, and for
-    # any which haven't been seen before puts them into the newModel list
-    # this function also computes the LR statistics (H, LR, DF, etc.) as well
-    # as the dependent statistics (dH, %dH, etc.)
-    def processModel(self, level, newModelsHeap, model):
-        addCount = 0
-        generatedModels = self.__manager.searchOneLevel(model)
-        for newModel in generatedModels:
-            if newModel.get("processed") <= 0.0 :
-                newModel.processed = 1.0
-                newModel.level = level
-                newModel.setProgenitor(model)
-                self.computeSortStatistic(newModel)
-    # need a fix here (or somewhere) to check for (and remove) models that have the same DF as the progenitor
-                # decorate model with a key for sorting, & push onto heap
-                key = newModel.get(self.sortName)
-                if self.__searchSortDir == "descending":
-                    key = -key
-                heapq.heappush(newModelsHeap, ([key, newModel.get("name")] , newModel))     # appending the model name makes sort alphabet-consistent
-                addCount += 1
-            else:
-                if self.__IncrementalAlpha:
-                    # this model has been made already, but this progenitor might lead to a better Incr.Alpha
-                    # so we ask the manager to check on that, and save the best progenitor
-                    self.__manager.compareProgenitors(newModel, model)
-        return addCount
+    # this function makes the search, which keeps the best models of each level as
+    # the parents of the next. The search computes the statistics needed to sort
+    # the models, and breaks ties by name, so the results are alphabet-consistent.
+    # With the search-prune option, models which can't be kept aren't fitted, and
+    # with search-threads, the models of each level are fitted on that many threads.
+    def makeBeamSearch(self, start, searchType):
+        search = self.__manager.BeamSearch(start, searchType, 1 if self.searchDir == "down" else 0,
+                                           self.__searchWidth, self.__searchLevels, self.sortName,
+                                           self.__searchSortDir, 1, 1 if self.__IncrementalAlpha else 0)
+        if self.__manager.getOption("search-prune") != "":
+            search.setPruning(1)
+        threads = self.__manager.getOption("search-threads")
+        if threads != "":
+            search.setThreads(int(float(threads)))
+        return search
+
+    # This function resumes a search from the checkpoint file, if there is one, and
+    # adds the models of the levels already searched to the report. It returns the
+    # first level left to search.
+    def resumeSearch(self, search, checkpoint):
+        if checkpoint == "":
+            return 1
+        nextID = search.loadCheckpoint(checkpoint)
+        if nextID < 0:
+            return 1
+        self.__nextID = nextID
+        for i in xrange(1, search.getLevel() + 1):
+            models = search.getModels(i)
+            self.totalgen = search.getCandidateCount(i) + self.totalgen
+            self.totalkept = len(models) + self.totalkept
+            print i, ':', '%d models resumed from %s' % (len(models), checkpoint)
+            for model in models:
+                self.__report.addModel(model)
+        return search.getLevel() + 1
 
-            
-    # This function processes models from one level, and return models for the next level.
-    def processLevel(self, level, oldModels, clear_cache_flag):
-        # start a new heap
-        newModelsHeap = []
-        fullCount = 0
-        for model in oldModels:
-            fullCount += self.processModel(level, newModelsHeap, model)
-        # if searchWidth < heapsize, pop off searchWidth and add to bestModels
-        bestModels = []
-        lastKey = ['','']
-        while len(newModelsHeap) > 0:
-            # make sure that we're adding unique models to the list (mostly for state-based)
-            key, candidate = heapq.heappop(newModelsHeap)
-            if (len(bestModels) < self.__searchWidth): # or key[0] == lastKey[0]:      # comparing keys allows us to select more than <width> models,
-                if True not in [n.isEquivalentTo(candidate) for n in bestModels]:   # in the case of ties
-                    bestModels.append(candidate)
-                    lastKey = key
-            else:
-                break
+    # This function searches one level, and returns the best models found there.
+    # The models not kept are deleted from the cache by the search.
+    def processLevel(self, level, search):
+        bestModels = search.searchLevel()
+        fullCount = search.getCandidateCount(level)
         truncCount = len(bestModels)
         self.totalgen  = fullCount + self.totalgen
         self.totalkept = truncCount + self.totalkept
@@ -295,9 +271,6 @@ class ocUtils:
         if not self.__hide_intermediate_output:
             print '%d new models, %ld kept; %ld total models, %ld total kept; %ld kb memory used; ' % (fullCount, truncCount, self.totalgen+1, self.totalkept+1, memUsed/1024),
         sys.stdout.flush()
-        if clear_cache_flag:
-            for item in newModelsHeap:
-                self.__manager.deleteModelFromCache(item[1])
         return bestModels
 
 
@@ -408,9 +381,8 @@ class ocUtils:
         self.__nextID = 1
         start.setID(self.__nextID)
         start.setProgenitor(start)
-        oldModels = [start]
         try:
-            self.__manager.setSearchType(self.searchType())
+            search = self.makeBeamSearch(start, self.searchType())
         except:
             print "ERROR: UNDEFINED SEARCH TYPE " + self.searchType()
             return
@@ -418,14 +390,16 @@ class ocUtils:
         # is added to the report generator for later output
         if self.__HTMLFormat: print '<pre>'
         print "Searching levels:"
+        checkpoint = self.__manager.getOption("checkpoint")
+        firstLevel = self.resumeSearch(search, checkpoint)
         start_time = time.time()
         last_time = start_time
-        for i in xrange(1,self.__searchLevels+1):
+        for i in xrange(firstLevel,self.__searchLevels+1):
             if self.__manager.getMemUsage() > maxMemoryToUse:
                 print "Memory limit exceeded: stopping search"
                 break
             print i,':',    # progress indicator
-            newModels = self.processLevel(i, oldModels, i != self.__searchLevels)
+            newModels = self.processLevel(i, search)
             current_time = time.time()
             print '%.1f seconds, %.1f total' % (current_time - last_time, current_time - start_time)
             sys.stdout.flush()
@@ -445,9 +419,10 @@ class ocUtils:
                 model.setID(self.__nextID)
                 #model.deleteFitTable()  #recover fit table memory
                 self.__report.addModel(model)
-            oldModels = newModels
+            if checkpoint != "":
+                search.saveCheckpoint(checkpoint, self.__nextID)
             # if the list is empty, stop. Also, only do one step for chain search
-            if self.__searchFilter == "chain" or len(oldModels) == 0:
+            if self.__searchFilter == "chain" or len(newModels) == 0:
                 break
         if self.__HTMLFormat: print '</pre><br>'
         else: print ""
@@ -487,22 +462,23 @@ class ocUtils:
         self.__nextID = 1
         start.setID(self.__nextID)
         start.setProgenitor(start)
-        oldModels = [start]
         try:
-            self.__manager.setSearchType(self.sbSearchType())
+            search = self.makeBeamSearch(start, self.sbSearchType())
         except:
             print "ERROR: UNDEFINED SEARCH TYPE " + self.sbSearchType()
             return
         if self.__HTMLFormat: print '<pre>'
         print "Searching levels:"
+        checkpoint = self.__manager.getOption("checkpoint")
+        firstLevel = self.resumeSearch(search, checkpoint)
         start_time = time.time()
         last_time = start_time
-        for i in xrange(1,self.__searchLevels+1):
+        for i in xrange(firstLevel,self.__searchLevels+1):
             if self.__manager.getMemUsage() > maxMemoryToUse:
                 print "Memory limit exceeded: stopping search"
                 break
             print i,':',    # progress indicator
-            newModels = self.processLevel(i, oldModels, i != self.__searchLevels)
+            newModels = self.processLevel(i, search)
             current_time = time.time()
             print '%.1f seconds, %.1f total' % (current_time - last_time, current_time - start_time)
             last_time = current_time
@@ -521,9 +497,10 @@ class ocUtils:
                 model.setID(self.__nextID)
                 model.deleteFitTable()  #recover fit table memory
                 self.__report.addModel(model)
-            oldModels = newModels
+            if checkpoint != "":
+                search.saveCheckpoint(checkpoint, self.__nextID)
             # if the list is empty, stop. Also, only do one step for chain search
-            if self.__searchFilter == "chain" or len(oldModels) == 0:
+            if self.__searchFilter == "chain" or len(newModels) == 0:
                 break
         if self.__HTMLFormat: print '</pre><br>'
         else: print ""
@@ -894,7 +871,6 @@ class ocUtils:
         # Initialize a manager and the starting model
         self.__manager.setRefModel(self.__refModel)
         self.__manager.setSearchDirection(1 if (self.searchDir == "down") else 0)
-        self.__manager.setSearchType(self.searchType())
        
         # Set up the starting model
         start = self.__manager.getTopRefModel() if (self.searchDir == "down") else self.__manager.getBottomRefModel()
@@ -907,17 +883,16 @@ class ocUtils:
         start.setProgenitor(start)
         
         # Perform the search to find the best model
-        oldModels = [start]
+        search = self.makeBeamSearch(start, self.searchType())
         for i in xrange(1, self.__searchLevels + 1):
             sys.stdout.write('.')
-            newModels = self.processLevel(i, oldModels, i != self.__searchLevels)
+            newModels = self.processLevel(i, search)
             for model in newModels:
                 self.__manager.computeL2Statistics(model)
                 self.__manager.computeDependentStatistics(model)
                 self.__nextID += 1
                 model.setID(self.__nextID)
                 self.__report.addModel(model)
-            oldModels = newModels
 
         self.__report.sort(self.sortName, self.__sortDir)
         best = self.__report.bestModelData()
@@ -0,0 +1,98 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+//-- fitcache - check the fit cache's LRU eviction, pinning and holds, and that the
+//-- manager's current fit survives fitting other models under a small budget.
+
+#include "VBMManager.h"
+#include "FitCache.h"
+#include "Model.h"
+#include "Table.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        printf("fitcache: FAILED %s\n", what);
+        failures++;
+    }
+}
+
+//-- a table of count tuples, with distinct values
+static Table *makeTable(int keysize, int count) {
+    Table *table = new Table(keysize, count);
+    KeySegment key[keysize];
+    for (int i = 0; i < count; i++) {
+        memset(key, 0, sizeof(key));
+        key[0] = i;
+        table->addTuple(key, i + 1);
+    }
+    return table;
+}
+
+int main(int argc, char *argv[]) {
+    const char *args[] = { argv[0], "data/v8.in" };
+    VBMManager *mgr = new VBMManager();
+    mgr->initFromCommandLine(2, (char **) args);
+    int keysize = mgr->getInputData()->getKeySize();
+    Model *a = mgr->makeModel("AB:C", false);
+    Model *b = mgr->makeModel("AB:D", false);
+    Model *c = mgr->makeModel("AB:E", false);
+    Model *d = mgr->makeModel("AB:F", false);
+
+    //-- the least recently used table goes first
+    Table *ta = makeTable(keysize, 100);
+    long long bytes = ta->size();
+    FitCache *cache = new FitCache(bytes * 5 / 2);
+    cache->addTable(a, ta);
+    cache->addTable(b, makeTable(keysize, 100));
+    expect(cache->findTable(a) == ta, "find a cached table");
+    cache->addTable(c, makeTable(keysize, 100));
+    expect(cache->findTable(b) == NULL, "evict the least recently used table");
+    expect(cache->findTable(a) == ta && cache->findTable(c) != NULL, "keep the recently used tables");
+    expect(cache->size() <= cache->getBudget(), "stay within budget");
+
+    //-- pinned and held tables stay, until released
+    cache->addTable(b, makeTable(keysize, 100), true);
+    Table *tc = cache->findTable(c);
+    cache->holdTable(tc);
+    cache->addTable(d, makeTable(keysize, 100));
+    expect(cache->findTable(b) != NULL, "keep a pinned table");
+    expect(cache->findTable(c) == tc, "keep a held table");
+    expect(cache->findTable(a) == NULL, "evict an unheld table");
+    cache->deleteUnpinned();
+    expect(cache->findTable(c) == tc, "keep a held table from deleteUnpinned");
+    expect(cache->findTable(d) == NULL, "delete an unpinned table");
+    cache->releaseTable(tc);
+    cache->deleteUnpinned();
+    expect(cache->findTable(c) == NULL, "delete a released table");
+    delete cache;
+
+    //-- the current fit stays valid while the bottom reference is fit
+    mgr->setFitCacheBudget(1);
+    Model *model = mgr->makeModel("ABC:CD:DE:EA", true);
+    mgr->makeFitTable(model);
+    Table *fit = mgr->getFitTable();
+    Table *copy = new Table(keysize, fit->getTupleCount());
+    copy->copy(fit);
+    Table *indep = mgr->getIndepTable();
+    expect(indep != NULL && indep != fit, "fit the bottom reference");
+    expect(mgr->getFitTable() == fit, "restore the current fit");
+    bool same = fit->getTupleCount() == copy->getTupleCount();
+    for (long long i = 0; same && i < copy->getTupleCount(); i++)
+        same = fit->getValue(i) == copy->getValue(i);
+    expect(same, "keep the current fit's values");
+    mgr->makeFitTable(mgr->makeModel("AB:BC:CA", true));
+    expect(mgr->getFitTable() != fit, "change the current fit");
+    delete copy;
+
+    printf("fitcache: %d failures\n", failures);
+    delete mgr;
+    return failures > 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+//-- loops - check the loop tests on random models, and on the same models with a
+//-- relation added, against a GYO reduction, which is slow but simple: variables
+//-- in only one set are removed, then sets contained in another set, until nothing
+//-- changes. The sets are loopless exactly when at most one is left, and the
+//-- variables of the sets left are those in loops.
+
+#include "VBMManager.h"
+#include "Model.h"
+#include "Relation.h"
+#include "VarSet.h"
+#include "Math.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static bool gyoHasLoops(Model *model, int varCount, VarSet *loopVars = NULL) {
+    int relcount = model->getRelationCount();
+    VarSet *sets = new VarSet[relcount];
+    bool *gone = new bool[relcount];
+    int left = relcount;
+    for (int i = 0; i < relcount; i++) {
+        sets[i] = model->getRelation(i)->getVarSet();
+        gone[i] = false;
+    }
+    bool changed = true;
+    while (changed && left > 1) {
+        changed = false;
+        for (int v = 0; v < varCount; v++) {
+            int holder = -1, holders = 0;
+            for (int i = 0; i < relcount && holders < 2; i++) {
+                if (!gone[i] && sets[i].has(v)) {
+                    holder = i;
+                    holders++;
+                }
+            }
+            if (holders == 1) {
+                sets[holder].remove(v);
+                changed = true;
+            }
+        }
+        for (int i = 0; i < relcount; i++) {
+            for (int j = 0; j < relcount && !gone[i]; j++) {
+                if (j != i && !gone[j] && sets[j].contains(sets[i])) {
+                    gone[i] = true;
+                    left--;
+                    changed = true;
+                }
+            }
+        }
+    }
+    if (loopVars) {
+        *loopVars = VarSet(varCount);
+        for (int i = 0; i < relcount && left > 1; i++)
+            if (!gone[i])
+                *loopVars |= sets[i];
+    }
+    delete[] sets;
+    delete[] gone;
+    return left > 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *args[] = { argv[0], "data/v8.in" };
+    VBMManager *mgr = new VBMManager();
+    mgr->initFromCommandLine(2, (char **) args);
+    int varCount = mgr->getVariableList()->getVarCount();
+    int vars[8];
+    int failures = 0, looped = 0;
+    const int MODELS = 20000;
+    srand(1);
+    for (int m = 0; m < MODELS; m++) {
+        int relcount = 2 + rand() % 6;
+        Model *model = new Model(relcount);
+        for (int r = 0; r < relcount; r++) {
+            //-- up to four distinct variables
+            int count = 0;
+            for (int v = 0; v < varCount && count < 4; v++)
+                if (rand() % 3 == 0)
+                    vars[count++] = v;
+            if (count == 0)
+                vars[count++] = rand() % varCount;
+            model->addRelation(mgr->getRelation(vars, count));
+        }
+        bool loops = ocHasLoops(model);
+        VarSet gyoVars, loopVars;
+        if (loops != gyoHasLoops(model, varCount, &gyoVars)) {
+            printf("loops: %s: the loop test says %d, GYO reduction says %d\n", model->getPrintName(), loops, !loops);
+            failures++;
+        }
+        ocLoopVariables(model, loopVars);
+        if (loopVars != gyoVars) {
+            printf("loops: %s: the loop variables differ from those left by GYO reduction\n", model->getPrintName());
+            failures++;
+        }
+        if (loops)
+            looped++;
+
+        //-- the test for adding a relation, to a model with loops or without
+        VarSet newVars(varCount);
+        for (int v = 0; v < varCount; v++)
+            if (rand() % 3 == 0)
+                newVars.add(v);
+        if (!newVars.isEmpty()) {
+            int count = newVars.copyVariables(vars);
+            Model *joined = new Model(relcount + 1);
+            joined->copyRelations(*model);
+            joined->addRelation(mgr->getRelation(vars, count));
+            bool with = ocHasLoopsWithVars(model, newVars, !loops);
+            if (with != gyoHasLoops(joined, varCount)) {
+                printf("loops: %s with %s: the loop test says %d, GYO reduction says %d\n", model->getPrintName(),
+                        joined->getPrintName(), with, !with);
+                failures++;
+            }
+            delete joined;
+        }
+        delete model;
+    }
+    printf("loops: %d models, %d with loops, %d failures\n", MODELS, looped, failures);
+    delete mgr;
+    return failures > 0;
+}
@@ -0,0 +1,82 @@
+#!/bin/bash
+# Copyright © 1990 The Portland State University OCCAM Project Team
+# [This program is licensed under the GPL version 3 or later.]
+# Please see the file LICENSE in the source
+# distribution of this software for license terms.
+
+# regress.sh - run occ on the examples in each of the ways a search can be run,
+# and compare the reports with those in expected/, which were made by occ before
+# the search and caching changes. Timing lines are left out of the comparison.
+# Every way of running a search must give the same report as a serial one.
+
+TEST=$(cd $(dirname $0) && pwd)
+OCC=${OCC:-$TEST/../cpp/occ}
+OCCSB=${OCCSB:-$TEST/occsb}
+EXAMPLES=$TEST/../examples
+WORK=$(mktemp -d)
+trap "rm -rf $WORK" EXIT
+
+# check NAME EXPECTED [SKIP] - compare standard input with a report, leaving out
+# timing lines, and lines matching SKIP. It runs at the end of a pipeline, so
+# failures are noted in a file rather than a variable.
+check() {
+    skip=${3:-time:}
+    grep -v "time:" | grep -v "$skip" > $WORK/out
+    grep -v "$skip" $TEST/expected/$2.out > $WORK/expected
+    if diff $WORK/expected $WORK/out > $WORK/diff; then
+        echo "ok      $1"
+    else
+        echo "FAILED  $1"
+        head -20 $WORK/diff
+        echo "$1" >> $WORK/failures
+    fi
+}
+
+# a copy of an example with another number of search levels
+withLevels() {
+    awk -v levels=$2 'set { print levels; set = 0; next } /^:search-levels/ { set = 1 } { print }' $1
+}
+
+cd $EXAMPLES
+for f in bw21t08 fit lhs3b lhs3b2 search stat; do
+    $OCC $f.in 2>&1 | check "serial $f" $f
+done
+
+for f in bw21t08 lhs3b lhs3b2 search; do
+    $OCC --search-threads=3 $f.in 2>&1 | check "threads $f" $f
+    $OCC --search-prune $f.in 2>&1 | sed 's/\tpruned: [0-9]*$//' | check "prune $f" $f
+done
+
+#-- a small projection budget trims projections and forgets intersections
+$OCC --projection-cache-mb=0.05 lhs3b2.in 2>&1 | check "projection budget lhs3b2" lhs3b2
+
+#-- a search resumed from a checkpoint reports "resumed" for the levels it read
+withLevels lhs3b2.in 4 > $WORK/lhs3b2.in
+$OCC --checkpoint=$WORK/checkpoint $WORK/lhs3b2.in > /dev/null 2>&1
+$OCC --checkpoint=$WORK/checkpoint lhs3b2.in 2>&1 | check "checkpoint lhs3b2" lhs3b2 "^level:"
+
+#-- the second run restores the statistics saved by the first
+for run in cold warm; do
+    $OCC --cache-dir=$WORK/cache lhs3b2.in 2>&1 | check "cache $run lhs3b2" lhs3b2
+    $OCC --cache-dir=$WORK/cache --search-threads=3 lhs3b.in 2>&1 | check "cache $run threads lhs3b" lhs3b
+done
+
+cd $TEST/data
+#-- a wide search keeps many models whose information ties exactly, so their order
+#-- shows whether H is summed as it was
+for threads in 1 3; do
+    $OCC --optimize-search-width=28 --search-threads=$threads v8.in 2>&1 | check "wide v8, $threads thread(s)" v8
+done
+
+if [ -x $OCCSB ]; then
+    $OCCSB u5.in 2>&1 | check "state-based u5" u5-sb
+else
+    echo "skipped state-based u5 ($OCCSB not built)"
+fi
+
+failures=$(cat $WORK/failures 2>/dev/null | wc -l)
+if [ $failures -gt 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "all checks passed"
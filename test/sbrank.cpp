@@ -0,0 +1,62 @@
+/*
+ * Copyright © 1990 The Portland State University OCCAM Project Team
+ * [This program is licensed under the GPL version 3 or later.]
+ * Please see the file LICENSE in the source
+ * distribution of this software for license terms.
+ */
+
+//-- sbrank - check the structure matrix rank of state-based models over 16 binary
+//-- variables (65536 states): that it stays within the memory of a dense matrix of
+//-- its rows, and that it gives the DF of the same variable-based model, whether
+//-- its rows are kept sparse or made dense.
+
+#include "SBMManager.h"
+#include "VBMManager.h"
+#include "Model.h"
+#include "SparseRank.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what, const char *name) {
+    if (!ok) {
+        printf("sbrank: FAILED %s, for %s\n", what, name);
+        failures++;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *args[] = { argv[0], "data/v16.in" };
+    SBMManager *sbm = new SBMManager();
+    sbm->initFromCommandLine(2, (char **) args);
+    VBMManager *vbm = new VBMManager();
+    vbm->initFromCommandLine(2, (char **) args);
+
+    //-- reducing the constraints of the chain fills rows in toward every state, so
+    //-- they are made dense; those of the others stay sparse
+    const char *names[] = {
+        "AB:BC:CD:DE:EF:FG:GH:HI:IJ:JK:KL:LM:MN:NO:OP",
+        "ABC:CDE:EFG:GHI:IJK:KLM:MNO:OPA",
+        "ABCDEFGH:IJKLMNOP",
+    };
+    Relation *ai = sbm->makeSbModel("AI", false)->getRelation(0);
+    for (int i = 0; i < 3; i++) {
+        Model *model = sbm->makeSbModel(names[i], false);
+        SparseRank *rank = model->getStateRank();
+        long long denseBytes = (rank->getRank() + 1) * rank->getColumnCount() * (long long) sizeof(double);
+        expect(rank->getRank() - 1 == vbm->computeDF(vbm->makeModel(names[i], false)), "match the VB DF", names[i]);
+        expect(rank->getPeakBytes() <= (denseBytes > (16 << 20) ? denseBytes : (16 << 20)),
+                "stay within the memory of a dense matrix", names[i]);
+        expect(rank->isDense() == (i == 0), "make only filled rows dense", names[i]);
+
+        //-- rows added to test containment are rolled back
+        long before = rank->getRank();
+        expect(!model->containsRelation(ai), "not contain AI", names[i]);
+        expect(rank->getRank() == before, "roll back", names[i]);
+    }
+
+    printf("sbrank: %d failures\n", failures);
+    delete vbm;
+    delete sbm;
+    return failures > 0;
+}